@@ -94,10 +94,10 @@ R_API RAnal *r_anal_new() {
 	anal->stackptr = 0;
 	anal->bits_ranges = r_list_newf (free);
 	anal->lineswidth = 0;
+	anal->bb_pool = r_mem_pool_new (sizeof (RAnalBlock), 256, 0);
+	anal->iter_pool = r_mem_pool_new (sizeof (RListIter), 1024, 0);
 	anal->fcns = r_anal_fcn_list_new ();
-#if USE_NEW_FCN_STORE
-	anal->fcnstore = r_listrange_new ();
-#endif
+	anal->fcns_lock = r_th_rwlock_new ();
 	anal->refs = r_anal_ref_list_new ();
 	anal->types = r_anal_type_list_new ();
 	r_anal_set_bits (anal, 32);
@@ -126,6 +126,7 @@ R_API RAnal *r_anal_free(RAnal *a) {
 	R_FREE (a->zign_path);
 	r_list_free (a->plugins);
 	a->fcns->free = r_anal_fcn_free;
+	r_anal_fcn_tree_reset (a);
 	r_list_free (a->fcns);
 	r_space_free (&a->meta_spaces);
 	r_space_free (&a->zign_spaces);
@@ -142,6 +143,10 @@ R_API RAnal *r_anal_free(RAnal *a) {
 		a->esil = NULL;
 	}
 	free (a->last_disasm_reg);
+	/* after the functions, which give their blocks back */
+	r_mem_pool_free (a->bb_pool);
+	r_mem_pool_free (a->iter_pool);
+	r_th_rwlock_free (a->fcns_lock);
 	memset (a, 0, sizeof (RAnal));
 	free (a);
 	return NULL;
@@ -405,12 +410,11 @@ R_API int r_anal_purge (RAnal *anal) {
 	sdb_reset (anal->sdb_xrefs);
 	sdb_reset (anal->sdb_types);
 	sdb_reset (anal->sdb_zigns);
+	r_th_rwlock_write_enter (anal->fcns_lock);
+	r_anal_fcn_tree_reset (anal);
 	r_list_free (anal->fcns);
 	anal->fcns = r_anal_fcn_list_new ();
-#if USE_NEW_FCN_STORE
-	r_listrange_free (anal->fcnstore);
-	anal->fcnstore = r_listrange_new ();
-#endif
+	r_th_rwlock_write_leave (anal->fcns_lock);
 	r_list_free (anal->refs);
 	anal->refs = r_anal_ref_list_new ();
 	r_list_free (anal->types);
@@ -8,10 +8,16 @@
 #define DFLT_NINSTR 3
 
 R_API RAnalBlock *r_anal_bb_new() {
-	RAnalBlock *bb = R_NEW0 (RAnalBlock);
+	return r_anal_bb_new_pool (NULL);
+}
+
+R_API RAnalBlock *r_anal_bb_new_pool(RMemoryPool *pool) {
+	RAnalBlock *bb = pool? r_mem_pool_alloc (pool): R_NEW (RAnalBlock);
 	if (!bb) {
 		return NULL;
 	}
+	memset (bb, 0, sizeof (RAnalBlock));
+	bb->pool = pool;
 	bb->addr = UT64_MAX;
 	bb->jump = UT64_MAX;
 	bb->fail = UT64_MAX;
@@ -62,7 +68,11 @@ R_API void r_anal_bb_free(RAnalBlock *bb) {
 		bb->failbb->prev = NULL;
 		bb->failbb = NULL;
 	}
-	R_FREE (bb);
+	if (bb->pool) {
+		r_mem_pool_dealloc (bb->pool, bb);
+	} else {
+		free (bb);
+	}
 }
 
 R_API RList *r_anal_bb_list_new() {
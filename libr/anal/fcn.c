@@ -41,6 +41,18 @@
 static Sdb *HB = NULL;
 #endif
 
+/* anal->fcns and anal->fcn_tree are guarded by anal->fcns_lock: lookups
+ * share it, inserting and deleting functions take it alone. The functions
+ * themselves are not locked, whoever analyzes one owns it */
+
+/* whether the tree can answer lookups. Lookups never index the functions
+ * appended to the list directly, that needs the write lock and they may
+ * run inside a read section. The next r_anal_fcn_insert indexes them, the
+ * list is walked meanwhile */
+static bool fcn_tree_synced(RAnal *anal) {
+	return anal->fcn_tree_count == r_list_length (anal->fcns);
+}
+
 R_API const char *r_anal_fcn_type_tostring(int type) {
 	switch (type) {
 	case R_ANAL_FCN_TYPE_NULL: return "null";
@@ -67,6 +79,7 @@ R_API void r_anal_fcn_update_tinyrange_bbs(RAnalFunction *fcn) {
 	r_list_foreach (fcn->bbs, iter, bb) {
 		r_tinyrange_add (&fcn->bbr, bb->addr, bb->addr + bb->size);
 	}
+	r_anal_fcn_tree_update (fcn);
 }
 
 R_API int r_anal_fcn_resize(RAnalFunction *fcn, int newsize) {
@@ -138,6 +151,9 @@ R_API void r_anal_fcn_free(void *_fcn) {
 	if (!_fcn) {
 		return;
 	}
+	if (fcn->anal) {
+		r_anal_fcn_tree_delete (fcn->anal, fcn);
+	}
 	fcn->_size = 0;
 	free (fcn->name);
 	free (fcn->attr);
@@ -191,6 +207,7 @@ R_API int r_anal_fcn_xref_add(RAnal *a, RAnalFunction *fcn, ut64 at, ut64 addr,
 	ref->addr = addr; // to
 	ref->type = type;
 	// TODO: ensure we are not dupping xrefs
+	r_list_set_pool (fcn->refs, a->iter_pool);
 	if (refExists (fcn->refs, ref)) {
 		r_anal_ref_free (ref);
 	} else {
@@ -243,10 +260,12 @@ static RAnalBlock *bbget(RAnalFunction *fcn, ut64 addr) {
 }
 
 static RAnalBlock *appendBasicBlock(RAnal *anal, RAnalFunction *fcn, ut64 addr) {
-	RAnalBlock *bb = r_anal_bb_new ();
+	RAnalBlock *bb = r_anal_bb_new_pool (anal->bb_pool);
 	if (!bb) {
 		return NULL;
 	}
+	/* only takes while the list is still empty */
+	r_list_set_pool (fcn->bbs, anal->iter_pool);
 	bb->addr = addr;
 	bb->size = 0;
 	bb->jump = UT64_MAX;
@@ -593,10 +612,12 @@ static int fcn_recurse(RAnal *anal, RAnalFunction *fcn, ut64 addr, ut8 *buf, ut6
 		return R_ANAL_RET_ERROR; // MUST BE TOO DEEP
 	}
 
-	if (r_anal_get_fcn_at (anal, addr, 0)) {
+	RAnalFunction *fcn_at = r_anal_get_fcn_at (anal, addr, 0);
+	bb = bbget (fcn, addr);
+	if (fcn_at && (fcn_at != fcn || bb)) {
+		// only the entry block of a function being reanalyzed gets here
 		return R_ANAL_RET_ERROR; // MUST BE NOT FOUND
 	}
-	bb = bbget (fcn, addr);
 	if (bb) {
 		r_anal_fcn_split_bb (anal, fcn, bb, addr);
 		if (anal->opt.recont) {
@@ -1294,17 +1315,20 @@ R_API int r_anal_fcn(RAnal *anal, RAnalFunction *fcn, ut64 addr, ut8 *buf, ut64
 
 // TODO: need to implement r_anal_fcn_remove(RAnal *anal, RAnalFunction *fcn);
 R_API int r_anal_fcn_insert(RAnal *anal, RAnalFunction *fcn) {
+	RAnalFunction *f;
+	r_th_rwlock_write_enter (anal->fcns_lock);
 	// RAnalFunction *f = r_anal_get_fcn_in (anal, fcn->addr, R_ANAL_FCN_TYPE_ROOT);
-	RAnalFunction *f = r_anal_get_fcn_at (anal, fcn->addr, R_ANAL_FCN_TYPE_ROOT);
+	f = r_anal_get_fcn_at (anal, fcn->addr, R_ANAL_FCN_TYPE_ROOT);
 	if (f) {
+		r_th_rwlock_write_leave (anal->fcns_lock);
 		return false;
 	}
-#if USE_NEW_FCN_STORE
-	r_listrange_add (anal->fcnstore, fcn);
-	// HUH? store it here .. for backweird compatibility
-#endif
 	/* TODO: sdbization */
 	r_list_append (anal->fcns, fcn);
+	r_anal_fcn_tree_insert (anal, fcn);
+	r_anal_fcn_tree_sync (anal);
+	r_th_rwlock_write_leave (anal->fcns_lock);
+	/* unlocked, the callback may look the functions up from any thread */
 	if (anal->cb.on_fcn_new) {
 		anal->cb.on_fcn_new (anal, anal->user, fcn);
 	}
@@ -1354,12 +1378,11 @@ R_API int r_anal_fcn_add(RAnal *a, ut64 addr, ut64 size, const char *name, int t
 
 R_API int r_anal_fcn_del_locs(RAnal *anal, ut64 addr) {
 	RListIter *iter, *iter2;
-	RAnalFunction *fcn, *f = r_anal_get_fcn_in (anal, addr,
-		R_ANAL_FCN_TYPE_ROOT);
-#if USE_NEW_FCN_STORE
-#warning TODO: r_anal_fcn_del_locs not implemented for newstore
-#endif
+	RAnalFunction *fcn, *f;
+	r_th_rwlock_write_enter (anal->fcns_lock);
+	f = r_anal_get_fcn_in (anal, addr, R_ANAL_FCN_TYPE_ROOT);
 	if (!f) {
+		r_th_rwlock_write_leave (anal->fcns_lock);
 		return false;
 	}
 	r_list_foreach_safe (anal->fcns, iter, iter2, fcn) {
@@ -1367,32 +1390,32 @@ R_API int r_anal_fcn_del_locs(RAnal *anal, ut64 addr) {
 			continue;
 		}
 		if (r_anal_fcn_in (fcn, addr)) {
+			r_anal_fcn_tree_delete (anal, fcn);
 			r_list_delete (anal->fcns, iter);
 		}
 	}
 	r_anal_fcn_del (anal, addr);
+	r_th_rwlock_write_leave (anal->fcns_lock);
 	return true;
 }
 
 R_API int r_anal_fcn_del(RAnal *a, ut64 addr) {
+	bool ret = true;
+	r_th_rwlock_write_enter (a->fcns_lock);
 	if (addr == UT64_MAX) {
-#if USE_NEW_FCN_STORE
-		r_listrange_free (a->fcnstore);
-		a->fcnstore = r_listrange_new ();
-#else
+		r_anal_fcn_tree_reset (a);
 		r_list_free (a->fcns);
+		/* give the slabs back once nothing lives in them */
+		if (a->bb_pool && !a->bb_pool->used) {
+			r_mem_pool_reset (a->bb_pool);
+		}
+		if (a->iter_pool && !a->iter_pool->used) {
+			r_mem_pool_reset (a->iter_pool);
+		}
 		if (!(a->fcns = r_anal_fcn_list_new ())) {
-			return false;
+			ret = false;
 		}
-#endif
 	} else {
-#if USE_NEW_FCN_STORE
-		// XXX: must only get the function if starting at 0?
-		RAnalFunction *f = r_listrange_find_in_range (a->fcnstore, addr);
-		if (f) {
-			r_listrange_del (a->fcnstore, f);
-		}
-#else
 		RAnalFunction *fcni;
 		RListIter *iter, *iter_tmp;
 		r_list_foreach_safe (a->fcns, iter, iter_tmp, fcni) {
@@ -1400,22 +1423,21 @@ R_API int r_anal_fcn_del(RAnal *a, ut64 addr) {
 				if (a->cb.on_fcn_delete) {
 					a->cb.on_fcn_delete (a, a->user, fcni);
 				}
+				r_anal_fcn_tree_delete (a, fcni);
 				r_list_delete (a->fcns, iter);
 			}
 		}
-#endif
 	}
-	return true;
+	r_th_rwlock_write_leave (a->fcns_lock);
+	return ret;
 }
 
-R_API RAnalFunction *r_anal_get_fcn_in(RAnal *anal, ut64 addr, int type) {
-#if USE_NEW_FCN_STORE
-	// TODO: type is ignored here? wtf.. we need more work on fcnstore
-	// if (root) return r_listrange_find_root (anal->fcnstore, addr);
-	return r_listrange_find_in_range (anal->fcnstore, addr);
-#else
+static RAnalFunction *fcn_get_in(RAnal *anal, ut64 addr, int type) {
 	RAnalFunction *fcn, *ret = NULL;
 	RListIter *iter;
+	if (fcn_tree_synced (anal)) {
+		return r_anal_fcn_tree_find_in (anal, addr, type);
+	}
 	if (type == R_ANAL_FCN_TYPE_ROOT) {
 		r_list_foreach (anal->fcns, iter, fcn) {
 			if (addr == fcn->addr) {
@@ -1433,22 +1455,26 @@ R_API RAnalFunction *r_anal_get_fcn_in(RAnal *anal, ut64 addr, int type) {
 		}
 	}
 	return ret;
-#endif
+}
+
+R_API RAnalFunction *r_anal_get_fcn_in(RAnal *anal, ut64 addr, int type) {
+	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (anal->fcns_lock);
+	fcn = fcn_get_in (anal, addr, type);
+	r_th_rwlock_read_leave (anal->fcns_lock);
+	return fcn;
 }
 
 R_API bool r_anal_fcn_in(RAnalFunction *fcn, ut64 addr) {
 	return fcn? r_tinyrange_in (&fcn->bbr, addr): false;
 }
 
-R_API RAnalFunction *r_anal_get_fcn_in_bounds(RAnal *anal, ut64 addr, int type) {
-#if USE_NEW_FCN_STORE
-#warning TODO: r_anal_get_fcn_in_bounds
-	// TODO: type is ignored here? wtf.. we need more work on fcnstore
-	// if (root) return r_listrange_find_root (anal->fcnstore, addr);
-	return r_listrange_find_in_range (anal->fcnstore, addr);
-#else
+static RAnalFunction *fcn_get_in_bounds(RAnal *anal, ut64 addr, int type) {
 	RAnalFunction *fcn, *ret = NULL;
 	RListIter *iter;
+	if (fcn_tree_synced (anal)) {
+		return r_anal_fcn_tree_find_in_bounds (anal, addr, type);
+	}
 	if (type == R_ANAL_FCN_TYPE_ROOT) {
 		r_list_foreach (anal->fcns, iter, fcn) {
 			if (addr == fcn->addr) {
@@ -1465,18 +1491,28 @@ R_API RAnalFunction *r_anal_get_fcn_in_bounds(RAnal *anal, ut64 addr, int type)
 		}
 	}
 	return ret;
-#endif
+}
+
+R_API RAnalFunction *r_anal_get_fcn_in_bounds(RAnal *anal, ut64 addr, int type) {
+	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (anal->fcns_lock);
+	fcn = fcn_get_in_bounds (anal, addr, type);
+	r_th_rwlock_read_leave (anal->fcns_lock);
+	return fcn;
 }
 
 R_API RAnalFunction *r_anal_fcn_find_name(RAnal *anal, const char *name) {
-	RAnalFunction *fcn = NULL;
+	RAnalFunction *fcn, *ret = NULL;
 	RListIter *iter;
+	r_th_rwlock_read_enter (anal->fcns_lock);
 	r_list_foreach (anal->fcns, iter, fcn) {
 		if (!strcmp (name, fcn->name)) {
-			return fcn;
+			ret = fcn;
+			break;
 		}
 	}
-	return NULL;
+	r_th_rwlock_read_leave (anal->fcns_lock);
+	return ret;
 }
 
 /* rename RAnalFunctionBB.add() */
@@ -1586,6 +1622,133 @@ R_API int r_anal_fcn_split_bb(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb, u
 	return R_ANAL_RET_NEW;
 }
 
+typedef struct {
+	ut64 addr;
+	ut64 end;
+	int count;
+	RList *fcns; // the functions with blocks marked, if not NULL
+} FcnDirty;
+
+static bool fcn_mark_dirty(RAnalFunction *fcn, void *user) {
+	FcnDirty *d = user;
+	RListIter *iter;
+	RAnalBlock *bb;
+	int count = d->count;
+	r_list_foreach (fcn->bbs, iter, bb) {
+		if (!bb->dirty && d->addr < bb->addr + bb->size && d->end > bb->addr) {
+			bb->dirty = true;
+			fcn->dirty++;
+			d->count++;
+		}
+	}
+	if (d->fcns && d->count > count) {
+		r_list_append (d->fcns, fcn);
+	}
+	return true;
+}
+
+static void fcn_invalidate(RAnal *anal, FcnDirty *d) {
+	RAnalFunction *fcn;
+	RListIter *iter;
+	r_th_rwlock_read_enter (anal->fcns_lock);
+	if (fcn_tree_synced (anal)) {
+		r_anal_fcn_tree_foreach_in (anal, d->addr, d->end, fcn_mark_dirty, d);
+	} else {
+		r_list_foreach (anal->fcns, iter, fcn) {
+			if (fcn->bbr.pairs > 0 && d->end > fcn->bbr.ranges[0]
+					&& d->addr < fcn->bbr.ranges[(fcn->bbr.pairs * 2) - 1]) {
+				fcn_mark_dirty (fcn, d);
+			}
+		}
+	}
+	r_th_rwlock_read_leave (anal->fcns_lock);
+}
+
+/* mark the basic blocks overlapping [addr, addr + len) as dirty after the
+ * bytes were patched, returns the number of blocks marked. This runs on
+ * every io write, so only the functions found in the index are visited */
+R_API int r_anal_fcn_invalidate(RAnal *anal, ut64 addr, int len) {
+	FcnDirty d = { addr, addr + len, 0, NULL };
+	if (!anal || len < 1) {
+		return 0;
+	}
+	fcn_invalidate (anal, &d);
+	return d.count;
+}
+
+/* like r_anal_fcn_invalidate, and then analyze again the blocks of the
+ * functions touched, so their blocks and refs follow the new bytes */
+R_API int r_anal_fcn_refresh(RAnal *anal, ut64 addr, int len) {
+	FcnDirty d = { addr, addr + len, 0, NULL };
+	RAnalFunction *fcn;
+	RListIter *iter;
+	if (!anal || len < 1 || !(d.fcns = r_list_new ())) {
+		return 0;
+	}
+	fcn_invalidate (anal, &d);
+	/* out of the lock, the analysis updates the index */
+	r_list_foreach (d.fcns, iter, fcn) {
+		r_anal_fcn_reanal_dirty (anal, fcn);
+	}
+	r_list_free (d.fcns);
+	return d.count;
+}
+
+/* forget the refs made from [from, to), the analysis adds them again */
+static void fcn_drop_refs(RAnal *anal, RAnalFunction *fcn, ut64 from, ut64 to) {
+#if FCN_OLD
+	RListIter *iter, *iter_tmp;
+	RAnalRef *ref;
+	r_list_foreach_safe (fcn->refs, iter, iter_tmp, ref) {
+		if (ref->at >= from && ref->at < to) {
+			r_anal_xrefs_deln (anal, ref->type, ref->at, ref->addr);
+			r_list_delete (fcn->refs, iter);
+		}
+	}
+#endif
+}
+
+/* drop the dirty basic blocks of the function and analyze again from their
+ * addresses, the rest of the graph is kept and split where needed */
+R_API int r_anal_fcn_reanal_dirty(RAnal *anal, RAnalFunction *fcn) {
+	RListIter *iter, *iter_tmp;
+	RAnalBlock *bb;
+	ut64 *addrs;
+	ut8 *buf;
+	int i, count = 0;
+	if (!anal || !fcn || !fcn->dirty) {
+		return 0;
+	}
+	addrs = R_NEWS (ut64, fcn->dirty);
+	buf = malloc (MAXBBSIZE);
+	if (!addrs || !buf) {
+		free (addrs);
+		free (buf);
+		return 0;
+	}
+	r_list_foreach_safe (fcn->bbs, iter, iter_tmp, bb) {
+		if (bb->dirty && count < fcn->dirty) {
+			addrs[count++] = bb->addr;
+			fcn->ninstr -= bb->ninstr;
+			fcn_drop_refs (anal, fcn, bb->addr, bb->addr + bb->size);
+			r_list_delete (fcn->bbs, iter);
+		}
+	}
+	fcn->dirty = 0;
+	r_anal_fcn_update_tinyrange_bbs (fcn);
+	for (i = 0; i < count; i++) {
+		if (bbget (fcn, addrs[i])) {
+			continue;
+		}
+		anal->iob.read_at (anal->iob.io, addrs[i], buf, MAXBBSIZE);
+		fcn_recurse (anal, fcn, addrs[i], buf, MAXBBSIZE, FCN_DEPTH);
+	}
+	r_anal_fcn_update_tinyrange_bbs (fcn);
+	free (addrs);
+	free (buf);
+	return count;
+}
+
 // TODO: rename fcn_bb_overlap()
 R_API int r_anal_fcn_bb_overlaps(RAnalFunction *fcn, RAnalBlock *bb) {
 	RAnalBlock *bbi;
@@ -1664,14 +1827,12 @@ R_API int r_anal_str_to_fcn(RAnal *a, RAnalFunction *f, const char *sig) {
 	return true;
 }
 
-R_API RAnalFunction *r_anal_get_fcn_at(RAnal *anal, ut64 addr, int type) {
-#if USE_NEW_FCN_STORE
-	// TODO: type is ignored here? wtf.. we need more work on fcnstore
-	// if (root) return r_listrange_find_root (anal->fcnstore, addr);
-	return r_listrange_find_root (anal->fcnstore, addr);
-#else
+static RAnalFunction *fcn_get_at(RAnal *anal, ut64 addr, int type) {
 	RAnalFunction *fcn, *ret = NULL;
 	RListIter *iter;
+	if (fcn_tree_synced (anal)) {
+		return r_anal_fcn_tree_find_at (anal, addr, type);
+	}
 	if (type == R_ANAL_FCN_TYPE_ROOT) {
 		r_list_foreach (anal->fcns, iter, fcn) {
 			if (addr == fcn->addr) {
@@ -1688,19 +1849,28 @@ R_API RAnalFunction *r_anal_get_fcn_at(RAnal *anal, ut64 addr, int type) {
 		}
 	}
 	return ret;
-#endif
+}
+
+R_API RAnalFunction *r_anal_get_fcn_at(RAnal *anal, ut64 addr, int type) {
+	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (anal->fcns_lock);
+	fcn = fcn_get_at (anal, addr, type);
+	r_th_rwlock_read_leave (anal->fcns_lock);
+	return fcn;
 }
 
 R_API RAnalFunction *r_anal_fcn_next(RAnal *anal, ut64 addr) {
 	RAnalFunction *fcni;
 	RListIter *iter;
 	RAnalFunction *closer = NULL;
+	r_th_rwlock_read_enter (anal->fcns_lock);
 	r_list_foreach (anal->fcns, iter, fcni) {
 		// if (fcni->addr == addr)
 		if (fcni->addr > addr && (!closer || fcni->addr < closer->addr)) {
 			closer = fcni;
 		}
 	}
+	r_th_rwlock_read_leave (anal->fcns_lock);
 	return closer;
 }
 
@@ -1736,11 +1906,13 @@ R_API int r_anal_fcn_count(RAnal *anal, ut64 from, ut64 to) {
 	int n = 0;
 	RAnalFunction *fcni;
 	RListIter *iter;
+	r_th_rwlock_read_enter (anal->fcns_lock);
 	r_list_foreach (anal->fcns, iter, fcni) {
 		if (fcni->addr >= from && fcni->addr < to) {
 			n++;
 		}
 	}
+	r_th_rwlock_read_leave (anal->fcns_lock);
 	return n;
 }
 
@@ -1776,6 +1948,7 @@ R_API bool r_anal_fcn_bbadd(RAnalFunction *fcn, RAnalBlock *bb) {
 R_API void r_anal_fcn_set_size(RAnalFunction *fcn, ut32 size) {
 	if (fcn) {
 		fcn->_size = size;
+		r_anal_fcn_tree_update (fcn);
 	}
 }
 
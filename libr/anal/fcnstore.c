@@ -1,125 +1,214 @@
-/* radare - LGPL - Copyright 2011 -- pancake<nopcode.org> */
-/* this file contains a test implementation of the ~O(1) function search */
-
-// TODO: REFACTOR: This must be a generic data structure named RListRange
-// TODO: We need a standard struct named Surface1D {.addr, .size}, so we can
-// simplify all this by just passing the offset of the field of the given ptr
-// TODO: RListComparator does not supports *user
-// TODO: RRef - reference counting
-
-#define RANGEBITS 10
-// 1024
-#define RANGE (1<<RANGEBITS)
+/* radare - LGPL - Copyright 2011-2017 -- pancake<nopcode.org> */
+/* function address index: an interval tree over the function bounds */
+
 #include <r_anal.h>
-#if USE_NEW_FCN_STORE
 
-#define STROFF(x) sdb_fmt (4, "flg.%"PFMT64x, x)
+#define FCN_CONTAINER(x) container_of ((RBNode *)x, RAnalFunction, rb)
 
-static int cmpfun(void *a, void *b) {
-	RAnalFunction *fa = (RAnalFunction*)a;
-	RAnalFunction *fb = (RAnalFunction*)b;
-	// TODO: swap sort order here or wtf?
-	return (fb->addr - fa->addr);
+/* smallest [from, to) range covering the entrypoint, the size and all the
+ * basic blocks of the function, so non-contiguous functions are found too */
+static void fcn_tree_bounds(RAnalFunction *fcn, ut64 *from, ut64 *to) {
+	ut64 min = fcn->addr;
+	ut64 max = (fcn->addr == UT64_MAX)? UT64_MAX: fcn->addr + 1;
+	if (fcn->_size > 0 && fcn->addr + fcn->_size > max) {
+		max = fcn->addr + fcn->_size;
+	}
+	if (fcn->bbr.pairs > 0) {
+		min = R_MIN (min, fcn->bbr.ranges[0]);
+		max = R_MAX (max, fcn->bbr.ranges[(fcn->bbr.pairs * 2) - 1]);
+	}
+	*from = min;
+	*to = max;
 }
 
-static void listrange_free_kv(HtKv *kv) {
-	free (kv->key);
-	r_list_free (kv->value);
-	free (kv);
+static int fcn_tree_cmp(const void *incoming, const RBNode *in_tree) {
+	const RAnalFunction *a = incoming;
+	const RAnalFunction *b = FCN_CONTAINER (in_tree);
+	if (a->rb_from != b->rb_from) {
+		return a->rb_from < b->rb_from? -1: 1;
+	}
+	if (a != b) {
+		return a < b? -1: 1;
+	}
+	return 0;
 }
 
-R_API RListRange* r_listrange_new () {
-	RListRange *s = R_NEW (RListRange);
-	s->h = ht_new (NULL, listrange_free_kv, NULL);
-	//s->l shouldn't free is a helper structure to get data in order
-	//s->h will free the list that contains RAnalFunction
-	s->l = r_list_new ();
-	return s;
+static void fcn_tree_calc_max_addr(RBNode *node) {
+	RAnalFunction *fcn = FCN_CONTAINER (node);
+	int i;
+	fcn->rb_max_addr = fcn->rb_to;
+	for (i = 0; i < 2; i++) {
+		if (node->child[i]) {
+			RAnalFunction *child = FCN_CONTAINER (node->child[i]);
+			if (child->rb_max_addr > fcn->rb_max_addr) {
+				fcn->rb_max_addr = child->rb_max_addr;
+			}
+		}
+	}
 }
 
-static inline ut64 r_listrange_next(ut64 addr) {
-	return (addr + RANGE);
+R_API void r_anal_fcn_tree_insert(RAnal *anal, RAnalFunction *fcn) {
+	if (!anal || !fcn || fcn->anal) {
+		return;
+	}
+	fcn_tree_bounds (fcn, &fcn->rb_from, &fcn->rb_to);
+	r_rbtree_aug_insert (&anal->fcn_tree, fcn, &fcn->rb, fcn_tree_cmp, fcn_tree_calc_max_addr);
+	fcn->anal = anal;
+	anal->fcn_tree_count++;
 }
 
-R_API void r_listrange_free(RListRange *s) {
-	if (!s) {
+R_API bool r_anal_fcn_tree_delete(RAnal *anal, RAnalFunction *fcn) {
+	if (!anal || !fcn || fcn->anal != anal) {
+		return false;
+	}
+	fcn->anal = NULL;
+	if (!r_rbtree_aug_delete (&anal->fcn_tree, fcn, fcn_tree_cmp, NULL, fcn_tree_calc_max_addr)) {
+		return false;
+	}
+	anal->fcn_tree_count--;
+	return true;
+}
+
+/* must be called every time the bounds of an indexed function change */
+R_API void r_anal_fcn_tree_update(RAnalFunction *fcn) {
+	RAnal *anal = fcn? fcn->anal: NULL;
+	ut64 from, to;
+	if (!anal) {
+		return;
+	}
+	fcn_tree_bounds (fcn, &from, &to);
+	if (from == fcn->rb_from && to == fcn->rb_to) {
 		return;
 	}
-	ht_free (s->h);
-	r_list_free (s->l);
-	free (s);
+	r_rbtree_aug_delete (&anal->fcn_tree, fcn, fcn_tree_cmp, NULL, fcn_tree_calc_max_addr);
+	fcn->rb_from = from;
+	fcn->rb_to = to;
+	r_rbtree_aug_insert (&anal->fcn_tree, fcn, &fcn->rb, fcn_tree_cmp, fcn_tree_calc_max_addr);
+}
+
+/* drop the whole index without touching the functions, used before
+ * freeing the function list at once */
+R_API void r_anal_fcn_tree_reset(RAnal *anal) {
+	RAnalFunction *fcn;
+	RListIter *iter;
+	r_list_foreach (anal->fcns, iter, fcn) {
+		if (fcn->anal == anal) {
+			fcn->anal = NULL;
+		}
+	}
+	anal->fcn_tree = NULL;
+	anal->fcn_tree_count = 0;
 }
 
-R_API void r_listrange_add(RListRange *s, RAnalFunction *f) {
-	ut64 addr;
-	RList *list;
-	ut64 from = f->addr;
-	ut64 to = f->addr + f->size;
-	for (addr = from; addr < to; addr = r_listrange_next (addr)) {
-		char *key = STROFF (addr);
-		list = ht_find (s->h, key, NULL);
-		if (list) {
-			if (!r_list_contains (list, f)) {
-				r_list_append (list, f);
+/* whether the index covers every function in anal->fcns. Functions appended
+ * to the list without r_anal_fcn_insert are indexed here, so it needs the
+ * write lock. The list does not always free what it drops (r_anal_get_fcns
+ * clears its free callback), so code removing a function from it deletes
+ * its node first. The callers walk the list if it still does not match */
+R_API bool r_anal_fcn_tree_sync(RAnal *anal) {
+	int count = r_list_length (anal->fcns);
+	if (anal->fcn_tree_count < count) {
+		RAnalFunction *fcn;
+		RListIter *iter;
+		r_list_foreach (anal->fcns, iter, fcn) {
+			if (!fcn->anal) {
+				r_anal_fcn_tree_insert (anal, fcn);
 			}
-		} else {
-			list = r_list_new ((RListFree)r_anal_fcn_free);
-			r_list_append (list, f);
-			ht_insert (s->h, key, list);
 		}
 	}
-	r_list_add_sorted (s->l, f, cmpfun);
+	return anal->fcn_tree_count == count;
 }
 
-R_API void r_listrange_del(RListRange *s, RAnalFunction *f) {
-	RList *list;
-	ut64 addr, from, to;
-	if (!f) return;
-	from = f->addr;
-	to = f->addr + f->size;
-	for (addr = from; addr < to; addr = r_listrange_next (addr)) {
-		list = ht_find (s->h, STROFF (addr), NULL);
-		if (list) {
-			r_list_delete_data (list, f);
+enum {
+	PROBE_AT,
+	PROBE_IN,
+	PROBE_IN_BOUNDS,
+};
+
+static RAnalFunction *fcn_tree_probe(RBNode *node, ut64 addr, int type, int mode) {
+	while (node) {
+		RAnalFunction *fcn = FCN_CONTAINER (node);
+		RAnalFunction *ret;
+		if (fcn->rb_max_addr <= addr) {
+			return NULL;
+		}
+		ret = fcn_tree_probe (node->child[0], addr, type, mode);
+		if (ret) {
+			return ret;
+		}
+		if (fcn->rb_from > addr) {
+			return NULL;
 		}
+		if (addr < fcn->rb_to && (!type || (fcn->type & type))) {
+			switch (mode) {
+			case PROBE_AT:
+				if (fcn->addr == addr) {
+					return fcn;
+				}
+				break;
+			case PROBE_IN:
+				if (r_anal_fcn_is_in_offset (fcn, addr)) {
+					return fcn;
+				}
+				break;
+			case PROBE_IN_BOUNDS:
+				if (r_anal_fcn_in (fcn, addr)) {
+					return fcn;
+				}
+				break;
+			}
+		}
+		node = node->child[1];
 	}
-	r_list_delete_data (s->l, f);
+	return NULL;
 }
 
-R_API void r_listrange_resize(RListRange *s, RAnalFunction *f, int newsize) {
-	if (!f) {
-		return;
+R_API RAnalFunction *r_anal_fcn_tree_find_at(RAnal *anal, ut64 addr, int type) {
+	if (type == R_ANAL_FCN_TYPE_ROOT) {
+		type = R_ANAL_FCN_TYPE_NULL;
 	}
-	r_listrange_del (s, f);
-	f->size = newsize;
-	r_listrange_add (s, f);
+	return fcn_tree_probe (anal->fcn_tree, addr, type, PROBE_AT);
 }
 
-R_API RAnalFunction *r_listrange_find_in_range(RListRange* s, ut64 addr) {
-	RAnalFunction *f;
-	RListIter *iter;
-	RList *list = ht_find (s->h, STROFF (addr), NULL);
-	if (list) {
-		r_list_foreach (list, iter, f) {
-			if (R_BETWEEN (f->addr, addr, f->addr + f->_size))
-				return f;
-		}
+R_API RAnalFunction *r_anal_fcn_tree_find_in(RAnal *anal, ut64 addr, int type) {
+	RAnalFunction *fcn = r_anal_fcn_tree_find_at (anal, addr, type);
+	if (fcn || type == R_ANAL_FCN_TYPE_ROOT) {
+		return fcn;
 	}
-	return NULL;
+	return fcn_tree_probe (anal->fcn_tree, addr, type, PROBE_IN);
 }
 
-R_API RAnalFunction *r_listrange_find_root(RListRange* s, ut64 addr) {
-	RAnalFunction *f;
-	RListIter *iter;
-	RList *list = ht_find (s->h, STROFF (addr), NULL);
-	if (list) {
-		r_list_foreach (list, iter, f) {
-			if (addr == f->addr) {
-				return f;
-			}
+R_API RAnalFunction *r_anal_fcn_tree_find_in_bounds(RAnal *anal, ut64 addr, int type) {
+	if (type == R_ANAL_FCN_TYPE_ROOT) {
+		return r_anal_fcn_tree_find_at (anal, addr, type);
+	}
+	return fcn_tree_probe (anal->fcn_tree, addr, type, PROBE_IN_BOUNDS);
+}
+
+static bool fcn_tree_walk(RBNode *node, ut64 from, ut64 to, RAnalFcnTreeCb cb, void *user) {
+	while (node) {
+		RAnalFunction *fcn = FCN_CONTAINER (node);
+		if (fcn->rb_max_addr <= from) {
+			return true;
+		}
+		if (!fcn_tree_walk (node->child[0], from, to, cb, user)) {
+			return false;
 		}
+		if (fcn->rb_from >= to) {
+			return true;
+		}
+		if (fcn->rb_to > from && !cb (fcn, user)) {
+			return false;
+		}
+		node = node->child[1];
 	}
-	return NULL;
+	return true;
 }
 
-#endif
+/* call cb for every indexed function whose bounds overlap [from, to) in
+ * address order, until it returns false */
+R_API void r_anal_fcn_tree_foreach_in(RAnal *anal, ut64 from, ut64 to, RAnalFcnTreeCb cb, void *user) {
+	if (anal && cb && from < to) {
+		fcn_tree_walk (anal->fcn_tree, from, to, cb, user);
+	}
+}
@@ -602,8 +602,8 @@ static int java_analyze_fns_from_buffer( RAnal *anal, ut64 start, ut64 end, int
 			// XXX - TO Stop or not to Stop ??
 			break;
 		}
-		//r_listrange_add (anal->fcnstore, fcn);
 		r_list_append (anal->fcns, fcn);
+		r_anal_fcn_tree_insert (anal, fcn);
 		offset += r_anal_fcn_size (fcn);
 		if (!analyze_all) break;
 	}
@@ -650,9 +650,9 @@ static int java_analyze_fns( RAnal *anal, ut64 start, ut64 end, int reftype, int
 					return result;
 					// XXX - TO Stop or not to Stop ??
 				}
-				//r_listrange_add (anal->fcnstore, fcn);
 				r_anal_fcn_update_tinyrange_bbs (fcn);
 				r_list_append (anal->fcns, fcn);
+				r_anal_fcn_tree_insert (anal, fcn);
 			}
 		} // End of methods loop
 	}// end of bin_objs list loop
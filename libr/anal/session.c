@@ -71,6 +71,7 @@ R_API void r_anal_esil_session_set(RAnalEsil *esil, RAnalEsilSession *session) {
 		if (esil->anal->reg->regset[i].arena->bytes) {
 			if (esil->anal->reg->regset[i].arena->size >= arena->size) {
 				memcpy (esil->anal->reg->regset[i].arena->bytes, arena->bytes, arena->size);
+				r_reg_arena_dirty (esil->anal->reg->regset[i].arena, 0, arena->size);
 			}
 		}
 	}
@@ -12,22 +12,19 @@ const char *getRealRef(RCore *core, ut64 off) {
 	RFlagItem *item = NULL;
 	RListIter *iter = NULL;
 
-	const RList *list = r_flag_get_list (core->flags, off);
-	if (!list) {
-		return NULL;
-	}
+	const char *name = NULL;
+	const RList *list;
 
+	r_th_rwlock_read_enter (core->flags->lock);
+	list = r_flag_get_list (core->flags, off);
 	r_list_foreach (list, iter, item) {
-		if (!item->name) {
-			continue;
-		}
-		if (strncmp (item->name, "sym.", 4)) {
-			continue;
+		if (item->name && !strncmp (item->name, "sym.", 4)) {
+			name = item->name;
+			break;
 		}
-		return item->name;
 	}
-
-	return NULL;
+	r_th_rwlock_read_leave (core->flags->lock);
+	return name;
 }
 
 R_API RList *r_sign_fcn_refs(RAnal *a, RAnalFunction *fcn) {
@@ -31,9 +31,16 @@ static void XREFKEY(char * const key, const size_t key_len,
 
 R_API bool r_anal_xrefs_save(RAnal *anal, const char *prjDir) {
 	char *xrefs_path = r_str_newf ("%s" R_SYS_DIR "xrefs.sdb", prjDir);
-	sdb_file (anal->sdb_xrefs, xrefs_path);
+	Sdb *db = anal->sdb_xrefs;
+	sdb_file (db, xrefs_path);
 	free (xrefs_path);
-	return sdb_sync (anal->sdb_xrefs);
+	/* a new journal starts with the file written whole, the next saves
+	 * only append the changes to it */
+	if (db->journal == -1 && sdb_journal_open (db)) {
+		sdb_journal_clear (db);
+		db->journal_rebase = true;
+	}
+	return sdb_sync (db);
 }
 
 R_API int r_anal_xrefs_set (RAnal *anal, const RAnalRefType type, ut64 from, ut64 to) {
@@ -67,19 +74,22 @@ R_API int r_anal_xrefs_deln (RAnal *anal, const RAnalRefType type, ut64 from, ut
 	return true;
 }
 
-static int _type = -1;
-static RList *_list = NULL;
-static char *_kpfx = NULL;
+typedef struct {
+	RAnalRefType type;
+	RList *list;
+	const char *kpfx;
+	int kpfx_len;
+} XrefsListAny;
 
-static int xrefs_list_cb_any(RAnal *anal, const char *k, const char *v) {
+static int xrefs_list_cb_any(XrefsListAny *ctx, const char *k, const char *v) {
 	//ut64 dst, src = r_num_get (NULL, v);
-	if (!strncmp (_kpfx, k, strlen (_kpfx))) {
+	if (!strncmp (ctx->kpfx, k, ctx->kpfx_len)) {
 		RAnalRef *ref = r_anal_ref_new ();
 		if (ref) {
-			ref->addr = r_num_get (NULL, k + strlen (_kpfx) + 1);
+			ref->addr = r_num_get (NULL, k + ctx->kpfx_len + 1);
 			ref->at = r_num_get (NULL, v); // XXX
-			ref->type = _type;
-			r_list_append (_list, ref);
+			ref->type = ctx->type;
+			r_list_append (ctx->list, ref);
 		}
 	}
 	return true;
@@ -89,11 +99,17 @@ R_API int r_anal_xrefs_from (RAnal *anal, RList *list, const char *kind, const R
 	char *next, *s, *str, *ptr, key[256];
 	RAnalRef *ref = NULL;
 	if (addr == UT64_MAX) {
-		_type = type;
-		_list = list;
-		_kpfx = r_str_newf ("xref.%s", analref_toString (type));
-		sdb_foreach (DB, (SdbForeachCallback)xrefs_list_cb_any, anal);
-		free (_kpfx);
+		/* the walk state lives on the stack, but sdb_foreach changes the
+		 * depth and the busy flag of the database, which is not locked */
+		XrefsListAny ctx = { type, list, NULL, 0 };
+		char *kpfx = r_str_newf ("xref.%s", analref_toString (type));
+		if (!kpfx) {
+			return false;
+		}
+		ctx.kpfx = kpfx;
+		ctx.kpfx_len = strlen (kpfx);
+		sdb_foreach (DB, (SdbForeachCallback)xrefs_list_cb_any, &ctx);
+		free (kpfx);
 		return true;
 	}
 	XREFKEY(key, sizeof (key), kind, type, addr);
@@ -731,6 +731,7 @@ R_API int r_bin_object_set_items(RBinFile *binfile, RBinObject *o) {
 	RBinPlugin *cp;
 	int i, minlen;
 	RBin *bin;
+	bool cached;
 	if (!binfile || !o || !o->plugin) {
 		return false;
 	}
@@ -765,7 +766,8 @@ R_API int r_bin_object_set_items(RBinFile *binfile, RBinObject *o) {
 			}
 		}
 	}
-	if (cp->entries) {
+	cached = r_bin_cache_load (binfile, o);
+	if (cp->entries && !cached) {
 		o->entries = cp->entries (binfile);
 		REBASE_PADDR (o, o->entries, RBinAddr);
 	}
@@ -798,7 +800,7 @@ R_API int r_bin_object_set_items(RBinFile *binfile, RBinObject *o) {
 	}
 	//}
 	o->info = cp->info? cp->info (binfile): NULL;
-	if (cp->libs) {
+	if (cp->libs && !cached) {
 		o->libs = cp->libs (binfile);
 	}
 	if (cp->sections) {
@@ -817,7 +819,7 @@ R_API int r_bin_object_set_items(RBinFile *binfile, RBinObject *o) {
 			REBASE_PADDR (o, o->relocs, RBinReloc);
 		}
 	}
-	if (bin->filter_rules & R_BIN_REQ_STRINGS) {
+	if ((bin->filter_rules & R_BIN_REQ_STRINGS) && !cached) {
 		if (cp->strings) {
 			o->strings = cp->strings (binfile);
 		} else {
@@ -857,6 +859,9 @@ R_API int r_bin_object_set_items(RBinFile *binfile, RBinObject *o) {
 	if (bin->filter_rules & (R_BIN_REQ_SYMBOLS | R_BIN_REQ_IMPORTS)) {
 		o->lang = r_bin_load_languages (binfile);
 	}
+	if (!cached) {
+		r_bin_cache_save (binfile, o);
+	}
 	binfile->o = old_o;
 	return true;
 }
@@ -1619,6 +1624,7 @@ R_API void *r_bin_free(RBin *bin) {
 	bin->file = NULL;
 	free (bin->force);
 	free (bin->srcdir);
+	free (bin->cache_dir);
 	//r_bin_free_bin_files (bin);
 	r_list_free (bin->binfiles);
 	r_list_free (bin->binxtrs);
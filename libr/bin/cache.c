@@ -0,0 +1,241 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+#include <r_bin.h>
+#include <sys/stat.h>
+
+/* on-disk cache of the parse results which only depend on the file contents
+ * and the loader settings (strings, entrypoints and libraries), stored as one
+ * sdb per file in bin.cache and keyed by the size, the modification time and
+ * a hash of some sampled blocks of the contents.
+ *
+ * Nothing else is cached. The plugins fill their own state while listing
+ * symbols, imports and relocs (the ELF reloc to import tables), the classes
+ * point to the symbols of the object and the DWARF lines are stored in the
+ * addrinfo sdb as they are parsed, so those callbacks run on every load */
+
+#define CACHE_BLOCK 0x1000
+#define CACHE_SAMPLES 32
+
+static ut32 hash_block(ut32 h, const ut8 *p, ut64 len) {
+	ut64 i;
+	for (i = 0; i < len; i++) {
+		h = (h + (h << 5)) ^ p[i];
+	}
+	return h;
+}
+
+/* hashing all the file would make every open as slow as the parse, so
+ * only the first and last blocks and some spread in between are read */
+static ut32 buf_hash(RBinFile *bf) {
+	const ut8 *p = r_buf_buffer (bf->buf);
+	ut64 i, size = r_buf_size (bf->buf);
+	ut32 h = CDB_HASHSTART;
+	if (!p) {
+		return 0;
+	}
+	if (size <= CACHE_BLOCK * CACHE_SAMPLES) {
+		return hash_block (h, p, size);
+	}
+	for (i = 0; i < CACHE_SAMPLES - 1; i++) {
+		ut64 at = (size - CACHE_BLOCK) / (CACHE_SAMPLES - 1) * i;
+		h = hash_block (h, p + at, CACHE_BLOCK);
+	}
+	return hash_block (h, p + size - CACHE_BLOCK, CACHE_BLOCK);
+}
+
+static ut64 file_mtime(RBinFile *bf) {
+	struct stat st;
+	if (!bf->file || stat (bf->file, &st)) {
+		return 0;
+	}
+	return (ut64)st.st_mtime;
+}
+
+static char *cache_key(RBinFile *bf, RBinObject *o) {
+	RBin *bin = bf->rbin;
+	if (!bf->buf || !r_buf_buffer (bf->buf)) {
+		return NULL;
+	}
+	return r_str_newf ("%08x.%"PFMT64x".%"PFMT64x".%s.%"PFMT64x".%"PFMT64x".%"PFMT64x
+		".%d.%d.%"PFMT64x".%d.%d.%d",
+		buf_hash (bf), r_buf_size (bf->buf), file_mtime (bf), o->plugin->name,
+		o->baddr, o->loadaddr, bf->offset,
+		bin->minstrlen, bin->maxstrlen, bin->maxstrbuf,
+		bf->rawstr, bin->debase64,
+		(bin->filter_rules & R_BIN_REQ_STRINGS)? 1: 0);
+}
+
+static char *cache_path(RBin *bin, const char *key) {
+	return r_str_newf ("%s"R_SYS_DIR"%08x.sdb", bin->cache_dir, sdb_hash (key));
+}
+
+static ut64 next_num(const char **p) {
+	char *end = NULL;
+	ut64 n = strtoull (*p, &end, 16);
+	*p = (end && *end == ',')? end + 1: end;
+	return n;
+}
+
+static RList *load_strings(Sdb *db) {
+	int i, count = sdb_num_get (db, "strings", 0);
+	RList *ret = r_list_newf (r_bin_string_free);
+	if (!ret) {
+		return NULL;
+	}
+	for (i = 0; i < count; i++) {
+		const char *p = sdb_const_get (db, sdb_fmt (0, "string.%d", i), 0);
+		RBinString *s;
+		if (!p || !(s = R_NEW0 (RBinString))) {
+			break;
+		}
+		s->vaddr = next_num (&p);
+		s->paddr = next_num (&p);
+		s->ordinal = next_num (&p);
+		s->size = next_num (&p);
+		s->length = next_num (&p);
+		s->type = next_num (&p);
+		s->string = (char *)sdb_decode (p, NULL);
+		if (!s->string) {
+			s->string = strdup ("");
+		}
+		r_list_append (ret, s);
+	}
+	return ret;
+}
+
+static RList *load_entries(Sdb *db) {
+	int i, count = sdb_num_get (db, "entries", 0);
+	RList *ret = r_list_newf (free);
+	if (!ret) {
+		return NULL;
+	}
+	for (i = 0; i < count; i++) {
+		const char *p = sdb_const_get (db, sdb_fmt (0, "entry.%d", i), 0);
+		RBinAddr *a;
+		if (!p || !(a = R_NEW0 (RBinAddr))) {
+			break;
+		}
+		a->vaddr = next_num (&p);
+		a->paddr = next_num (&p);
+		a->haddr = next_num (&p);
+		a->type = next_num (&p);
+		a->bits = next_num (&p);
+		r_list_append (ret, a);
+	}
+	return ret;
+}
+
+static RList *load_libs(Sdb *db) {
+	int i, count = sdb_num_get (db, "libs", 0);
+	RList *ret = r_list_newf (free);
+	if (!ret) {
+		return NULL;
+	}
+	for (i = 0; i < count; i++) {
+		const char *p = sdb_const_get (db, sdb_fmt (0, "lib.%d", i), 0);
+		char *lib = p? (char *)sdb_decode (p, NULL): NULL;
+		if (!lib) {
+			break;
+		}
+		r_list_append (ret, lib);
+	}
+	return ret;
+}
+
+/* fills o->strings, o->entries and o->libs from the cache, returns false
+ * when there is no valid entry for this file and settings */
+R_API bool r_bin_cache_load(RBinFile *bf, RBinObject *o) {
+	RBin *bin = bf? bf->rbin: NULL;
+	char *key, *path;
+	const char *k;
+	Sdb *db;
+	if (!bin || !bin->cache_dir || !o || !o->plugin) {
+		return false;
+	}
+	if (!(key = cache_key (bf, o))) {
+		return false;
+	}
+	path = cache_path (bin, key);
+	if (!r_file_exists (path)) {
+		free (path);
+		free (key);
+		return false;
+	}
+	db = sdb_new (NULL, path, 0);
+	free (path);
+	k = db? sdb_const_get (db, "key", 0): NULL;
+	if (!k || strcmp (k, key)) {
+		sdb_free (db);
+		free (key);
+		return false;
+	}
+	free (key);
+	if (sdb_const_get (db, "strings", 0)) {
+		r_list_free (o->strings);
+		o->strings = load_strings (db);
+	}
+	r_list_free (o->entries);
+	o->entries = load_entries (db);
+	r_list_free (o->libs);
+	o->libs = load_libs (db);
+	sdb_free (db);
+	return true;
+}
+
+R_API bool r_bin_cache_save(RBinFile *bf, RBinObject *o) {
+	RBin *bin = bf? bf->rbin: NULL;
+	RListIter *iter;
+	RBinString *s;
+	RBinAddr *a;
+	char *key, *path, *b64, *val, *lib;
+	Sdb *db;
+	int i;
+	if (!bin || !bin->cache_dir || !o || !o->plugin) {
+		return false;
+	}
+	if (!(key = cache_key (bf, o))) {
+		return false;
+	}
+	if (!r_file_is_directory (bin->cache_dir) && !r_sys_mkdirp (bin->cache_dir)) {
+		free (key);
+		return false;
+	}
+	path = cache_path (bin, key);
+	db = sdb_new (NULL, path, 0);
+	free (path);
+	if (!db) {
+		free (key);
+		return false;
+	}
+	sdb_reset (db);
+	sdb_set (db, "key", key, 0);
+	free (key);
+	if (o->strings && (bin->filter_rules & R_BIN_REQ_STRINGS)) {
+		i = 0;
+		r_list_foreach (o->strings, iter, s) {
+			b64 = sdb_encode ((const ut8 *)s->string, -1);
+			val = r_str_newf ("%"PFMT64x",%"PFMT64x",%x,%x,%x,%x,%s",
+				s->vaddr, s->paddr, s->ordinal, s->size,
+				s->length, (ut8)s->type, b64? b64: "");
+			sdb_set_owned (db, sdb_fmt (0, "string.%d", i++), val, 0);
+			free (b64);
+		}
+		sdb_num_set (db, "strings", i, 0);
+	}
+	i = 0;
+	r_list_foreach (o->entries, iter, a) {
+		sdb_set (db, sdb_fmt (0, "entry.%d", i++),
+			sdb_fmt (1, "%"PFMT64x",%"PFMT64x",%"PFMT64x",%x,%x",
+				a->vaddr, a->paddr, a->haddr, a->type, a->bits), 0);
+	}
+	sdb_num_set (db, "entries", i, 0);
+	i = 0;
+	r_list_foreach (o->libs, iter, lib) {
+		b64 = sdb_encode ((const ut8 *)lib, -1);
+		sdb_set_owned (db, sdb_fmt (0, "lib.%d", i++), b64? b64: strdup (""), 0);
+	}
+	sdb_num_set (db, "libs", i, 0);
+	sdb_sync (db);
+	sdb_free (db);
+	return true;
+}
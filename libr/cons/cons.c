@@ -510,6 +510,7 @@ R_API void r_cons_reset() {
 	R_FREE (I.grep.str);
 	ZERO_FILL (I.grep.tokens);
 	I.grep.tokens_used = 0;
+	I.grep.stream_pos = 0;
 }
 
 R_API const char *r_cons_get_buffer() {
@@ -519,7 +520,9 @@ R_API const char *r_cons_get_buffer() {
 
 R_API void r_cons_filter() {
 	/* grep */
-	if (I.filter || I.grep.nstrings > 0 || I.grep.tokens_used || I.grep.less || I.grep.json) {
+	if (r_cons_grep_stream_enabled ()) {
+		r_cons_grep_stream (true);
+	} else if (I.filter || I.grep.nstrings > 0 || I.grep.tokens_used || I.grep.less || I.grep.json) {
 		r_cons_grepbuf (I.buffer, I.buffer_len);
 		I.filter = false;
 	}
@@ -562,6 +565,7 @@ R_API void r_cons_push() {
 		}
 		r_stack_push (I.cons_stack, data);
 		I.buffer_len = 0;
+		I.grep.stream_pos = 0;
 		if (I.buffer) {
 			memset (I.buffer, 0, I.buffer_sz);
 		}
@@ -823,6 +827,9 @@ club:
 		}
 		I.buffer_len += written;
 		I.buffer[I.buffer_len] = 0;
+		if (r_cons_grep_stream_enabled () && memchr (I.buffer + I.buffer_len - written, '\n', written)) {
+			r_cons_grep_stream (false);
+		}
 	} else {
 		r_cons_strcat (format);
 	}
@@ -862,6 +869,9 @@ R_API int r_cons_memcat(const char *str, int len) {
 			memcpy (I.buffer + I.buffer_len, str, len);
 			I.buffer_len += len;
 			I.buffer[I.buffer_len] = 0;
+			if (r_cons_grep_stream_enabled () && memchr (str, '\n', len)) {
+				r_cons_grep_stream (false);
+			}
 		}
 	}
 	if (I.flush) {
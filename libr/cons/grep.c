@@ -284,6 +284,12 @@ while_end:
 		cons->grep.nstrings++;
 		cons->grep.strings[0][0] = 0;
 	}
+	if (cons->grep.icase) {
+		int i;
+		for (i = 0; i < cons->grep.nstrings; i++) {
+			r_str_case (cons->grep.strings[i], false);
+		}
+	}
 }
 
 // Finds and returns next intgerp expression,
@@ -612,6 +618,69 @@ R_API int r_cons_grepbuf(char *buf, int len) {
 	return cons->lines;
 }
 
+/* Plain word and column greps only depend on the line being filtered,
+ * so they can be applied while the output is being generated instead of
+ * waiting for the whole buffer. Line ranges, sorting, counters, json and
+ * less still need the complete output and go through r_cons_grepbuf. */
+R_API bool r_cons_grep_stream_enabled(void) {
+	RCons *cons = r_cons_singleton ();
+	RConsGrep *grep = &cons->grep;
+	/* nested buffers (r_cons_push) are filtered as a whole by their owner */
+	if (cons->filter || (cons->cons_stack && !r_stack_is_empty (cons->cons_stack))) {
+		return false;
+	}
+	if (grep->nstrings < 1 && !grep->tokens_used) {
+		return false;
+	}
+	return !grep->json && !grep->less && !grep->counter
+		&& grep->sort == -1 && grep->range_line == 2;
+}
+
+/* Filters in place every complete line appended to the buffer since the
+ * last call, dropping the ones not matching. When final is set the
+ * trailing line without newline is filtered too. */
+R_API void r_cons_grep_stream(bool final) {
+	RCons *cons = r_cons_singleton ();
+	char *buf = cons->buffer;
+	int end = cons->buffer_len;
+	int pos, out, tail;
+	if (!buf) {
+		return;
+	}
+	pos = out = R_MIN (cons->grep.stream_pos, end);
+	while (pos < end) {
+		char *line = buf + pos;
+		char *nl = memchr (line, '\n', end - pos);
+		int ret, l;
+		if (!nl && !final) {
+			break;
+		}
+		l = nl? nl - line: end - pos;
+		if (l > 0) {
+			ret = r_str_ansi_filter (line, NULL, NULL, l);
+			if (ret > 0) {
+				ret = r_cons_grep_line (line, ret);
+			}
+			if (ret > 0) {
+				memmove (buf + out, line, ret);
+				out += ret;
+				if (nl) {
+					buf[out++] = '\n';
+				}
+				cons->lines++;
+			}
+		}
+		pos += l + 1;
+	}
+	tail = (pos < end)? end - pos: 0;
+	if (tail > 0 && out != pos) {
+		memmove (buf + out, buf + pos, tail);
+	}
+	cons->grep.stream_pos = out;
+	cons->buffer_len = out + tail;
+	buf[cons->buffer_len] = 0;
+}
+
 R_API int r_cons_grep_line(char *buf, int len) {
 	RCons *cons = r_cons_singleton ();
 	const char *delims = " |,;=\t";
@@ -638,10 +707,6 @@ R_API int r_cons_grep_line(char *buf, int len) {
 			r_str_case (in, false);
 		}
 		for (i = 0; i < cons->grep.nstrings; i++) {
-			char *str = cons->grep.strings[i];
-			if (cons->grep.icase) {
-				r_str_case (str, false);
-			}
 			char *p = strstr (in, cons->grep.strings[i]);
 			if (!p) {
 				ampfail = 0;
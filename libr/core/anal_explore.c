@@ -0,0 +1,443 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+/* esil path exploration: the emulator state is forked at every conditional
+ * branch and the paths are run one after the other, the ones reaching code
+ * not covered yet go first */
+
+#include <r_core.h>
+
+#define EXPLORE_PAGE 4096
+
+enum {
+	EXPLORE_END_STEPS,
+	EXPLORE_END_UNTIL,
+	EXPLORE_END_TRAP,
+	EXPLORE_END_INVALID,
+	EXPLORE_END_BREAK,
+};
+
+static const char *explore_end_str[] = { "steps", "until", "trap", "invalid", "break" };
+
+/* memory written by a path lives in overlay pages, forked states share them
+ * until one of them writes again */
+typedef struct {
+	ut64 addr;
+	int refs;
+	ut8 data[EXPLORE_PAGE];
+} ExplorePage;
+
+typedef struct {
+	int id;
+	int parent;
+	ut64 from; // pc the path starts at
+	ut64 fork; // branch it was forked at
+	ut8 *regs;
+	int regs_size;
+	ExplorePage **pages; // sorted by address
+	int npages;
+} ExploreState;
+
+typedef struct {
+	RCore *core;
+	ExploreState *cur;
+	RList *fresh; // states starting at code not covered yet
+	RList *stale;
+	int nstates;
+	int maxstates;
+	int maxsteps;
+	ut64 until;
+	ut64 *covered; // open addressing set of emulated addresses
+	int ncovered;
+	int covered_size;
+} ExploreCtx;
+
+static void explore_page_unref(ExplorePage *page) {
+	if (page && --page->refs < 1) {
+		free (page);
+	}
+}
+
+static void explore_state_free(ExploreState *st) {
+	int i;
+	if (!st) {
+		return;
+	}
+	for (i = 0; i < st->npages; i++) {
+		explore_page_unref (st->pages[i]);
+	}
+	free (st->pages);
+	free (st->regs);
+	free (st);
+}
+
+static ut32 explore_hash(ut64 addr) {
+	addr ^= addr >> 33;
+	addr *= 0xff51afd7ed558ccdULL;
+	addr ^= addr >> 33;
+	return (ut32)addr;
+}
+
+static bool explore_is_covered(ExploreCtx *ctx, ut64 addr) {
+	ut32 mask = ctx->covered_size - 1;
+	ut32 i = explore_hash (addr) & mask;
+	while (ctx->covered[i] != UT64_MAX) {
+		if (ctx->covered[i] == addr) {
+			return true;
+		}
+		i = (i + 1) & mask;
+	}
+	return false;
+}
+
+static bool explore_cover(ExploreCtx *ctx, ut64 addr) {
+	ut32 mask, i;
+	if (addr == UT64_MAX) {
+		return false;
+	}
+	if ((ctx->ncovered + 1) * 2 > ctx->covered_size) {
+		int j, size = ctx->covered_size * 2;
+		ut64 *old = ctx->covered;
+		ut64 *set = malloc (size * sizeof (ut64));
+		if (!set) {
+			return false;
+		}
+		memset (set, 0xff, size * sizeof (ut64));
+		ctx->covered = set;
+		ctx->covered_size = size;
+		ctx->ncovered = 0;
+		for (j = 0; j < size / 2; j++) {
+			if (old[j] != UT64_MAX) {
+				explore_cover (ctx, old[j]);
+			}
+		}
+		free (old);
+	}
+	mask = ctx->covered_size - 1;
+	i = explore_hash (addr) & mask;
+	while (ctx->covered[i] != UT64_MAX) {
+		if (ctx->covered[i] == addr) {
+			return false;
+		}
+		i = (i + 1) & mask;
+	}
+	ctx->covered[i] = addr;
+	ctx->ncovered++;
+	return true;
+}
+
+/* index of the page at addr, or where it should be inserted as -(idx + 1) */
+static int explore_page_find(ExploreState *st, ut64 addr) {
+	int lo = 0, hi = st->npages;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		ut64 a = st->pages[mid]->addr;
+		if (a == addr) {
+			return mid;
+		}
+		if (a < addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return -(lo + 1);
+}
+
+/* page at addr owned only by this state, created or copied if needed */
+static ExplorePage *explore_page_own(ExploreCtx *ctx, ExploreState *st, ut64 addr) {
+	int idx = explore_page_find (st, addr);
+	ExplorePage *page;
+	if (idx >= 0) {
+		page = st->pages[idx];
+		if (page->refs > 1) {
+			ExplorePage *copy = malloc (sizeof (ExplorePage));
+			if (!copy) {
+				return NULL;
+			}
+			memcpy (copy, page, sizeof (ExplorePage));
+			copy->refs = 1;
+			page->refs--;
+			st->pages[idx] = page = copy;
+		}
+		return page;
+	}
+	idx = -idx - 1;
+	if (!(st->npages & 15)) {
+		ExplorePage **pages = realloc (st->pages, (st->npages + 16) * sizeof (ExplorePage *));
+		if (!pages) {
+			return NULL;
+		}
+		st->pages = pages;
+	}
+	if (!(page = malloc (sizeof (ExplorePage)))) {
+		return NULL;
+	}
+	page->addr = addr;
+	page->refs = 1;
+	r_io_read_at (ctx->core->io, addr, page->data, EXPLORE_PAGE);
+	memmove (st->pages + idx + 1, st->pages + idx, (st->npages - idx) * sizeof (ExplorePage *));
+	st->pages[idx] = page;
+	st->npages++;
+	return page;
+}
+
+/* read through the overlay of the state, false if none of the bytes is in it */
+static bool explore_read(ExploreCtx *ctx, ExploreState *st, ut64 addr, ut8 *buf, int len) {
+	bool hit = false;
+	int i = 0;
+	while (i < len) {
+		ut64 a = addr + i;
+		ut64 base = a - (a % EXPLORE_PAGE);
+		int delta = a - base;
+		int n = R_MIN (len - i, EXPLORE_PAGE - delta);
+		int idx = explore_page_find (st, base);
+		if (idx >= 0) {
+			if (!hit) {
+				r_io_read_at (ctx->core->io, addr, buf, len);
+				hit = true;
+			}
+			memcpy (buf + i, st->pages[idx]->data + delta, n);
+		}
+		i += n;
+	}
+	return hit;
+}
+
+static int explore_mem_read(RAnalEsil *esil, ut64 addr, ut8 *buf, int len) {
+	ExploreCtx *ctx = esil->user;
+	return explore_read (ctx, ctx->cur, addr, buf, len)? len: 0;
+}
+
+static int explore_mem_write(RAnalEsil *esil, ut64 addr, const ut8 *buf, int len) {
+	ExploreCtx *ctx = esil->user;
+	int i = 0;
+	while (i < len) {
+		ut64 a = addr + i;
+		ut64 base = a - (a % EXPLORE_PAGE);
+		int delta = a - base;
+		int n = R_MIN (len - i, EXPLORE_PAGE - delta);
+		ExplorePage *page = explore_page_own (ctx, ctx->cur, base);
+		if (!page) {
+			break;
+		}
+		memcpy (page->data + delta, buf + i, n);
+		i += n;
+	}
+	return 1; // never reaches io
+}
+
+/* queue a copy of the current state resuming at pc */
+static void explore_fork(ExploreCtx *ctx, ut64 at, ut64 pc) {
+	RReg *reg = ctx->core->anal->reg;
+	const char *pcname = r_reg_get_name (reg, R_REG_NAME_PC);
+	ExploreState *st, *cur = ctx->cur;
+	ut64 oldpc;
+	int i;
+	if (ctx->nstates >= ctx->maxstates || pc == UT64_MAX) {
+		return;
+	}
+	if (!(st = R_NEW0 (ExploreState))) {
+		return;
+	}
+	oldpc = r_reg_getv (reg, pcname);
+	r_reg_setv (reg, pcname, pc);
+	st->regs = r_reg_get_bytes (reg, -1, &st->regs_size);
+	r_reg_setv (reg, pcname, oldpc);
+	if (cur->npages > 0) {
+		st->pages = malloc (((cur->npages + 15) & ~15) * sizeof (ExplorePage *));
+		if (!st->pages) {
+			explore_state_free (st);
+			return;
+		}
+		for (i = 0; i < cur->npages; i++) {
+			st->pages[i] = cur->pages[i];
+			st->pages[i]->refs++;
+		}
+		st->npages = cur->npages;
+	}
+	if (!st->regs) {
+		explore_state_free (st);
+		return;
+	}
+	st->id = ctx->nstates++;
+	st->parent = cur->id;
+	st->from = pc;
+	st->fork = at;
+	r_list_append (explore_is_covered (ctx, pc)? ctx->stale: ctx->fresh, st);
+}
+
+static ExploreState *explore_next(ExploreCtx *ctx) {
+	ExploreState *st;
+	while ((st = r_list_pop_head (ctx->fresh))) {
+		if (!explore_is_covered (ctx, st->from)) {
+			return st;
+		}
+		r_list_append (ctx->stale, st);
+	}
+	return r_list_pop_head (ctx->stale);
+}
+
+static int explore_run(ExploreCtx *ctx, ExploreState *st, ut64 *end, int *steps) {
+	RCore *core = ctx->core;
+	RAnal *anal = core->anal;
+	RAnalEsil *esil = anal->esil;
+	const char *pcname = r_reg_get_name (anal->reg, R_REG_NAME_PC);
+	RAnalOp op = {0};
+	ut8 code[32];
+	int ret = EXPLORE_END_STEPS;
+	ut64 pc = st->from;
+
+	ctx->cur = st;
+	r_reg_read_regs (anal->reg, st->regs, st->regs_size);
+	r_reg_setv (anal->reg, pcname, pc);
+	esil->trap = 0;
+	for (*steps = 0; *steps < ctx->maxsteps; (*steps)++) {
+		ut64 js = 0, next;
+		if (r_cons_is_breaked ()) {
+			ret = EXPLORE_END_BREAK;
+			break;
+		}
+		if (pc == ctx->until) {
+			ret = EXPLORE_END_UNTIL;
+			break;
+		}
+		if (!r_io_is_valid_offset (core->io, pc, 0)) {
+			ret = EXPLORE_END_INVALID;
+			break;
+		}
+		explore_cover (ctx, pc);
+		if (!explore_read (ctx, st, pc, code, sizeof (code))) {
+			r_io_read_at (core->io, pc, code, sizeof (code));
+		}
+		r_anal_op_fini (&op);
+		if (r_anal_op (anal, &op, pc, code, sizeof (code)) < 1 || op.size < 1) {
+			ret = EXPLORE_END_INVALID;
+			break;
+		}
+		// r_anal_op can replace the esil instance
+		esil = anal->esil;
+		r_reg_setv (anal->reg, pcname, pc + op.size);
+		r_anal_esil_set_pc (esil, pc);
+		r_anal_esil_parse (esil, R_STRBUF_SAFEGET (&op.esil));
+		r_anal_esil_stack_free (esil);
+		r_anal_esil_reg_read (esil, "$js", &js, NULL);
+		if (js) {
+			ut64 jt = 0;
+			r_anal_esil_reg_read (esil, "$jt", &jt, NULL);
+			r_anal_esil_reg_write (esil, "$js", 0);
+			r_reg_setv (anal->reg, pcname, jt);
+		}
+		if (esil->trap) {
+			ret = EXPLORE_END_TRAP;
+			break;
+		}
+		next = r_reg_getv (anal->reg, pcname);
+		if ((op.type & R_ANAL_OP_TYPE_MASK) == R_ANAL_OP_TYPE_CJMP
+				&& op.jump != UT64_MAX && op.fail != UT64_MAX) {
+			/* the emulation took one side, the other one is forked */
+			explore_fork (ctx, pc, (next == op.jump)? op.fail: op.jump);
+		}
+		pc = next;
+	}
+	r_anal_op_fini (&op);
+	*end = pc;
+	return ret;
+}
+
+/* explore the paths starting at the current esil state, until is the address
+ * to reach or UT64_MAX. Returns the number of paths reaching it */
+R_API int r_core_anal_explore(RCore *core, ut64 until, int maxpaths, int maxsteps, int mode) {
+	RAnal *anal = core->anal;
+	RAnalEsil *esil = anal->esil;
+	const char *pcname = r_reg_get_name (anal->reg, R_REG_NAME_PC);
+	ExploreCtx ctx = {0};
+	ExploreState *st;
+	RAnalEsilCallbacks cb;
+	void *user;
+	int hits = 0, npaths = 0;
+	bool first = true;
+
+	if (!esil) {
+		eprintf ("ESIL not initialized, run aei first\n");
+		return -1;
+	}
+	if (!pcname) {
+		eprintf ("Cannot find program counter register in the current profile.\n");
+		return -1;
+	}
+	ctx.core = core;
+	ctx.until = until;
+	ctx.maxstates = R_MAX (maxpaths, 1);
+	ctx.maxsteps = R_MAX (maxsteps, 1);
+	ctx.fresh = r_list_newf ((RListFree)explore_state_free);
+	ctx.stale = r_list_newf ((RListFree)explore_state_free);
+	ctx.covered_size = 1024;
+	ctx.covered = malloc (ctx.covered_size * sizeof (ut64));
+	st = R_NEW0 (ExploreState);
+	if (!ctx.fresh || !ctx.stale || !ctx.covered || !st) {
+		free (st);
+		goto beach;
+	}
+	memset (ctx.covered, 0xff, ctx.covered_size * sizeof (ut64));
+	st->from = r_reg_getv (anal->reg, pcname);
+	st->fork = UT64_MAX;
+	st->parent = -1;
+	st->regs = r_reg_get_bytes (anal->reg, -1, &st->regs_size);
+	if (!st->regs) {
+		explore_state_free (st);
+		goto beach;
+	}
+	ctx.nstates = 1;
+	r_list_append (ctx.fresh, st);
+
+	user = esil->user;
+	cb = esil->cb;
+	esil->user = &ctx;
+	esil->cb.hook_mem_read = explore_mem_read;
+	esil->cb.hook_mem_write = explore_mem_write;
+	r_reg_arena_push (anal->reg);
+	r_cons_break_push (NULL, NULL);
+	if (mode == 'j') {
+		r_cons_printf ("{\"paths\":[");
+	}
+	while ((st = explore_next (&ctx))) {
+		ut64 end = UT64_MAX;
+		int steps = 0;
+		int res = explore_run (&ctx, st, &end, &steps);
+		npaths++;
+		if (res == EXPLORE_END_UNTIL) {
+			hits++;
+		}
+		if (mode == 'j') {
+			r_cons_printf ("%s{\"id\":%d,\"parent\":%d,\"fork\":%"PFMT64d
+				",\"from\":%"PFMT64d",\"end\":%"PFMT64d",\"steps\":%d,\"reason\":\"%s\"}",
+				first? "": ",", st->id, st->parent, st->fork, st->from,
+				end, steps, explore_end_str[res]);
+		} else if (mode != 'q' || res == EXPLORE_END_UNTIL) {
+			r_cons_printf ("path %d parent %d fork 0x%08"PFMT64x" from 0x%08"PFMT64x
+				" end 0x%08"PFMT64x" steps %d %s\n", st->id, st->parent,
+				st->fork, st->from, end, steps, explore_end_str[res]);
+		}
+		first = false;
+		explore_state_free (st);
+		if (res == EXPLORE_END_BREAK) {
+			break;
+		}
+	}
+	if (mode == 'j') {
+		r_cons_printf ("],\"covered\":%d,\"hits\":%d}\n", ctx.ncovered, hits);
+	} else if (mode != 'q') {
+		r_cons_printf ("%d paths, %d instructions covered, %d reached 0x%08"PFMT64x"\n",
+			npaths, ctx.ncovered, hits, until);
+	}
+	r_cons_break_pop ();
+	r_reg_arena_pop (anal->reg);
+	esil = anal->esil;
+	esil->user = user;
+	esil->cb.hook_mem_read = cb.hook_mem_read;
+	esil->cb.hook_mem_write = cb.hook_mem_write;
+beach:
+	r_list_free (ctx.fresh);
+	r_list_free (ctx.stale);
+	free (ctx.covered);
+	return hits;
+}
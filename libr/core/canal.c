@@ -49,8 +49,6 @@ static char *getFunctionName(RCore *core, ut64 addr) {
 	return NULL;
 }
 
-static RCore *mycore = NULL;
-
 // XXX: copypaste from anal/data.c
 #define MINLEN 1
 static int is_string (const ut8 *buf, int size, int *len) {
@@ -269,6 +267,7 @@ R_API ut64 r_core_anal_address(RCore *core, ut64 addr) {
 R_API void r_core_anal_autoname_all_fcns(RCore *core) {
 	RListIter *it;
 	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, it, fcn) {
 		char *name = r_core_anal_fcn_autoname (core, fcn->addr, 0);
 		if (name && (!strncmp (fcn->name, "method.", 7) || \
@@ -281,6 +280,7 @@ R_API void r_core_anal_autoname_all_fcns(RCore *core) {
 			free (name);
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 }
 
 static bool blacklisted_word(char* name) {
@@ -1295,14 +1295,19 @@ R_API ut64 r_core_anal_get_bbaddr(RCore *core, ut64 addr) {
 	RAnalBlock *bbi;
 	RAnalFunction *fcni;
 	RListIter *iter, *iter2;
+	ut64 ret = UT64_MAX;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcni) {
 		r_list_foreach (fcni->bbs, iter2, bbi) {
 			if (addr >= bbi->addr && addr < bbi->addr + bbi->size) {
-				return bbi->addr;
+				ret = bbi->addr;
+				goto out;
 			}
 		}
 	}
-	return UT64_MAX;
+out:
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
+	return ret;
 }
 
 /* seek basic block that contains address addr or just addr if there's no such
@@ -1342,8 +1347,13 @@ R_API int r_core_anal_esil_fcn(RCore *core, ut64 at, ut64 from, int reftype, int
  * If the function has been already analyzed, it adds a
  * reference to that fcn */
 R_API int r_core_anal_fcn(RCore *core, ut64 at, ut64 from, int reftype, int depth) {
-	if (from == UT64_MAX && r_anal_get_fcn_in (core->anal, at, 0)) {
-		return 0;
+	if (from == UT64_MAX) {
+		RAnalFunction *fcn = r_anal_get_fcn_in (core->anal, at, 0);
+		if (fcn) {
+			// only the blocks patched since the last analysis
+			r_anal_fcn_reanal_dirty (core->anal, fcn);
+			return 0;
+		}
 	}
 
 	bool use_esil = r_config_get_i (core->config, "anal.esil");
@@ -1375,9 +1385,11 @@ R_API int r_core_anal_fcn(RCore *core, ut64 at, ut64 from, int reftype, int dept
 		result = core->anal->cur->analyze_fns (core->anal, at, from, reftype, depth);
 		/* update the flags after running the analysis function of the plugin */
 		r_flag_space_push (core->flags, "functions");
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcn) {
 			r_flag_set (core->flags, fcn->name, fcn->addr, r_anal_fcn_size (fcn));
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 		r_flag_space_pop (core->flags);
 		return result;
 	}
@@ -1394,6 +1406,7 @@ R_API int r_core_anal_fcn(RCore *core, ut64 at, ut64 from, int reftype, int dept
 	fcn = r_anal_get_fcn_in (core->anal, at, 0);
 	if (fcn) {
 		if (fcn->addr == at) {
+			r_anal_fcn_reanal_dirty (core->anal, fcn);
 			return 0;  // already analyzed function
 		}
 		if (r_anal_fcn_is_in_offset (fcn, from)) { // inner function
@@ -1450,19 +1463,24 @@ R_API int r_core_anal_fcn(RCore *core, ut64 at, ut64 from, int reftype, int dept
 R_API int r_core_anal_fcn_clean(RCore *core, ut64 addr) {
 	RAnalFunction *fcni;
 	RListIter *iter, *iter_tmp;
+	bool ret = true;
 
+	r_th_rwlock_write_enter (core->anal->fcns_lock);
 	if (!addr) {
+		r_anal_fcn_tree_reset (core->anal);
 		r_list_purge (core->anal->fcns);
 		if (!(core->anal->fcns = r_anal_fcn_list_new ()))
-			return false;
+			ret = false;
 	} else {
 		r_list_foreach_safe (core->anal->fcns, iter, iter_tmp, fcni) {
 			if (r_anal_fcn_in (fcni, addr)) {
+				r_anal_fcn_tree_delete (core->anal, fcni);
 				r_list_delete (core->anal->fcns, iter);
 			}
 		}
 	}
-	return true;
+	r_th_rwlock_write_leave (core->anal->fcns_lock);
+	return ret;
 }
 
 R_API void r_core_anal_codexrefs(RCore *core, ut64 addr, int fmt) {
@@ -1528,6 +1546,7 @@ R_API void r_core_anal_coderefs(RCore *core, ut64 addr, int fmt) {
 	ut64 base = UT64_MAX;
 	int iteration = 0;
 repeat:
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcni) {
 		if (base == UT64_MAX) {
 			base = fcni->addr;
@@ -1693,6 +1712,7 @@ repeat:
 			r_cons_printf ("]}");
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	if (iteration == 0 && fmt == 1 && isGML) {
 		iteration++;
 		if (!gmlFcnGraph) {
@@ -1750,9 +1770,11 @@ R_API int r_core_anal_fcn_list_size(RCore *core) {
 	RListIter *iter;
 	ut32 total = 0;
 
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		total += r_anal_fcn_size (fcn);
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	r_cons_printf ("%d\n", total);
 	return total;
 }
@@ -2214,11 +2236,13 @@ R_API int r_core_anal_fcn_list(RCore *core, const char *input, const char *rad)
 	}
 	RListIter *iter;
 	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		if (!input || r_anal_fcn_in (fcn, addr) || (!strcmp (name, fcn->name))) {
 			r_list_append (fcns, fcn);
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 
 	r_list_sort (fcns, &cmpfcn);
 	switch (*rad) {
@@ -2334,6 +2358,7 @@ R_API RList* r_core_anal_graph_to(RCore *core, ut64 addr, int n) {
 	RList *list2 = NULL, *list = NULL;
 	RAnalFunction *fcn;
 
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		if (!r_anal_fcn_is_in_offset (fcn, core->offset)) {
 			continue;
@@ -2348,6 +2373,7 @@ R_API RList* r_core_anal_graph_to(RCore *core, ut64 addr, int n) {
 			}
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	if (root && dest) {
 		if (dest == root) {
 			eprintf ("Source and destination are the same\n");
@@ -2413,6 +2439,7 @@ R_API int r_core_anal_graph(RCore *core, ut64 addr, int opts) {
 	if (is_json) {
 		r_cons_printf ("[");
 	}
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcni) {
 		if (fcni->type & (R_ANAL_FCN_TYPE_SYM | R_ANAL_FCN_TYPE_FCN |
 		                  R_ANAL_FCN_TYPE_LOC) &&
@@ -2431,6 +2458,7 @@ R_API int r_core_anal_graph(RCore *core, ut64 addr, int opts) {
 			}
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	if (!nodes) {
 		if (!is_html && !is_json && !is_keva) {
 			RAnalFunction *fcn = r_anal_get_fcn_in (core->anal, addr, 0);
@@ -2871,6 +2899,7 @@ R_API int r_core_anal_all(RCore *core) {
 	}
 	if (anal_vars) {
 		/* Set fcn type to R_ANAL_FCN_TYPE_SYM for symbols */
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcni) {
 			if (r_cons_is_breaked ()) {
 				break;
@@ -2885,6 +2914,7 @@ R_API int r_core_anal_all(RCore *core) {
 				fcni->type = R_ANAL_FCN_TYPE_SYM;
 			}
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 	}
 	r_cons_break_pop ();
 	return true;
@@ -3016,6 +3046,7 @@ R_API RCoreAnalStats* r_core_anal_get_stats(RCore *core, ut64 from, ut64 to, ut6
 				(core->io->desc ? core->io->desc->flags: 0);
 	}
 	// iter all flags
+	r_th_rwlock_read_enter (core->flags->lock);
 	r_list_foreach (core->flags->flags, iter, f) {
 		//if (f->offset+f->size < from) continue;
 		if (f->offset < from || f->offset > to) {
@@ -3024,7 +3055,9 @@ R_API RCoreAnalStats* r_core_anal_get_stats(RCore *core, ut64 from, ut64 to, ut6
 		piece = (f->offset - from) / step;
 		as->block[piece].flags++;
 	}
+	r_th_rwlock_read_leave (core->flags->lock);
 	// iter all functions
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, F) {
 		if (F->addr < from || F->addr > to) {
 			continue;
@@ -3032,6 +3065,7 @@ R_API RCoreAnalStats* r_core_anal_get_stats(RCore *core, ut64 from, ut64 to, ut6
 		piece = (F->addr - from) / step;
 		as->block[piece].functions++;
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	// iter all symbols
 	r_list_foreach (r_bin_get_symbols (core->bin), iter, S) {
 		if (S->vaddr < from || S->vaddr > to) {
@@ -3314,7 +3348,10 @@ R_API void r_core_anal_fcn_merge (RCore *core, ut64 addr, ut64 addr2) {
 	r_anal_fcn_set_size (f1, max - min);
 	// resize
 	f2->bbs = NULL;
+	r_th_rwlock_write_enter (core->anal->fcns_lock);
+	r_anal_fcn_tree_delete (core->anal, f2);
 	r_list_delete_data (core->anal->fcns, f2);
+	r_th_rwlock_write_leave (core->anal->fcns_lock);
 }
 
 R_API void r_core_anal_auto_merge (RCore *core, ut64 addr) {
@@ -3340,67 +3377,116 @@ static int esilbreak_mem_write(RAnalEsil *esil, ut64 addr, const ut8 *buf, int l
 	return 1;
 }
 
-/* TODO: move into RCore? */
-static ut64 esilbreak_last_read = UT64_MAX;
-static ut64 esilbreak_last_data = UT64_MAX;
+/* state of one aae pass, hooked into the esil as esil->user */
+typedef struct {
+	RCore *core;
+	RAnalOp *op; // being emulated
+	ut64 last_read;
+	ut64 last_data;
+	ut64 target; // only refs to this address, UT64_MAX for all
+	bool stop;
+	RAnalRef *refs; // found refs, added to anal at the end
+	int nrefs;
+	int refs_size;
+} EsilBreakCtx;
+
+static void add_string_ref(RCore *core, ut64 xref_to);
+
+static void esilbreak_ref(EsilBreakCtx *ctx, ut64 addr, ut64 at, int type) {
+	RAnalRef *r;
+	if (ctx->nrefs == ctx->refs_size) {
+		int size = ctx->refs_size? ctx->refs_size * 2: 1024;
+		r = realloc (ctx->refs, size * sizeof (RAnalRef));
+		if (!r) {
+			return;
+		}
+		ctx->refs = r;
+		ctx->refs_size = size;
+	}
+	r = &ctx->refs[ctx->nrefs++];
+	memset (r, 0, sizeof (RAnalRef));
+	r->addr = addr;
+	r->at = at;
+	r->type = type;
+}
+
+static int esilbreak_ref_cmp(const void *a, const void *b) {
+	const RAnalRef *x = a, *y = b;
+	if (x->addr != y->addr) {
+		return x->addr < y->addr? -1: 1;
+	}
+	if (x->at != y->at) {
+		return x->at < y->at? -1: 1;
+	}
+	return x->type - y->type;
+}
 
-static ut64 ntarget = UT64_MAX;
+/* add the refs found by the pass at once, without duplicates */
+static void esilbreak_flush(EsilBreakCtx *ctx) {
+	int i;
+	if (ctx->nrefs > 1) {
+		qsort (ctx->refs, ctx->nrefs, sizeof (RAnalRef), esilbreak_ref_cmp);
+	}
+	for (i = 0; i < ctx->nrefs; i++) {
+		RAnalRef *r = &ctx->refs[i];
+		if (i > 0 && !esilbreak_ref_cmp (r, r - 1)) {
+			continue;
+		}
+		r_anal_ref_add (ctx->core->anal, r->addr, r->at, r->type);
+	}
+	R_FREE (ctx->refs);
+	ctx->nrefs = ctx->refs_size = 0;
+}
 
-// TODO differentiate endian-aware mem_read with other reads; move ntarget handling to another function
+// TODO differentiate endian-aware mem_read with other reads; move target handling to another function
 static int esilbreak_mem_read(RAnalEsil *esil, ut64 addr, ut8 *buf, int len) {
-	ut8 str[128];
+	EsilBreakCtx *ctx = esil->user;
+	RCore *core = ctx->core;
+	ut64 ntarget = ctx->target;
 	if (addr != UT64_MAX) {
-		esilbreak_last_read = addr;
+		ctx->last_read = addr;
 	}
-	if (myvalid (mycore->io, addr) && r_io_read_at (mycore->io, addr, (ut8*)buf, len)) {
+	if (myvalid (core->io, addr) && r_io_read_at (core->io, addr, (ut8*)buf, len)) {
 		ut64 refptr;
 		bool trace = true;
 		switch (len) {
 		case 2:
-			esilbreak_last_data = refptr = (ut64)r_read_ble16 (buf, esil->anal->big_endian);
+			ctx->last_data = refptr = (ut64)r_read_ble16 (buf, esil->anal->big_endian);
 			break;
 		case 4:
-			esilbreak_last_data = refptr = (ut64)r_read_ble32 (buf, esil->anal->big_endian);
+			ctx->last_data = refptr = (ut64)r_read_ble32 (buf, esil->anal->big_endian);
 			break;
 		case 8:
-			esilbreak_last_data = refptr = r_read_ble64 (buf, esil->anal->big_endian);
+			ctx->last_data = refptr = r_read_ble64 (buf, esil->anal->big_endian);
 			break;
 		default:
 			trace = false;
-			r_io_read_at (mycore->io, addr, (ut8*)buf, len);
+			r_io_read_at (core->io, addr, (ut8*)buf, len);
 			break;
 		}
 
 		// TODO incorrect
 		bool validRef = false;
-		if (trace && myvalid (mycore->io, refptr)) {
+		if (trace && myvalid (core->io, refptr)) {
 			if (ntarget == UT64_MAX || ntarget == refptr) {
-				r_core_cmdf (mycore, "axd 0x%"PFMT64x" 0x%"PFMT64x,
-						(ut64)refptr, esil->address);
-				str[0] = 0;
-				if (r_io_read_at (mycore->io, refptr, str, sizeof (str)) < 1) {
-					eprintf ("Invalid read\n");
-					str[0] = 0;
-				}
-				str[sizeof (str) - 1] = 0;
-				add_string_ref (mycore, refptr);
-				esilbreak_last_data = UT64_MAX;
+				esilbreak_ref (ctx, refptr, esil->address, R_ANAL_REF_TYPE_DATA);
+				add_string_ref (core, refptr);
+				ctx->last_data = UT64_MAX;
 				validRef = true;
 			}
 		}
 
 		/** resolve ptr */
 		if (ntarget == UT64_MAX || ntarget == addr || (ntarget == UT64_MAX && !validRef)) {
-			r_core_cmdf (mycore, "axd 0x%"PFMT64x" 0x%"PFMT64x,
-					addr, esil->address);
+			esilbreak_ref (ctx, addr, esil->address, R_ANAL_REF_TYPE_DATA);
 		}
 	}
 	return 0; // fallback
 }
 
-static bool esil_anal_stop = false;
 static void cccb(void *u) {
-	esil_anal_stop = true;
+	EsilBreakCtx *ctx = u;
+	ctx->stop = true;
 	eprintf ("^C\n");
 }
 
@@ -3430,7 +3516,7 @@ static int esilbreak_reg_write(RAnalEsil *esil, const char *name, ut64 *val) {
 		return 0;
 	}
 	anal = esil->anal;
-	op = esil->user;
+	op = esil->user? ((EsilBreakCtx *)esil->user)->op: NULL;
 	//specific case to handle blx/bx cases in arm through emulation
 	if (anal && anal->cur && anal->cur->arch && anal->bits < 33 &&
 	    strstr (anal->cur->arch, "arm") && !strcmp (name, "pc") && op) {
@@ -3577,9 +3663,12 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 	int minopsize = 4; // XXX this depends on asm->mininstrsize
 	ut64 addr = core->offset;
 	ut64 end = 0LL;
-	ut64 cur;
+	ut64 cur, ntarget = UT64_MAX;
+	RAnalFunction *fcn, *lastfcn = NULL;
+	EsilBreakCtx ctx = { 0 };
+	RAnalEsilCallbacks cb;
+	void *user;
 
-	mycore = core;
 	if (!strcmp (str, "?")) {
 		eprintf ("Usage: aae[f] [len] [addr] - analyze refs in function, section or len bytes with esil\n");
 		eprintf ("  aae $SS @ $S             - analyze the whole section\n");
@@ -3633,37 +3722,43 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 		perror ("malloc");
 		return;
 	}
-	esilbreak_last_read = UT64_MAX;
 	r_io_read_at (core->io, addr, buf, iend + 1);
 	if (!ESIL) {
 		r_core_cmd0 (core, "aei");
 		ESIL = core->anal->esil;
 		if (!ESIL) {
 			eprintf ("ESIL not initialized\n");
+			free (buf);
 			return;
 		}
 	}
-	ESIL->cb.hook_reg_write = &esilbreak_reg_write;
-	//this is necessary for the hook to read the id of analop
-	ESIL->user = &op;
-	ESIL->cb.hook_mem_read = &esilbreak_mem_read;
-	ESIL->cb.hook_mem_write = &esilbreak_mem_write;
 	//eprintf ("Analyzing ESIL refs from 0x%"PFMT64x" - 0x%"PFMT64x"\n", addr, end);
-	// TODO: backup/restore register state before/after analysis
 	pcname = r_reg_get_name (core->anal->reg, R_REG_NAME_PC);
 	if (!pcname || !*pcname) {
 		eprintf ("Cannot find program counter register in the current profile.\n");
+		free (buf);
 		return;
 	}
-	esil_anal_stop = false;
-	r_cons_break_push (cccb, core);
+	ctx.core = core;
+	ctx.op = &op; // the reg_write hook reads the id of the analop
+	ctx.last_read = UT64_MAX;
+	ctx.last_data = UT64_MAX;
+	ctx.target = ntarget;
+	/* the hooks set before aae are restored on the way out */
+	user = ESIL->user;
+	cb = ESIL->cb;
+	ESIL->cb.hook_reg_write = &esilbreak_reg_write;
+	ESIL->user = &ctx;
+	ESIL->cb.hook_mem_read = &esilbreak_mem_read;
+	ESIL->cb.hook_mem_write = &esilbreak_mem_write;
+	r_cons_break_push (cccb, &ctx);
 
 	int opalign = r_anal_archinfo (core->anal, R_ANAL_ARCHINFO_ALIGN);
 	int in = r_syscall_get_swi (core->anal->syscall);
 	const char *sn = r_reg_get_name (core->anal->reg, R_REG_NAME_SN);
 	r_reg_arena_push (core->anal->reg);
 	for (i = 0; i < iend; i++) {
-		if (esil_anal_stop || r_cons_is_breaked ()) {
+		if (ctx.stop || r_cons_is_breaked ()) {
 			break;
 		}
 		cur = addr + i;
@@ -3671,6 +3766,13 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 		if (opalign > 0) {
 			cur -= (cur % opalign);
 		}
+		/* each function is emulated from the initial register state,
+		 * so its refs do not depend on the code emulated before it */
+		fcn = r_anal_get_fcn_in (core->anal, cur, 0);
+		if (fcn && fcn != lastfcn) {
+			r_reg_arena_restore (core->anal->reg);
+		}
+		lastfcn = fcn;
 		r_anal_op_fini (&op);
 		if (!r_anal_op (core->anal, &op, cur, buf + i, iend - i)) {
 			i += minopsize - 1;
@@ -3721,7 +3823,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					if (core->anal->cur && strcmp (core->anal->cur->arch, "arm")) {
 						if (cfg_anal_strings) {
 							if (CHECKREF (ESIL->cur)) {
-								r_anal_ref_add (core->anal, ESIL->cur, cur, 's');
+								esilbreak_ref (&ctx, ESIL->cur, cur, 's');
 							}
 						}
 					}
@@ -3734,7 +3836,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					ut64 dst = ESIL->cur;
 					if ((target && dst == ntarget) || !target) {
 						if (CHECKREF (dst)) {
-							r_anal_ref_add (core->anal, dst, cur, 'd');
+							esilbreak_ref (&ctx, dst, cur, 'd');
 						}
 					}
 					add_string_ref (core, dst);
@@ -3750,17 +3852,17 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 						break;
 					}
 					if ((target && dst == ntarget) || !target) {
-						if (dst > 0xffff && op.src[1] && (dst & 0xffff) == (op.src[1]->imm & 0xffff) && myvalid (mycore->io, dst)) {
+						if (dst > 0xffff && op.src[1] && (dst & 0xffff) == (op.src[1]->imm & 0xffff) && myvalid (core->io, dst)) {
 							RFlagItem *f;
 							char *str;
 							if (CHECKREF (dst) || CHECKREF (cur)) {
-								r_anal_ref_add (core->anal, dst, cur, 'd');
+								esilbreak_ref (&ctx, dst, cur, 'd');
 								if (cfg_anal_strings) {
 									add_string_ref (core, dst);
 								}
 								if ((f = r_flag_get_i2 (core->flags, dst))) {
 									r_meta_set_string (core->anal, R_META_TYPE_COMMENT, cur, f->name);
-								} else if ((str = is_string_at (mycore, dst, NULL))) {
+								} else if ((str = is_string_at (core, dst, NULL))) {
 									char *str2 = sdb_fmt (2, "esilref: '%s'", str);
 									// HACK avoid format string inside string used later as format
 									// string crashes disasm inside agf under some conditions.
@@ -3776,19 +3878,19 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 				break;
 			case R_ANAL_OP_TYPE_LOAD:
 				{
-					ut64 dst = esilbreak_last_read;
+					ut64 dst = ctx.last_read;
 					if (dst != UT64_MAX && CHECKREF (dst)) {
-						if (myvalid (mycore->io, dst)) {
-							r_anal_ref_add (core->anal, dst, cur, 'd');
+						if (myvalid (core->io, dst)) {
+							esilbreak_ref (&ctx, dst, cur, 'd');
 							if (cfg_anal_strings) {
 								add_string_ref (core, dst);
 							}
 						}
 					}
-					dst = esilbreak_last_data;
+					dst = ctx.last_data;
 					if (dst != UT64_MAX && CHECKREF (dst)) {
-						if (myvalid (mycore->io, dst)) {
-							r_anal_ref_add (core->anal, dst, cur, 'd');
+						if (myvalid (core->io, dst)) {
+							esilbreak_ref (&ctx, dst, cur, 'd');
 							if (cfg_anal_strings) {
 								add_string_ref (core, dst);
 							}
@@ -3801,7 +3903,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					ut64 dst = op.jump;
 					if (CHECKREF (dst)) {
 						if (myvalid (core->io, dst)) {
-							r_anal_ref_add (core->anal, dst, cur, 'c');
+							esilbreak_ref (&ctx, dst, cur, 'c');
 						}
 					}
 				}
@@ -3811,7 +3913,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					ut64 dst = op.jump;
 					if (CHECKREF (dst)) {
 						if (myvalid (core->io, dst)) {
-							r_anal_ref_add (core->anal, dst, cur, 'C');
+							esilbreak_ref (&ctx, dst, cur, 'C');
 						}
 						ESIL->old = cur + op.size;
 						getpcfromstack (core, ESIL);
@@ -3835,7 +3937,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 								(op.type & R_ANAL_OP_TYPE_MASK) == R_ANAL_OP_TYPE_UCALL
 								? R_ANAL_REF_TYPE_CALL
 								: R_ANAL_REF_TYPE_CODE;
-							r_anal_ref_add (core->anal, dst, cur, ref);
+							esilbreak_ref (&ctx, dst, cur, ref);
 						}
 					}
 				}
@@ -3847,6 +3949,11 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 	free (buf);
 	r_anal_op_fini (&op);
 	r_cons_break_pop ();
+	esilbreak_flush (&ctx);
+	ESIL->user = user;
+	ESIL->cb.hook_mem_read = cb.hook_mem_read;
+	ESIL->cb.hook_mem_write = cb.hook_mem_write;
+	ESIL->cb.hook_reg_write = cb.hook_reg_write;
 	// restore register
 	r_reg_arena_pop (core->anal->reg);
 }
@@ -635,6 +635,7 @@ R_API void r_core_anal_cc_init(RCore *core) {
 	//restore all freed CC or replace with new default cc
 	RListIter *it;
 	RAnalFunction *fcn;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, it, fcn) {
 		char *ptr = sdb_fmt (-1, "%p", fcn->cc);
 		const char *cc = sdb_const_get (sdbs[0], ptr, 0);
@@ -646,6 +647,7 @@ R_API void r_core_anal_cc_init(RCore *core) {
 		}
 		fcn->cc = r_str_const (fcn->cc);
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	sdb_close (sdbs[0]);
 	sdb_free (sdbs[0]);
 }
@@ -1465,6 +1465,13 @@ static int cb_iova(void *user, void *data) {
 	return true;
 }
 
+static int cb_ioundo(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	r_io_undo_enable (core->io, core->io->undo.s_enable, node->i_value);
+	return true;
+}
+
 static int cb_ioff(void *user, void *data) {
 	RCore *core = (RCore *) user;
 	RConfigNode *node = (RConfigNode *) data;
@@ -1805,6 +1812,19 @@ static int cb_bindbginfo(void *user, void *data) {
 	return true;
 }
 
+static int cb_bincache(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	if (!core || !core->bin) {
+		return false;
+	}
+	R_FREE (core->bin->cache_dir);
+	if (node->value && *node->value) {
+		core->bin->cache_dir = r_file_abspath (node->value);
+	}
+	return true;
+}
+
 static int cb_binprefix(void *user, void *data) {
 	RCore *core = (RCore *) user;
 	RConfigNode *node = (RConfigNode *) data;
@@ -2170,6 +2190,8 @@ R_API int r_core_config_init(RCore *core) {
 	SETICB ("esil.stack.depth", 32, &cb_esilstackdepth, "Number of elements that can be pushed on the esilstack");
 	SETI ("esil.stack.size", 0xf0000, "Number of elements that can be pushed on the esilstack");
 	SETI ("esil.stack.addr", 0x100000, "Number of elements that can be pushed on the esilstack");
+	SETI ("esil.explore.paths", 64, "Maximum number of paths forked by aexp");
+	SETI ("esil.explore.steps", 4096, "Maximum number of instructions emulated per aexp path");
 	SETPREF ("esil.stack.pattern", "0", "Specify fill pattern to initialize the stack (0, w, d, i)");
 
 	/* asm */
@@ -2316,6 +2338,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETICB ("bin.minstr", 0, &cb_binminstr, "Minimum string length for r_bin");
 	SETICB ("bin.maxstr", 0, &cb_binmaxstr, "Maximum string length for r_bin");
 	SETICB ("bin.maxstrbuf", 1024*1024*10, & cb_binmaxstrbuf, "Maximum size of range to load strings from");
+	SETCB ("bin.cache", "", &cb_bincache, "Directory to cache parsed strings, entrypoints and libs by file hash (e.g. ~/.cache/radare2/bin)");
 	SETCB ("bin.prefix", NULL, &cb_binprefix, "Prefix all symbols/sections/relocs with a specific string");
 	SETCB ("bin.rawstr", "false", &cb_rawstr, "Load strings from raw binaries");
 	SETCB ("bin.strings", "true", &cb_binstrings, "Load strings from rbin on startup");
@@ -2697,6 +2720,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETPREF ("rop.conditional", "false", "Include conditional jump, calls and returns in ropsearch");
 	SETPREF ("rop.nx", "false", "Include NX/XN/XD sections in ropsearch");
 	SETPREF ("rop.comments", "false", "Display comments in rop search output");
+	SETPREF ("rop.cache", "", "Directory to keep the /Ri gadget indexes in");
 
 	/* io */
 	SETCB ("io.buffer", "false", &cb_iobuffer, "Load and use buffer cache if enabled");
@@ -2708,6 +2732,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETCB ("io.pcache", "false", &cb_iopcache, "io.cache for p-level");
 	SETCB ("io.pcache.write", "false", &cb_iopcachewrite, "Enable write-cache");
 	SETCB ("io.pcache.read", "false", &cb_iopcacheread, "Enable read-cache");
+	SETCB ("io.undo", "false", &cb_ioundo, "Keep the write history for u-, u+ and ul");
 	SETCB ("io.ff", "true", &cb_ioff, "Fill invalid buffers with 0xff instead of returning error");
 	SETPREF("io.exec", "true", "See !!r2 -h~-x");
 	SETICB ("io.0xff", 0xff, &cb_io_oxff, "Use this value instead of 0xff to fill unallocated areas");
@@ -2733,6 +2758,7 @@ R_API int r_core_config_init(RCore *core) {
 
 	/* rap */
 	SETPREF ("rap.loop", "true", "Run rap as a forever-listening daemon");
+	SETPREF ("rap.compress", "true", "Compress the pages read by rap v2 clients");
 
 	/* nkeys */
 	SETPREF ("key.s", "", "override step into action");
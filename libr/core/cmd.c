@@ -213,6 +213,9 @@ static const char *help_msg_u[] = {
 	"u", "", "show system uname",
 	"uw", "", "alias for wc (requires: e io.cache=true)",
 	"us", "", "alias for s- (seek history)",
+	"u-", "", "undo the last write (requires: e io.undo=true)",
+	"u+", "", "redo the last undone write",
+	"ul", "", "list the write history",
 	NULL
 };
 
@@ -312,6 +315,37 @@ R_API RAsmOp *r_core_disassemble (RCore *core, ut64 addr) {
 	return op;
 }
 
+/* undo the newest write still applied, or redo the oldest undone one */
+static void cmd_uname_write(RCore *core, bool redo) {
+	RIOUndoWrite *u, *found = NULL;
+	RListIter *iter;
+	if (!core->io->undo.w_init) {
+		eprintf ("No writes done, see e io.undo\n");
+		return;
+	}
+	if (redo) {
+		r_list_foreach (core->io->undo.w_list, iter, u) {
+			if (!u->set) {
+				found = u;
+				break;
+			}
+		}
+	} else {
+		r_list_foreach_prev (core->io->undo.w_list, iter, u) {
+			if (u->set) {
+				found = u;
+				break;
+			}
+		}
+	}
+	if (!found) {
+		eprintf ("Nothing to %s\n", redo? "redo": "undo");
+		return;
+	}
+	r_io_wundo_apply (core->io, found, redo);
+	r_core_block_read (core);
+}
+
 static int cmd_uname(void *data, const char *input) {
 	switch (input[0]) {
 	case '?': // "u?"
@@ -323,6 +357,13 @@ static int cmd_uname(void *data, const char *input) {
 	case 'w': // "uw"
 		r_core_cmdf (data, "wc%s", input + 1);
 		return 1;
+	case '-': // "u-"
+	case '+': // "u+"
+		cmd_uname_write (data, *input == '+');
+		return 1;
+	case 'l': // "ul"
+		r_io_wundo_list (((RCore *)data)->io);
+		return 1;
 	}
 #if __UNIX__
 	struct utsname un;
@@ -2411,11 +2452,70 @@ static int foreach_comment(void *user, const char *k, const char *v) {
 	return 1;
 }
 
+/* the @@ iterators run commands that may add and remove functions and
+ * flags, so they walk a copy of the addresses and names taken with the
+ * read lock held instead of the lists themselves */
+typedef struct {
+	ut64 addr;
+	char *name;
+} CmdForeachItem;
+
+static void foreach_item_free(CmdForeachItem *it) {
+	if (it) {
+		free (it->name);
+		free (it);
+	}
+}
+
+static void foreach_item_add(RList *list, ut64 addr, const char *name) {
+	CmdForeachItem *it = R_NEW0 (CmdForeachItem);
+	if (it) {
+		it->addr = addr;
+		it->name = strdup (name? name: "");
+		r_list_append (list, it);
+	}
+}
+
+/* functions whose name contains match, all of them if it is NULL */
+static RList *foreach_fcns(RCore *core, const char *match) {
+	RList *list = r_list_newf ((RListFree)foreach_item_free);
+	RAnalFunction *fcn;
+	RListIter *iter;
+	if (!list) {
+		return NULL;
+	}
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
+	r_list_foreach (core->anal->fcns, iter, fcn) {
+		if (!match || strstr (fcn->name, match)) {
+			foreach_item_add (list, fcn->addr, fcn->name);
+		}
+	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
+	return list;
+}
+
+/* flags matching glob in the given space, NULL and -1 match all */
+static RList *foreach_flags(RCore *core, const char *glob, int space) {
+	RList *list = r_list_newf ((RListFree)foreach_item_free);
+	RFlagItem *flag;
+	RListIter *iter;
+	if (!list) {
+		return NULL;
+	}
+	r_th_rwlock_read_enter (core->flags->lock);
+	r_list_foreach (core->flags->flags, iter, flag) {
+		if ((space == -1 || flag->space == space) && (!glob || r_str_glob (flag->name, glob))) {
+			foreach_item_add (list, flag->offset, flag->name);
+		}
+	}
+	r_th_rwlock_read_leave (core->flags->lock);
+	return list;
+}
+
 R_API int r_core_cmd_foreach3(RCore *core, const char *cmd, char *each) {
 	RDebug *dbg = core->dbg;
 	RList *list, *head;
 	RListIter *iter;
-	RFlagItem *flg;
 	int i;
 
 	switch (each[0]) {
@@ -2530,21 +2630,27 @@ R_API int r_core_cmd_foreach3(RCore *core, const char *cmd, char *each) {
 	case 'f':
 		switch (each[1]) {
 		case 'l': // flags
-			r_list_foreach (core->flags->flags, iter, flg) {
-				r_core_seek (core, flg->offset, 1);
-				r_core_cmd0 (core, cmd);
+			{
+				CmdForeachItem *it;
+				list = foreach_flags (core, NULL, -1);
+				r_list_foreach (list, iter, it) {
+					r_core_seek (core, it->addr, 1);
+					r_core_cmd0 (core, cmd);
+				}
+				r_list_free (list);
 			}
 			break;
 		case 'u': // functions
 			{
 				ut64 offorig = core->offset;
-				RAnalFunction *fcn;
-				list = core->anal->fcns;
-				r_list_foreach (list, iter, fcn) {
-					r_cons_printf ("[0x%08"PFMT64x"  %s\n", fcn->addr, fcn->name);
-					r_core_seek (core, fcn->addr, 1);
+				CmdForeachItem *it;
+				list = foreach_fcns (core, NULL);
+				r_list_foreach (list, iter, it) {
+					r_cons_printf ("[0x%08"PFMT64x"  %s\n", it->addr, it->name);
+					r_core_seek (core, it->addr, 1);
 					r_core_cmd0 (core, cmd);
 				}
+				r_list_free (list);
 				r_core_seek (core, offorig, 1);
 			}
 			break;
@@ -2614,7 +2720,6 @@ R_API int r_core_cmd_foreach(RCore *core, const char *cmd, char *each) {
 	char *word = NULL;
 	char *str, *ostr = NULL;
 	RListIter *iter;
-	RFlagItem *flag;
 	ut64 oseek, addr;
 
 	for (; *cmd == ' '; cmd++);
@@ -2705,28 +2810,29 @@ R_API int r_core_cmd_foreach(RCore *core, const char *cmd, char *each) {
 		break;
 	case 'f': // "@@f"
 		if (each[1] == ':') {
-			RAnalFunction *fcn;
+			CmdForeachItem *it;
 			RListIter *iter;
-			if (core->anal) {
-				r_list_foreach (core->anal->fcns, iter, fcn) {
-					if (each[2] && strstr (fcn->name, each + 2)) {
-						r_core_seek (core, fcn->addr, 1);
-						r_core_cmd (core, cmd, 0);
-						if (r_cons_is_breaked ()) {
-							break;
-						}
+			if (core->anal && each[2]) {
+				RList *list = foreach_fcns (core, each + 2);
+				r_list_foreach (list, iter, it) {
+					r_core_seek (core, it->addr, 1);
+					r_core_cmd (core, cmd, 0);
+					if (r_cons_is_breaked ()) {
+						break;
 					}
 				}
+				r_list_free (list);
 			}
 			goto out_finish;
 		} else {
-			RAnalFunction *fcn;
+			CmdForeachItem *it;
 			RListIter *iter;
 			if (core->anal) {
 				RConsGrep grep = core->cons->grep;
-				r_list_foreach (core->anal->fcns, iter, fcn) {
+				RList *list = foreach_fcns (core, NULL);
+				r_list_foreach (list, iter, it) {
 					char *buf;
-					r_core_seek (core, fcn->addr, 1);
+					r_core_seek (core, it->addr, 1);
 					r_cons_push ();
 					r_core_cmd (core, cmd, 0);
 					buf = (char *)r_cons_get_buffer ();
@@ -2740,6 +2846,7 @@ R_API int r_core_cmd_foreach(RCore *core, const char *cmd, char *each) {
 						break;
 					}
 				}
+				r_list_free (list);
 				core->cons->grep = grep;
 			}
 			goto out_finish;
@@ -2897,27 +3004,24 @@ R_API int r_core_cmd_foreach(RCore *core, const char *cmd, char *each) {
 				int flagspace = core->flags->space_idx;
 				/* for all flags in current flagspace */
 				// XXX: dont ask why, but this only works with _prev..
-				r_list_foreach (core->flags->flags, iter, flag) {
+				RList *flags = foreach_flags (core, word, flagspace);
+				CmdForeachItem *it;
+				r_list_foreach (flags, iter, it) {
+					char *buf = NULL;
+					const char *tmp = NULL;
 					if (r_cons_is_breaked ()) {
 						break;
 					}
-					/* filter per flag spaces */
-					if ((flagspace != -1) && (flag->space != flagspace)) {
-						continue;
-					}
-					if (r_str_glob (flag->name, word)) {
-						char *buf = NULL;
-						const char *tmp = NULL;
-						r_core_seek (core, flag->offset, 1);
-						r_cons_push ();
-						r_core_cmd (core, cmd, 0);
-						tmp = r_cons_get_buffer ();
-						buf = tmp? strdup (tmp): NULL;
-						r_cons_pop ();
-						r_cons_strcat (buf);
-						free (buf);
-					}
+					r_core_seek (core, it->addr, 1);
+					r_cons_push ();
+					r_core_cmd (core, cmd, 0);
+					tmp = r_cons_get_buffer ();
+					buf = tmp? strdup (tmp): NULL;
+					r_cons_pop ();
+					r_cons_strcat (buf);
+					free (buf);
 				}
+				r_list_free (flags);
 				core->flags->space_idx = flagspace;
 				core->rcmd->macro.counter++ ;
 				free (word);
@@ -108,6 +108,7 @@ static const char *help_msg_ae[] = {
 	"aesue", " [esil]", "step until esil expression match",
 	"aetr", "[esil]", "Convert an ESIL Expression to REIL",
 	"aex", " [hex]", "evaluate opcode expression",
+	"aexp", "[jq] [addr]", "explore the paths from the esil PC forking at every branch (until addr)",
 	NULL
 };
 
@@ -645,6 +646,7 @@ static void type_cmd(RCore *core, const char *input) {
 		r_core_cmd0 (core, "aeim");
 		r_config_set_i (core->config, "io.cache", true);
 			r_reg_arena_push (core->anal->reg);
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, it, fcn) {
 			int ret = r_core_seek (core, fcn->addr, true);
 			if (!ret) {
@@ -656,6 +658,7 @@ static void type_cmd(RCore *core, const char *input) {
 				break;
 			}
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 		r_core_cmd0 (core, "aeim-");
 		r_core_cmd0 (core, "aei-");
 		r_core_seek (core, seek, true);
@@ -708,10 +711,12 @@ static void flag_every_function(RCore *core) {
 	RListIter *iter;
 	RAnalFunction *fcn;
 	r_flag_space_push (core->flags, "functions");
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		r_flag_set (core->flags, fcn->name,
 			fcn->addr, r_anal_fcn_size (fcn));
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	r_flag_space_pop (core->flags);
 }
 
@@ -1705,6 +1710,7 @@ static void r_core_anal_nofunclist  (RCore *core, const char *input) {
 	}
 
 	// for each function
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		// for each basic block in the function
 		r_list_foreach (fcn->bbs, iter2, b) {
@@ -1720,6 +1726,7 @@ static void r_core_anal_nofunclist  (RCore *core, const char *input) {
 			bitmap[fcn->addr-base_addr] = 'F';
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 
 	// Now we print the list of memory regions that are not assigned to a function
 	chunk_size = 0;
@@ -1773,6 +1780,7 @@ static void r_core_anal_fmap  (RCore *core, const char *input) {
 	}
 
 	// for each function
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		// for each basic block in the function
 		r_list_foreach (fcn->bbs, iter2, b) {
@@ -1787,6 +1795,7 @@ static void r_core_anal_fmap  (RCore *core, const char *input) {
 			bitmap[fcn->addr-base_addr] = 'F';
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	// print the bitmap
 	assigned = 0;
 	if (cols < 1) {
@@ -4068,6 +4077,15 @@ static void cmd_anal_esil(RCore *core, const char *input) {
 		}
 		break;
 	case 'x': { // "aex"
+		if (input[1] == 'p') { // "aexp"
+			int mode = (input[2] == 'j' || input[2] == 'q')? input[2]: 0;
+			const char *arg = strchr (input + 2, ' ');
+			ut64 until = (arg && arg[1])? r_num_math (core->num, arg + 1): UT64_MAX;
+			r_core_anal_explore (core, until,
+				r_config_get_i (core->config, "esil.explore.paths"),
+				r_config_get_i (core->config, "esil.explore.steps"), mode);
+			break;
+		}
 		ut32 new_bits = -1;
 		int segoff, old_bits, pos = 0;
 		char *new_arch = NULL, *old_arch = NULL, *hex = NULL;
@@ -5512,6 +5530,7 @@ static int compute_coverage(RCore *core) {
 	RAnalFunction *fcn;
 	RIOSection *sec;
 	int cov = 0;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		ls_foreach (core->io->sections, iter2, sec) {
 			if (sec->flags & 1) {
@@ -5523,6 +5542,7 @@ static int compute_coverage(RCore *core) {
 			}
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	return cov;
 }
 
@@ -5542,9 +5562,11 @@ static int compute_calls(RCore *core) {
 	RListIter *iter;
 	RAnalFunction *fcn;
 	int cov = 0;
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		cov += r_list_length (fcn->xrefs);
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	return cov;
 }
 
@@ -5990,6 +6012,8 @@ static bool anal_fcn_data_gaps (RCore *core, const char *input) {
 	RAnalFunction *fcn;
 	RListIter *iter;
 	int i, wordsize = (core->assembler->bits == 64)? 8: 4;
+	/* sorting reorders the list, so the walk takes the lock alone */
+	r_th_rwlock_write_enter (core->anal->fcns_lock);
 	r_list_sort (core->anal->fcns, cmpaddr);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		if (end != UT64_MAX) {
@@ -6004,6 +6028,7 @@ static bool anal_fcn_data_gaps (RCore *core, const char *input) {
 		}
 		end = fcn->addr + r_anal_fcn_size (fcn);
 	}
+	r_th_rwlock_write_leave (core->anal->fcns_lock);
 	return true;
 }
 
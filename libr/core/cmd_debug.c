@@ -799,14 +799,17 @@ static int step_until_flag(RCore *core, const char *instr) {
 		r_debug_step (core->dbg, 1);
 		r_debug_reg_sync (core->dbg, R_REG_TYPE_ALL, false);
 		pc = r_debug_reg_get (core->dbg, "PC");
+		r_th_rwlock_read_enter (core->flags->lock);
 		list = r_flag_get_list (core->flags, pc);
 		r_list_foreach (list, iter, f) {
 			if (!instr|| !*instr || (f->realname && strstr(f->realname, instr))) {
 				r_cons_printf ("[ 0x%08"PFMT64x" ] %s\n",
 						f->offset, f->realname);
+				r_th_rwlock_read_leave (core->flags->lock);
 				goto beach;
 			}
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	}
 beach:
 	r_cons_break_pop ();
@@ -1893,6 +1896,9 @@ static void cmd_reg_profile (RCore *core, int from, const char *str) { // "arp"
 						free (arena->bytes);
 						arena->bytes = newbytes;
 						arena->size = n;
+						/* all of it is new, and the old range may not fit */
+						arena->dirty_from = arena->dirty_to = 0;
+						r_reg_arena_dirty (arena, 0, n);
 					} else {
 						eprintf ("Cannot allocate %d\n", (int)n);
 					}
@@ -163,6 +163,7 @@ static void flagbars(RCore *core, const char *glob) {
 	if (cols < 0) {
 		cols += 80;
 	}
+	r_th_rwlock_read_enter (core->flags->lock);
 	r_list_foreach (core->flags->flags, iter, flag) {
 		ut64 min = 0, max = r_io_size (core->io);
 		RIOSection *s = r_io_section_vget (core->io, flag->offset);
@@ -176,6 +177,7 @@ static void flagbars(RCore *core, const char *glob) {
 			r_cons_printf ("  %s\n", flag->name);
 		}
 	}
+	r_th_rwlock_read_leave (core->flags->lock);
 }
 
 static int cmd_flag(void *data, const char *input) {
@@ -323,10 +325,12 @@ rep:
 				RFlag *f = core->flags;
 				*ptr = 0;
 				base = r_num_math (core->num, str);
+				r_th_rwlock_write_enter (f->lock);
 				r_list_foreach (f->flags, iter, flag) {
 					if (r_str_glob (flag->name, ptr+1))
 						flag->offset += base;
 				}
+				r_th_rwlock_write_leave (f->lock);
 			} else {
 				core->flags->base = r_num_math (core->num, input+1);
 			}
@@ -458,6 +462,7 @@ rep:
 			}
 			RListIter *iter, *iter2;
 			RFlagItem *flag, *flag2;
+			r_th_rwlock_read_enter (core->flags->lock);
 			r_list_foreach (core->flags->flags, iter, flag) {
 				if (flag->size == 0 && (!glob || r_str_glob (flag->name, glob))) {
 					RFlagItem *win = NULL;
@@ -474,6 +479,7 @@ rep:
 					}
 				}
 			}
+			r_th_rwlock_read_leave (core->flags->lock);
 		} else if (input[1] == ' ') { // "fl ..."
 			char *p, *arg = strdup (input + 2);
 			r_str_trim_head_tail (arg);
@@ -1572,13 +1572,17 @@ static int printzoomcallback(void *user, int mode, ut64 addr, ut8 *bufz, ut64 si
 		}
 		break;
 	case 'f':
-		r_list_foreach (core->flags->flags, iter, flag)
-		if (flag->offset <= addr && addr < flag->offset + flag->size) {
-			ret++;
+		r_th_rwlock_read_enter (core->flags->lock);
+		r_list_foreach (core->flags->flags, iter, flag) {
+			if (flag->offset <= addr && addr < flag->offset + flag->size) {
+				ret++;
+			}
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 		break;
 	case 's':
 		j = r_flag_space_get (core->flags, "strings");
+		r_th_rwlock_read_enter (core->flags->lock);
 		r_list_foreach (core->flags->flags, iter, flag) {
 			if (flag->space == j &&
 			    ((addr <= flag->offset &&
@@ -1588,6 +1592,7 @@ static int printzoomcallback(void *user, int mode, ut64 addr, ut8 *bufz, ut64 si
 				ret++;
 			}
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 		break;
 	case '0': // 0x00
 		for (j = 0; j < size; j++) {
@@ -93,6 +93,20 @@ static const char *help_msg_slash_R[] = {
 	"/Rj", " [filter-by-string]", "JSON output",
 	"/R/j", " [filter-by-regexp]", "JSON output [regular expression]",
 	"/Rk", " [select-by-class]", "Query stored ROP gadgets",
+	"/Ri", "", "Build (or load from rop.cache) the gadget index",
+	"/Ri-", "", "Drop the gadget index",
+	"/Rq", " [filters]", "Query the gadget index without rescanning",
+	NULL
+};
+
+static const char *help_msg_slash_Rq[] = {
+	"Usage: /Rq", " [filter ...]", "Query the gadget index (see /Ri)",
+	"/Rq", " end=ret", "Gadgets ending with a given instruction type",
+	"/Rq", " class=mov", "Gadgets of a class (nop, mov, const, arithm, arithm_ct)",
+	"/Rq", " reg=rax", "Gadgets writing to a register",
+	"/Rq", " !reg=rsp", "Gadgets not writing to a register",
+	"/Rq", " len=3", "Gadgets with at most this many instructions",
+	"/Rqq", " [filter ...]", "Only list the gadget addresses",
 	NULL
 };
 
@@ -134,6 +148,13 @@ struct endlist_pair {
 	int delay_size;
 };
 
+/* address list of one key of the gadget index built by /Ri
+ * (all, end.<type>, class.<name>, reg.<name>) */
+typedef struct {
+	char *name;
+	RStrBuf *addrs;
+} RopIndexKey;
+
 static void cmd_search_init(RCore *core) {
 	DEFINE_CMD_DESCRIPTOR_SPECIAL (core, /, slash);
 	DEFINE_CMD_DESCRIPTOR_SPECIAL (core, /c, slash_c);
@@ -292,86 +313,265 @@ static int count_functions(RCore *core) {
 	return r_list_length (core->anal->fcns);
 }
 
-R_API int r_core_search_preludes(RCore *core) {
-	int ret = -1;
+/* preludes are matched over map windows split in chunks scanned by worker
+ * threads, the hits are then sorted, deduplicated and analyzed in order */
+
+#define PRELUDE_WINDOW (16 * 1024 * 1024)
+#define PRELUDE_MAXTHREADS 16
+
+typedef struct {
+	ut8 bytes[16];
+	int len;
+} RCorePrelude;
+
+typedef struct {
+	const ut8 *buf; // window contents
+	int from; // first start offset scanned by this chunk
+	int to;
+	int len; // window size
+	ut64 addr; // window address
+	RCorePrelude *pre;
+	int npre;
+	ut64 *hits;
+	int nhits;
+	int size;
+	bool oom; // the hits did not fit, the chunk is incomplete
+} RCorePreludeChunk;
+
+static void prelude_add(RList *list, const char *bytes, int len) {
+	RCorePrelude *p = R_NEW0 (RCorePrelude);
+	if (p) {
+		p->len = R_MIN (len, sizeof (p->bytes));
+		memcpy (p->bytes, bytes, p->len);
+		r_list_append (list, p);
+	}
+}
+
+static RList *prelude_list(RCore *core) {
 	const char *prelude = r_config_get (core->config, "anal.prelude");
 	const char *arch = r_config_get (core->config, "asm.arch");
 	int bits = r_config_get_i (core->config, "asm.bits");
-	ut64 from = UT64_MAX;
-	ut64 to = UT64_MAX;
-	int fc0, fc1;
+	RList *list = r_list_newf (free);
+	if (!list) {
+		return NULL;
+	}
+	if (prelude && *prelude) {
+		ut8 *kw = malloc (strlen (prelude) + 1);
+		if (kw) {
+			int kwlen = r_hex_str2bin (prelude, kw);
+			if (kwlen > 0) {
+				prelude_add (list, (const char *)kw, kwlen);
+			}
+			free (kw);
+		}
+	} else if (strstr (arch, "ppc")) {
+		prelude_add (list, "\x7c\x08\x02\xa6", 4);
+	} else if (strstr (arch, "arm")) {
+		switch (bits) {
+		case 16:
+			prelude_add (list, "\xf0\xb5", 2);
+			break;
+		case 32:
+			prelude_add (list, "\x00\x48\x2d\xe9", 4);
+			break;
+		case 64:
+			prelude_add (list, "\xf6\x57\xbd\xa9", 4);
+			prelude_add (list, "\xfd\x7b\xbf\xa9", 4);
+			prelude_add (list, "\xfc\x6f\xbe\xa9", 4);
+			break;
+		default:
+			eprintf ("ap: Unsupported bits: %d\n", bits);
+		}
+	} else if (strstr (arch, "mips")) {
+		prelude_add (list, "\x27\xbd\x00", 3);
+	} else if (strstr (arch, "x86")) {
+		switch (bits) {
+		case 32:
+			prelude_add (list, "\x8b\xff\x55\x8b\xec", 5); // mov edi, edi;push ebp; mov ebp,esp
+			prelude_add (list, "\x55\x89\xe5", 3);
+			prelude_add (list, "\x55\x8b\xec", 3); // push ebp; mov ebp, esp
+			break;
+		case 64:
+			prelude_add (list, "\x55\x48\x89\xe5", 4);
+			prelude_add (list, "\x55\x48\x8b\xec", 4);
+			break;
+		default:
+			eprintf ("ap: Unsupported bits: %d\n", bits);
+		}
+	} else {
+		eprintf ("ap: Unsupported asm.arch and asm.bits\n");
+	}
+	return list;
+}
+
+static void *prelude_scan_chunk(void *user) {
+	RCorePreludeChunk *c = user;
+	int i, j;
+	for (i = c->from; i < c->to; i++) {
+		for (j = 0; j < c->npre; j++) {
+			const RCorePrelude *p = &c->pre[j];
+			if (c->buf[i] != p->bytes[0] || i + p->len > c->len
+					|| memcmp (c->buf + i, p->bytes, p->len)) {
+				continue;
+			}
+			if (c->nhits == c->size) {
+				int size = c->size? c->size * 2: 256;
+				ut64 *hits = realloc (c->hits, size * sizeof (ut64));
+				if (!hits) {
+					c->oom = true;
+					return NULL;
+				}
+				c->hits = hits;
+				c->size = size;
+			}
+			c->hits[c->nhits++] = c->addr + i;
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int prelude_addr_cmp(const void *a, const void *b) {
+	ut64 x = *(const ut64 *)a;
+	ut64 y = *(const ut64 *)b;
+	return (x < y)? -1: (x > y)? 1: 0;
+}
+
+/* all the prelude matches in [from, to), sorted and unique. The chunks
+ * run in the pool, or here without one. On allocation failure returns
+ * NULL and sets *nhits to -1, no partial results */
+static ut64 *prelude_scan(RCore *core, RThreadPool *pool, ut64 from, ut64 to, RCorePrelude *pre, int npre, int *nhits) {
+	RCorePreludeChunk chunks[PRELUDE_MAXTHREADS];
+	RThreadTask *tasks[PRELUDE_MAXTHREADS];
+	int i, maxlen = 0, nth = pool? R_MIN (pool->size, PRELUDE_MAXTHREADS): 1;
+	ut64 *hits = NULL, at;
+	int count = 0;
+	bool oom = false;
+	ut8 *buf;
+	for (i = 0; i < npre; i++) {
+		maxlen = R_MAX (maxlen, pre[i].len);
+	}
+	buf = malloc (PRELUDE_WINDOW + maxlen);
+	if (!buf) {
+		*nhits = -1;
+		return NULL;
+	}
+	for (at = from; at < to && !oom; at += PRELUDE_WINDOW) {
+		int wlen = (int)R_MIN (to - at, PRELUDE_WINDOW);
+		int rlen = (int)R_MIN (to - at, PRELUDE_WINDOW + maxlen);
+		int step, n;
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+		(void)r_io_read_at (core->io, at, buf, rlen);
+		n = (wlen < 65536)? 1: nth;
+		step = (wlen + n - 1) / n;
+		for (i = 0; i < n; i++) {
+			RCorePreludeChunk *c = &chunks[i];
+			memset (c, 0, sizeof (*c));
+			c->buf = buf;
+			c->len = rlen;
+			c->addr = at;
+			c->from = R_MIN (i * step, wlen);
+			c->to = R_MIN (c->from + step, wlen);
+			c->pre = pre;
+			c->npre = npre;
+			tasks[i] = (n > 1)? r_th_pool_submit (pool, prelude_scan_chunk, c): NULL;
+			if (!tasks[i]) {
+				prelude_scan_chunk (c);
+			}
+		}
+		for (i = 0; i < n; i++) {
+			RCorePreludeChunk *c = &chunks[i];
+			r_th_task_join (pool, tasks[i]);
+			if (c->oom) {
+				oom = true;
+			} else if (c->nhits > 0 && !oom) {
+				ut64 *tmp = realloc (hits, (count + c->nhits) * sizeof (ut64));
+				if (tmp) {
+					hits = tmp;
+					memcpy (hits + count, c->hits, c->nhits * sizeof (ut64));
+					count += c->nhits;
+				} else {
+					oom = true;
+				}
+			}
+			free (c->hits);
+		}
+	}
+	free (buf);
+	if (oom) {
+		free (hits);
+		*nhits = -1;
+		return NULL;
+	}
+	if (count > 1) {
+		int j = 0;
+		qsort (hits, count, sizeof (ut64), prelude_addr_cmp);
+		for (i = 1; i < count; i++) {
+			if (hits[i] != hits[j]) {
+				hits[++j] = hits[i];
+			}
+		}
+		count = j + 1;
+	}
+	*nhits = count;
+	return hits;
+}
+
+R_API int r_core_search_preludes(RCore *core) {
+	int ret = -1;
+	int depth = r_config_get_i (core->config, "anal.depth");
+	int fc0, fc1, i, npre, nhits;
 	int cfg_debug = r_config_get_i (core->config, "cfg.debug");
 	const char *where = cfg_debug? "dbg.map": "io.sections.exec";
-
+	RList *preludes = prelude_list (core);
 	RList *list = r_core_get_boundaries_prot (core, R_IO_EXEC, where);
+	RCorePrelude *pre = NULL, *p;
+	RThreadPool *pool = r_core_pool (core);
 	RListIter *iter;
-	RIOMap *p;
+	RIOMap *map;
 
+	npre = r_list_length (preludes);
+	if (npre > 0 && (pre = calloc (npre, sizeof (RCorePrelude)))) {
+		i = 0;
+		r_list_foreach (preludes, iter, p) {
+			pre[i++] = *p;
+		}
+	}
+	r_list_free (preludes);
 	fc0 = count_functions (core);
-	r_list_foreach (list, iter, p) {
-		eprintf ("\r[>] Scanning %s 0x%"PFMT64x " - 0x%"PFMT64x " ", r_str_rwx_i (p->flags), p->itv.addr, r_itv_end (p->itv));
-		if (!(p->flags & R_IO_EXEC)) {
+	r_cons_break_push (NULL, NULL);
+	r_list_foreach (list, iter, map) {
+		ut64 *hits;
+		eprintf ("\r[>] Scanning %s 0x%"PFMT64x " - 0x%"PFMT64x " ", r_str_rwx_i (map->flags), map->itv.addr, r_itv_end (map->itv));
+		if (!(map->flags & R_IO_EXEC)) {
 			eprintf ("skip\n");
 			continue;
 		}
-		from = p->itv.addr;
-		to = r_itv_end (p->itv);
-		if (prelude && *prelude) {
-			ut8 *kw = malloc (strlen (prelude) + 1);
-			int kwlen = r_hex_str2bin (prelude, kw);
-			ret = r_core_search_prelude (core, from, to, kw, kwlen, NULL, 0);
-			free (kw);
-		} else if (strstr (arch, "ppc")) {
-			ret = r_core_search_prelude (core, from, to,
-				(const ut8 *) "\x7c\x08\x02\xa6", 4, NULL, 0);
-		} else if (strstr (arch, "arm")) {
-			switch (bits) {
-			case 16:
-				ret = r_core_search_prelude (core, from, to,
-					(const ut8 *) "\xf0\xb5", 2, NULL, 0);
-				break;
-			case 32:
-				ret = r_core_search_prelude (core, from, to,
-					(const ut8 *) "\x00\x48\x2d\xe9", 4, NULL, 0);
-				break;
-			case 64:
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\xf6\x57\xbd\xa9", 4, NULL, 0);
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\xfd\x7b\xbf\xa9", 4, NULL, 0);
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\xfc\x6f\xbe\xa9", 4, NULL, 0);
-				break;
-			default:
-				eprintf ("ap: Unsupported bits: %d\n", bits);
-			}
-		} else if (strstr (arch, "mips")) {
-			ret = r_core_search_prelude (core, from, to,
-				(const ut8 *) "\x27\xbd\x00", 3, NULL, 0);
-		} else if (strstr (arch, "x86")) {
-			switch (bits) {
-			case 32:
-				r_core_search_prelude (core, from, to, // mov edi, edi;push ebp; mov ebp,esp
-					(const ut8 *) "\x8b\xff\x55\x8b\xec", 5, NULL, 0);
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\x55\x89\xe5", 3, NULL, 0);
-				r_core_search_prelude (core, from, to, // push ebp; mov ebp, esp
-					(const ut8 *) "\x55\x8b\xec", 3, NULL, 0);
-				break;
-			case 64:
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\x55\x48\x89\xe5", 4, NULL, 0);
-				r_core_search_prelude (core, from, to,
-					(const ut8 *) "\x55\x48\x8b\xec", 4, NULL, 0);
-				break;
-			default:
-				eprintf ("ap: Unsupported bits: %d\n", bits);
+		if (!pre) {
+			eprintf ("done\n");
+			continue;
+		}
+		hits = prelude_scan (core, pool, map->itv.addr, r_itv_end (map->itv), pre, npre, &nhits);
+		if (nhits < 0) {
+			eprintf ("\nap: Cannot allocate the prelude hits, search aborted\n");
+			ret = -1;
+			break;
+		}
+		/* r_core_anal_fcn is not reentrant, the analysis runs here */
+		for (i = 0; i < nhits && !r_cons_is_breaked (); i++) {
+			if (r_anal_get_fcn_at (core->anal, hits[i], 0)) {
+				continue;
 			}
-		} else {
-			eprintf ("ap: Unsupported asm.arch and asm.bits\n");
+			r_core_anal_fcn (core, hits[i], -1, R_ANAL_REF_TYPE_NULL, depth);
 		}
+		ret = nhits;
+		free (hits);
 		eprintf ("done\n");
 	}
+	r_cons_break_pop ();
+	free (pre);
 	fc1 = count_functions (core);
 	r_list_free (list);
 	eprintf ("Analyzed %d functions based on preludes\n", fc1 - fc0);
@@ -1151,6 +1351,8 @@ R_API RList *r_core_get_boundaries_ok(RCore *core) {
 	return list;
 }
 
+static void rop_index_add(RCore *core, RList *hitlist);
+
 static int r_core_search_rop(RCore *core, RAddrInterval search_itv, int opt, const char *grep, int regexp) {
 	RSearch *search = core->search;
 	const ut8 crop = r_config_get_i (core->config, "rop.conditional");      // decide if cjmp, cret, and ccall should be used too for the gadget-search
@@ -1390,6 +1592,11 @@ static int r_core_search_rop(RCore *core, RAddrInterval search_itv, int opt, con
 					if (align && (0 != ((from + i) % align))) {
 						continue;
 					}
+					if (mode == 'i') {
+						rop_index_add (core, hitlist);
+						r_list_free (hitlist);
+						continue;
+					}
 					if (json) {
 						mode = 'j';
 					}
@@ -1427,6 +1634,387 @@ static int r_core_search_rop(RCore *core, RAddrInterval search_itv, int opt, con
 	return true;
 }
 
+static void rop_index_key_free(RopIndexKey *k) {
+	if (k) {
+		free (k->name);
+		r_strbuf_free (k->addrs);
+		free (k);
+	}
+}
+
+static void rop_index_push(RCoreRopIndex *ri, const char *name, ut64 addr) {
+	RopIndexKey *k;
+	RListIter *iter;
+	r_list_foreach (ri->keys, iter, k) {
+		if (!strcmp (k->name, name)) {
+			r_strbuf_appendf (k->addrs, ",0x%"PFMT64x, addr);
+			return;
+		}
+	}
+	if ((k = R_NEW0 (RopIndexKey))) {
+		k->name = strdup (name);
+		k->addrs = r_strbuf_new (NULL);
+		r_strbuf_appendf (k->addrs, "0x%"PFMT64x, addr);
+		r_list_append (ri->keys, k);
+	}
+}
+
+static const char *rop_classes[] = { "nop", "mov", "const", "arithm", "arithm_ct", NULL };
+
+/* registers written by an esil expression, appended to regs as ",name," */
+static void rop_esil_dsts(RCore *core, const char *esil, RStrBuf *regs) {
+	char *dup = strdup (esil), *prev = NULL, *tok, *save = NULL;
+	for (tok = strtok_r (dup, ",", &save); tok; tok = strtok_r (NULL, ",", &save)) {
+		size_t len = strlen (tok);
+		if (prev && len > 0 && tok[len - 1] == '=' && strcmp (tok, "==")
+				&& r_reg_get (core->anal->reg, prev, -1)) {
+			const char *cur = r_strbuf_get (regs);
+			if (!strstr (cur, sdb_fmt (0, ",%s,", prev))) {
+				r_strbuf_appendf (regs, "%s%s,", *cur? "": ",", prev);
+			}
+		}
+		prev = tok;
+	}
+	free (dup);
+}
+
+static void rop_index_add(RCore *core, RList *hitlist) {
+	RCoreRopIndex *ri = core->rop_index;
+	RStrBuf *regs = r_strbuf_new (NULL);
+	RList *ropList = r_list_newf (free);
+	RCoreAsmHit *hit = NULL;
+	RAnalOp analop = R_EMPTY;
+	char *classes = NULL, *key, *p;
+	const char *end = "";
+	RListIter *iter;
+	ut64 addr;
+	int i, size = 0, ninstr = 0;
+	if (!ri || !hitlist || !hitlist->head || !regs || !ropList) {
+		r_strbuf_free (regs);
+		r_list_free (ropList);
+		return;
+	}
+	addr = ((RCoreAsmHit *) hitlist->head->data)->addr;
+	r_list_foreach (hitlist, iter, hit) {
+		ut8 buf[32];
+		int len = R_MIN (hit->len, sizeof (buf));
+		r_core_read_at (core, hit->addr, buf, len);
+		r_anal_op (core->anal, &analop, hit->addr, buf, len);
+		size += hit->len;
+		ninstr++;
+		if (analop.type != R_ANAL_OP_TYPE_RET) {
+			r_list_append (ropList, r_str_newf (" %s", R_STRBUF_SAFEGET (&analop.esil)));
+		}
+		rop_esil_dsts (core, R_STRBUF_SAFEGET (&analop.esil), regs);
+		end = r_anal_optype_to_string (analop.type);
+		r_anal_op_fini (&analop);
+	}
+	key = r_str_newf ("0x%08"PFMT64x, addr);
+	rop_classify (core, ri->cls, ropList, key, size);
+	for (i = 0; rop_classes[i]; i++) {
+		Sdb *ns = sdb_ns (ri->cls, rop_classes[i], false);
+		if (ns && sdb_const_get (ns, key, 0)) {
+			classes = r_str_appendf (classes, "%s%s", classes? ",": "", rop_classes[i]);
+			rop_index_push (ri, sdb_fmt (0, "class.%s", rop_classes[i]), addr);
+		}
+	}
+	rop_index_push (ri, "all", addr);
+	rop_index_push (ri, sdb_fmt (0, "end.%s", end), addr);
+	/* ",rax,rbx," -> "rax,rbx" */
+	p = r_strbuf_get (regs);
+	if (*p) {
+		p++;
+		p[strlen (p) - 1] = 0;
+	}
+	if (*p) {
+		char *r, *save = NULL;
+		char *dup = strdup (p);
+		for (r = strtok_r (dup, ",", &save); r; r = strtok_r (NULL, ",", &save)) {
+			rop_index_push (ri, sdb_fmt (0, "reg.%s", r), addr);
+		}
+		free (dup);
+	}
+	/* size ninstr end classes regs */
+	sdb_set_owned (ri->db, key, r_str_newf ("%d %d %s %s %s", size, ninstr,
+		end, classes? classes: "-", *p? p: "-"), 0);
+	free (classes);
+	free (key);
+	r_strbuf_free (regs);
+	r_list_free (ropList);
+}
+
+/* the settings the gadgets depend on, the searched range, every map read
+ * and two hashes of their bytes. The cache file is named by a hash of this
+ * key and stores it, so a colliding name is not mistaken for a hit */
+static char *rop_index_cache_key(RCore *core, RAddrInterval search_itv) {
+	RStrBuf *key = r_strbuf_new ("");
+	RList *list;
+	RListIter *iter;
+	RIOMap *map;
+	ut32 h = CDB_HASHSTART;
+	ut64 h64 = 0xcbf29ce484222325ULL;
+	ut8 *buf;
+	ut64 i;
+	if (!key) {
+		return NULL;
+	}
+	r_strbuf_setf (key, "%s.%s.%d.%d.%d.%d.%"PFMT64x".%"PFMT64x,
+		r_config_get (core->config, "asm.arch"),
+		r_config_get (core->config, "asm.cpu"),
+		(int)r_config_get_i (core->config, "asm.bits"),
+		(int)r_config_get_i (core->config, "rop.len"),
+		(int)r_config_get_i (core->config, "rop.conditional"),
+		core->search->align, search_itv.addr, search_itv.size);
+	list = r_core_get_boundaries_ok (core);
+	r_list_foreach (list, iter, map) {
+		RAddrInterval itv;
+		if (!r_itv_overlap (search_itv, map->itv)) {
+			continue;
+		}
+		itv = r_itv_intersect (search_itv, map->itv);
+		if (!(buf = malloc (itv.size))) {
+			continue;
+		}
+		(void)r_io_read_at (core->io, itv.addr, buf, itv.size);
+		for (i = 0; i < itv.size; i++) {
+			h = (h + (h << 5)) ^ buf[i];
+			h64 = (h64 ^ buf[i]) * 0x100000001b3ULL;
+		}
+		r_strbuf_appendf (key, ".%"PFMT64x"-%"PFMT64x, itv.addr, itv.size);
+		free (buf);
+	}
+	r_list_free (list);
+	r_strbuf_appendf (key, ".%08x.%016"PFMT64x, h, h64);
+	return r_strbuf_drain (key);
+}
+
+static char *rop_index_cache_path(RCore *core, const char *key) {
+	const char *dir = r_config_get (core->config, "rop.cache");
+	char *path, *adir;
+	if (!dir || !*dir || !key) {
+		return NULL;
+	}
+	adir = r_file_abspath (dir);
+	path = r_str_newf ("%s"R_SYS_DIR"rop-%08x.sdb", adir, sdb_hash (key));
+	free (adir);
+	return path;
+}
+
+R_API void r_core_rop_index_free(RCoreRopIndex *ri) {
+	if (ri) {
+		r_list_free (ri->keys);
+		sdb_free (ri->cls);
+		free (ri);
+	}
+}
+
+static void rop_index_reset(RCore *core) {
+	Sdb *db = sdb_ns (core->sdb, "ropidx", false);
+	if (db) {
+		sdb_reset (db);
+	}
+}
+
+/* scan all the executable maps once and keep every gadget with its end
+ * instruction type, semantic classes and written registers */
+static void rop_index_build(RCore *core, RAddrInterval search_itv) {
+	Sdb *db = sdb_ns (core->sdb, "ropidx", true);
+	const char *cache_dir = r_config_get (core->config, "rop.cache");
+	char *key = (cache_dir && *cache_dir)? rop_index_cache_key (core, search_itv): NULL;
+	char *path = rop_index_cache_path (core, key);
+	RCoreRopIndex *ri;
+	RopIndexKey *k;
+	RListIter *iter;
+	if (!db) {
+		free (path);
+		free (key);
+		return;
+	}
+	sdb_reset (db);
+	if (path && r_file_exists (path)) {
+		Sdb *cache = sdb_new (NULL, path, 0);
+		const char *ckey = cache? sdb_const_get (cache, "key", 0): NULL;
+		if (ckey && !strcmp (ckey, key) && sdb_const_get (cache, "all", 0)) {
+			sdb_merge (db, cache);
+			sdb_unset (db, "key", 0);
+			sdb_free (cache);
+			eprintf ("Loaded %d gadgets from %s\n",
+				(int)sdb_num_get (db, "count", 0), path);
+			free (path);
+			free (key);
+			return;
+		}
+		sdb_free (cache);
+	}
+	if (!(ri = R_NEW0 (RCoreRopIndex))) {
+		free (path);
+		free (key);
+		return;
+	}
+	ri->db = db;
+	ri->cls = sdb_new0 ();
+	ri->keys = r_list_newf ((RListFree)rop_index_key_free);
+	core->rop_index = ri;
+	r_core_search_rop (core, search_itv, 0, "i", 0);
+	core->rop_index = NULL;
+	r_list_foreach (ri->keys, iter, k) {
+		sdb_set (db, k->name, r_strbuf_get (k->addrs), 0);
+	}
+	sdb_num_set (db, "count", sdb_alen (sdb_const_get (db, "all", 0)), 0);
+	r_core_rop_index_free (ri);
+	eprintf ("Indexed %d gadgets\n", (int)sdb_num_get (db, "count", 0));
+	if (path) {
+		char *dir = r_file_dirname (path);
+		if (r_file_is_directory (dir) || r_sys_mkdirp (dir)) {
+			Sdb *cache = sdb_new (NULL, path, 0);
+			if (cache) {
+				sdb_reset (cache);
+				sdb_merge (cache, db);
+				sdb_set (cache, "key", key, 0);
+				sdb_sync (cache);
+				sdb_free (cache);
+			}
+		}
+		free (dir);
+	}
+	free (path);
+}
+
+static void rop_index_print(RCore *core, ut64 addr, const char *info) {
+	int i, ninstr = 0, size = 0;
+	char *dup = strdup (info);
+	char *argv[5] = {0};
+	char *save = NULL, *tok;
+	ut8 buf[32];
+	ut64 at = addr;
+	for (i = 0, tok = strtok_r (dup, " ", &save); tok && i < 5; tok = strtok_r (NULL, " ", &save)) {
+		argv[i++] = tok;
+	}
+	size = argv[0]? atoi (argv[0]): 0;
+	ninstr = argv[1]? atoi (argv[1]): 0;
+	r_cons_printf ("0x%08"PFMT64x ":", addr);
+	for (i = 0; i < ninstr && at < addr + size; i++) {
+		RAsmOp asmop;
+		r_core_read_at (core, at, buf, sizeof (buf));
+		r_asm_set_pc (core->assembler, at);
+		if (r_asm_disassemble (core->assembler, &asmop, buf, sizeof (buf)) < 1) {
+			break;
+		}
+		r_cons_printf (" %s;", asmop.buf_asm);
+		at += asmop.size;
+	}
+	r_cons_printf ("  # %s %s %s\n", argv[2]? argv[2]: "",
+		argv[3]? argv[3]: "", argv[4]? argv[4]: "");
+	free (dup);
+}
+
+/* match one gadget record against the filters */
+static bool rop_index_match(const char *info, RList *filters) {
+	char *dup = strdup (info);
+	char *argv[5] = {0};
+	char *save = NULL, *tok, *f;
+	RListIter *iter;
+	bool ok = true;
+	int i;
+	for (i = 0, tok = strtok_r (dup, " ", &save); tok && i < 5; tok = strtok_r (NULL, " ", &save)) {
+		argv[i++] = tok;
+	}
+	if (i < 5) {
+		free (dup);
+		return false;
+	}
+	r_list_foreach (filters, iter, f) {
+		bool neg = *f == '!';
+		const char *arg = neg? f + 1: f;
+		const char *val = strchr (arg, '=');
+		bool has = false;
+		if (!val) {
+			continue;
+		}
+		val++;
+		if (!strncmp (arg, "len=", 4)) {
+			has = atoi (argv[1]) <= atoi (val);
+		} else if (!strncmp (arg, "end=", 4)) {
+			has = !strcmp (argv[2], val);
+		} else {
+			const char *set = !strncmp (arg, "class=", 6)? argv[3]: argv[4];
+			char *item = r_str_newf (",%s,", val);
+			char *list = r_str_newf (",%s,", set);
+			has = strstr (list, item) != NULL;
+			free (item);
+			free (list);
+		}
+		if (has == neg) {
+			ok = false;
+			break;
+		}
+	}
+	free (dup);
+	return ok;
+}
+
+/* candidates come from the shortest address list among the positive
+ * filters, every candidate is then checked against all of them */
+static void rop_index_query(RCore *core, const char *input) {
+	Sdb *db = sdb_ns (core->sdb, "ropidx", false);
+	const char *best = NULL, *addrs;
+	bool quiet = *input == 'q';
+	RList *filters;
+	RListIter *iter;
+	char *f, *dup, *a, *args, *save = NULL;
+	if (!db || !sdb_const_get (db, "all", 0)) {
+		eprintf ("No gadget index, run /Ri first\n");
+		return;
+	}
+	if (quiet) {
+		input++;
+	}
+	filters = r_list_new ();
+	args = strdup (input);
+	for (f = strtok_r (args, " ", &save); f; f = strtok_r (NULL, " ", &save)) {
+		r_list_append (filters, f);
+	}
+	save = NULL;
+	best = sdb_const_get (db, "all", 0);
+	r_list_foreach (filters, iter, f) {
+		const char *key = NULL;
+		if (!strncmp (f, "end=", 4)) {
+			key = sdb_fmt (0, "end.%s", f + 4);
+		} else if (!strncmp (f, "class=", 6)) {
+			key = sdb_fmt (0, "class.%s", f + 6);
+		} else if (!strncmp (f, "reg=", 4)) {
+			key = sdb_fmt (0, "reg.%s", f + 4);
+		} else {
+			continue;
+		}
+		addrs = sdb_const_get (db, key, 0);
+		if (!addrs) {
+			best = NULL;
+			break;
+		}
+		if (strlen (addrs) < strlen (best)) {
+			best = addrs;
+		}
+	}
+	if (best) {
+		dup = strdup (best);
+		for (a = strtok_r (dup, ",", &save); a; a = strtok_r (NULL, ",", &save)) {
+			const char *info = sdb_const_get (db, sdb_fmt (0, "0x%08"PFMT64x, r_num_get (NULL, a)), 0);
+			if (!info || !rop_index_match (info, filters)) {
+				continue;
+			}
+			if (quiet) {
+				r_cons_println (a);
+			} else {
+				rop_index_print (core, r_num_get (NULL, a), info);
+			}
+		}
+		free (dup);
+	}
+	r_list_free (filters);
+	free (args);
+}
+
 static int esil_addrinfo(RAnalEsil *esil) {
 	RCore *core = (RCore *) esil->cb.user;
 	ut64 num = 0;
@@ -2249,6 +2837,18 @@ reread:
 			} else {
 				rop_kuery (core, input + 2);
 			}
+		} else if (input[1] == 'i') {
+			if (input[2] == '-') {
+				rop_index_reset (core);
+			} else {
+				rop_index_build (core, search_itv);
+			}
+		} else if (input[1] == 'q') {
+			if (input[2] == '?') {
+				r_core_cmd_help (core, help_msg_slash_Rq);
+			} else {
+				rop_index_query (core, input + 2);
+			}
 		} else {
 			r_core_search_rop (core, search_itv, 0, input + 1, 0);
 		}
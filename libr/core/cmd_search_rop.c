@@ -685,7 +685,7 @@ static int rop_classify_nops(RCore *core, RList *ropList) {
 
 static void rop_classify (RCore *core, Sdb *db, RList *ropList, const char *key, unsigned int size) {
 	Sdb *db_nop = NULL, *db_mov = NULL, *db_ct = NULL, *db_aritm = NULL, *db_aritm_ct = NULL;
-	int nop = 0;  rop_classify_nops (core, ropList);
+	int nop = 0;
 	char *mov, *ct, *arithm, *arithm_ct, *str;
 	db_nop = sdb_ns (db, "nop", true);
 	db_mov = sdb_ns (db, "mov", true);
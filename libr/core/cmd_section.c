@@ -254,6 +254,8 @@ static void update_section_flag_at_with_oldname(RIOSection *s, RFlag *flags, ut6
 	const RList *list = NULL;
 	int len = 0;
 	char *secname = NULL;
+	/* the renames below take it again */
+	r_th_rwlock_write_enter (flags->lock);
 	list = r_flag_get_list (flags, s->vaddr);
 	secname = sdb_fmt (-1, "section.%s", oldname);
 	len = strlen (secname);
@@ -262,11 +264,7 @@ static void update_section_flag_at_with_oldname(RIOSection *s, RFlag *flags, ut6
 			continue;
 		}
 		if (!strncmp (item->name, secname, R_MIN (strlen (item->name), len))) {
-			free (item->realname);
-			item->name = strdup (sdb_fmt (-1, "section.%s", s->name));
-			r_str_chop (item->name);
-			r_name_filter (item->name, 0);
-			item->realname = item->name;
+			r_flag_rename (flags, item, sdb_fmt (-1, "section.%s", s->name));
 			break;
 		}
 	}
@@ -278,14 +276,11 @@ static void update_section_flag_at_with_oldname(RIOSection *s, RFlag *flags, ut6
 			continue;
 		}
 		if (!strncmp (item->name, secname, R_MIN (strlen (item->name), len))) {
-			free (item->realname);
-			item->name = strdup (sdb_fmt (-1, "section_end.%s", s->name));
-			r_str_chop (item->name);
-			r_name_filter (item->name, 0);
-			item->realname = item->name;
+			r_flag_rename (flags, item, sdb_fmt (-1, "section_end.%s", s->name));
 			break;
 		}
 	}
+	r_th_rwlock_write_leave (flags->lock);
 }
 
 static int cmd_section_reapply(RCore *core, const char *input) {
@@ -333,6 +333,7 @@ out_case_manual:
 			}
 
 			r_cons_break_push (NULL, NULL);
+			r_th_rwlock_read_enter (core->anal->fcns_lock);
 			r_list_foreach (core->anal->fcns, iter, fcni) {
 				if (r_cons_is_breaked ()) {
 					break;
@@ -343,6 +344,7 @@ out_case_manual:
 					break;
 				}
 			}
+			r_th_rwlock_read_leave (core->anal->fcns_lock);
 			r_cons_break_pop ();
 
 out_case_fcn:
@@ -357,6 +359,7 @@ out_case_fcn:
 			int count = 0;
 
 			r_cons_break_push (NULL, NULL);
+			r_th_rwlock_read_enter (core->anal->fcns_lock);
 			r_list_foreach (core->anal->fcns, iter, fcni) {
 				if (r_cons_is_breaked ()) {
 					break;
@@ -364,6 +367,7 @@ out_case_fcn:
 				addFcnZign (core, fcni, NULL);
 				count++;
 			}
+			r_th_rwlock_read_leave (core->anal->fcns_lock);
 			r_cons_break_pop ();
 			eprintf ("generated zignatures: %d\n", count);
 		}
@@ -641,6 +645,7 @@ static bool search(RCore *core, bool rad) {
 	if (useGraph || useOffset || useRefs) {
 		eprintf ("[+] searching function metrics\n");
 		r_cons_break_push (NULL, NULL);
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcni) {
 			if (r_cons_is_breaked ()) {
 				break;
@@ -655,6 +660,7 @@ static bool search(RCore *core, bool rad) {
 				r_sign_match_refs (core->anal, fcni, fcnMatchCB, &refs_match_ctx);
 			}
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 		r_cons_break_pop ();
 	}
 
@@ -740,6 +746,7 @@ static int cmdCheck(void *data, const char *input) {
 	if (useGraph || useOffset || useRefs) {
 		eprintf ("[+] searching function metrics\n");
 		r_cons_break_push (NULL, NULL);
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcni) {
 			if (r_cons_is_breaked ()) {
 				break;
@@ -757,6 +764,7 @@ static int cmdCheck(void *data, const char *input) {
 				break;
 			}
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 		r_cons_break_pop ();
 	}
 
@@ -269,6 +269,19 @@ static void core_post_write_callback(void *user, ut64 maddr, ut8 *bytes, int cnt
 	RIOSection *sec;
 	ut64 vaddr;
 
+	if (!core->io->va && (sec = r_io_section_get (core->io, maddr))) {
+		vaddr = maddr + sec->vaddr - sec->paddr;
+	} else {
+		vaddr = maddr;
+	}
+	/* the breakpoints write and restore the code under the debugger, the
+	 * blocks are only marked then and analyzed again by the next af */
+	if (r_config_get_i (core->config, "cfg.debug")) {
+		r_anal_fcn_invalidate (core->anal, vaddr, cnt);
+	} else {
+		r_anal_fcn_refresh (core->anal, vaddr, cnt);
+	}
+
 	if (!r_config_get_i (core->config, "asm.cmtpatch")) {
 		return;
 	}
@@ -286,12 +299,6 @@ static void core_post_write_callback(void *user, ut64 maddr, ut8 *bytes, int cnt
 		return;
 	}
 
-	if ((sec = r_io_section_get (core->io, maddr))) {
-		vaddr = maddr + sec->vaddr - sec->paddr;
-	} else {
-		vaddr = maddr;
-	}
-
 	r_meta_add (core->anal, R_META_TYPE_COMMENT, vaddr, vaddr, comment);
 	free (comment);
 }
@@ -848,6 +855,7 @@ static int autocomplete(RLine *line) {
 			ptr = (char *)r_str_chop_ro (ptr+1);
 			n = strlen (ptr);//(line->buffer.data+sdelta);
 			sdelta = (int)(size_t)(ptr - line->buffer.data);
+			r_th_rwlock_read_enter (core->flags->lock);
 			r_list_foreach (core->flags->flags, iter, flag) {
 				if (!strncmp (flag->name, line->buffer.data+sdelta, n)) {
 					tmp_argv[i++] = flag->name;
@@ -856,6 +864,7 @@ static int autocomplete(RLine *line) {
 					}
 				}
 			}
+			r_th_rwlock_read_leave (core->flags->lock);
 			tmp_argv[i] = NULL;
 			line->completion.argc = i;
 			line->completion.argv = tmp_argv;
@@ -1206,6 +1215,7 @@ static int autocomplete(RLine *line) {
 				? 2 : (line->buffer.data[2] == ' ')
 				? 3 : 4;
 			n = strlen (line->buffer.data + sdelta);
+			r_th_rwlock_read_enter (core->flags->lock);
 			r_list_foreach (core->flags->flags, iter, flag) {
 				if (!strncmp (flag->name, line->buffer.data + sdelta, n)) {
 					tmp_argv[i++] = flag->name;
@@ -1214,6 +1224,7 @@ static int autocomplete(RLine *line) {
 					}
 				}
 			}
+			r_th_rwlock_read_leave (core->flags->lock);
 			tmp_argv[i>255?255:i] = NULL;
 			line->completion.argc = i;
 			line->completion.argv = tmp_argv;
@@ -1772,7 +1783,7 @@ R_API bool r_core_init(RCore *core) {
 	core->io->cb_core_cmdstr = core_cmdstr_callback;
 	core->io->cb_core_post_write = core_post_write_callback;
 	core->search = r_search_new (R_SEARCH_KEYWORD);
-	r_io_undo_enable (core->io, 1, 0); // TODO: configurable via eval
+	r_io_undo_enable (core->io, 1, 0); // writes follow io.undo
 	core->fs = r_fs_new ();
 	core->flags = r_flag_new ();
 	core->flags->cb_printf = r_cons_printf;
@@ -1836,6 +1847,15 @@ R_API bool r_core_init(RCore *core) {
 	return 0;
 }
 
+/* the thread pool shared by the parallel passes, started on first use.
+ * NULL with a single processor, the callers then do the work inline */
+R_API RThreadPool *r_core_pool(RCore *core) {
+	if (!core->pool && r_th_ncpus () > 1) {
+		core->pool = r_th_pool_new (0);
+	}
+	return core->pool;
+}
+
 R_API RCore *r_core_fini(RCore *c) {
 	if (!c) {
 		return NULL;
@@ -1847,6 +1867,10 @@ R_API RCore *r_core_fini(RCore *c) {
 	R_FREE (c->lastsearch);
 	c->cons->pager = NULL;
 	r_core_task_join (c, NULL);
+	r_th_pool_free (c->pool);
+	c->pool = NULL;
+	r_core_rop_index_free (c->rop_index);
+	c->rop_index = NULL;
 	free (c->cmdqueue);
 	free (c->lastcmd);
 	free (c->block);
@@ -2165,12 +2189,86 @@ static void rap_break (void *u) {
 	}
 }
 
+/* rap replies waiting to be written together */
+typedef struct {
+	ut8 *buf;
+	int len;
+	int size;
+} RapOut;
+
+static ut8 *rap_out_reserve(RapOut *o, int n) {
+	if (o->len + n > o->size) {
+		int size = R_MAX (o->size * 2, o->len + n);
+		ut8 *buf = realloc (o->buf, size);
+		if (!buf) {
+			return NULL;
+		}
+		o->buf = buf;
+		o->size = size;
+	}
+	return o->buf + o->len;
+}
+
+static void rap_out_flush(RSocket *c, RapOut *o) {
+	if (o->len > 0) {
+		r_socket_write (c, o->buf, o->len);
+		r_socket_flush (c);
+		o->len = 0;
+	}
+}
+
+/* more requests are queued, their replies can go in the same write */
+static bool rap_pending(RSocket *c) {
+#if __UNIX__ || defined(__CYGWIN__)
+	return r_socket_ready (c, 0, 0) > 0;
+#else
+	return false;
+#endif
+}
+
+/* the page is read straight into the output, when compressing it goes
+ * after the room of the compressed one and is only moved if it does not
+ * get smaller */
+static bool rap_readat(RCore *core, RSocket *c, RapOut *o, ut32 caps) {
+	ut8 req[12], *p;
+	int len, clen, bound;
+	ut64 addr;
+	if (r_socket_read_block (c, req, 12) != 12) {
+		return false;
+	}
+	addr = r_read_be64 (req);
+	len = R_MIN (r_read_be32 (req + 8), RMT_READAT_MAX);
+	bound = r_lz4_bound (len);
+	if (!(p = rap_out_reserve (o, 9 + bound + len))) {
+		return false;
+	}
+	p[0] = RMT_READAT | RMT_REPLY;
+	r_write_be32 (p + 1, len);
+	clen = len;
+	if ((caps & RMT_CAP_LZ4) && len > 0) {
+		ut8 *raw = p + 9 + bound;
+		r_io_read_at (core->io, addr, raw, len);
+		clen = r_lz4_compress (raw, len, p + 9, len - 1);
+		if (clen < 1) {
+			memcpy (p + 9, raw, len);
+			clen = len;
+		}
+	} else {
+		r_io_read_at (core->io, addr, p + 9, len);
+	}
+	r_write_be32 (p + 5, clen);
+	o->len += 9 + clen;
+	return true;
+}
+
 // TODO: PLEASE move into core/io/rap? */
 // TODO: use static buffer instead of mallocs all the time. it's network!
 R_API int r_core_serve(RCore *core, RIODesc *file) {
 	ut8 cmd, flg, *ptr = NULL, buf[1024];
 	RSocket *c, *fd;
 	int i, pipefd = -1;
+	RapOut out = {0};
+	ut32 caps = 0;
 	RIORap *rior;
 	ut64 x;
 
@@ -2199,7 +2297,12 @@ reaccept:
 			goto out_of_function;
 		}
 		eprintf ("rap: client connected\n");
+		out.len = 0;
+		caps = 0;
 		for (;!r_cons_is_breaked ();) {
+			if (!rap_pending (c)) {
+				rap_out_flush (c, &out);
+			}
 			if (!r_socket_read (c, &cmd, 1)) {
 				eprintf ("rap: connection closed\n");
 				if (r_config_get_i (core->config, "rap.loop")) {
@@ -2209,7 +2312,17 @@ reaccept:
 				}
 				goto out_of_function;
 			}
+			if (cmd != RMT_READAT) {
+				rap_out_flush (c, &out);
+			}
 			switch ((ut8)cmd) {
+			case RMT_READAT:
+				if (!rap_readat (core, c, &out, caps)) {
+					eprintf ("rap: cannot read\n");
+					r_socket_free (c);
+					goto out_of_function;
+				}
+				break;
 			case RMT_OPEN:
 				r_socket_read_block (c, &flg, 1); // flags
 				eprintf ("open (%d): ", cmd);
@@ -2369,7 +2482,18 @@ reaccept:
 			case RMT_SEEK:
 				r_socket_read_block (c, buf, 9);
 				x = r_read_at_be64 (buf, 1);
-				if (buf[0] == 2) {
+				if (buf[0] == RMT_HELLO) {
+					/* rap v2, old clients never send this whence */
+					caps = 0;
+					if ((x & ~(ut64)UT32_MAX) == RMT_MAGIC) {
+						caps = RMT_CAP_READAT;
+						if (r_config_get_i (core->config, "rap.compress")) {
+							caps |= RMT_CAP_LZ4;
+						}
+						caps &= x;
+					}
+					x = RMT_MAGIC | caps;
+				} else if (buf[0] == 2) {
 					if (core->file) {
 						x = r_io_fd_size (core->io, core->file->fd);
 					} else {
@@ -2412,6 +2536,7 @@ reaccept:
 	}
 out_of_function:
 	r_cons_break_pop ();
+	free (out.buf);
 	return -1;
 }
 
@@ -211,6 +211,11 @@ typedef struct r_disam_options_t {
 	RAsmOp asmop;
 	RAnalOp analop;
 	RAnalFunction *fcn;
+	RList *wfcns; // functions overlapping [wfrom, wto)
+	ut64 wfrom, wto;
+	RList *refs, *xrefs; // refs from and to refs_at, see ds_fetch_refs
+	ut64 refs_at;
+	bool refs_fetched;
 	const ut8 *buf;
 	int len;
 	int maxrefs;
@@ -659,9 +664,95 @@ static void ds_free(RDisasmState *ds) {
 	free (ds->osl);
 	free (ds->sl);
 	free (ds->_tabsbuf);
+	r_list_free (ds->wfcns);
+	r_list_free (ds->refs);
+	r_list_free (ds->xrefs);
 	R_FREE (ds);
 }
 
+static bool ds_prefetch_fcn(RAnalFunction *fcn, void *user) {
+	return r_list_append ((RList *)user, fcn) != NULL;
+}
+
+/* gather the functions that may contain any address of the window to be
+ * printed, so the per-line lookups only have to check those. The interval
+ * tree answers it unless it is behind the list, then the list is walked */
+static void ds_prefetch_fcns(RDisasmState *ds, ut64 from, ut64 to) {
+	RAnal *anal = ds->core->anal;
+	RAnalFunction *fcn;
+	RListIter *iter;
+	r_list_free (ds->wfcns);
+	ds->wfrom = from;
+	ds->wto = to;
+	ds->wfcns = (from < to)? r_list_new (): NULL;
+	if (!ds->wfcns) {
+		return;
+	}
+	r_th_rwlock_read_enter (anal->fcns_lock);
+	if (anal->fcn_tree_count == r_list_length (anal->fcns)) {
+		r_anal_fcn_tree_foreach_in (anal, from, to, ds_prefetch_fcn, ds->wfcns);
+		r_th_rwlock_read_leave (anal->fcns_lock);
+		return;
+	}
+	r_list_foreach (anal->fcns, iter, fcn) {
+		ut64 min = fcn->addr;
+		ut64 max = fcn->addr + 1;
+		if (r_list_empty (fcn->bbs)) {
+			max = fcn->addr + fcn->_size;
+		} else if (fcn->bbr.pairs > 0) {
+			min = R_MIN (min, fcn->bbr.ranges[0]);
+			max = R_MAX (max, fcn->bbr.ranges[(fcn->bbr.pairs * 2) - 1]);
+		}
+		if (min < to && max > from) {
+			r_list_append (ds->wfcns, fcn);
+		}
+	}
+	r_th_rwlock_read_leave (anal->fcns_lock);
+}
+
+/* the refs from and to an address, fetched once per line. The xrefs live
+ * in sdb keyed by address and have no range lookup, so they can not be
+ * gathered for the whole window like the functions. The lists belong to
+ * ds, do not free them */
+static void ds_fetch_refs(RDisasmState *ds, ut64 at) {
+	if (ds->refs_fetched && ds->refs_at == at) {
+		return;
+	}
+	r_list_free (ds->refs);
+	r_list_free (ds->xrefs);
+	ds->refs = r_anal_refs_get (ds->core->anal, at);
+	ds->xrefs = r_anal_xrefs_get (ds->core->anal, at);
+	ds->refs_at = at;
+	ds->refs_fetched = true;
+}
+
+static RList *ds_refs(RDisasmState *ds, ut64 at) {
+	ds_fetch_refs (ds, at);
+	return ds->refs;
+}
+
+static RList *ds_xrefs(RDisasmState *ds, ut64 at) {
+	ds_fetch_refs (ds, at);
+	return ds->xrefs;
+}
+
+/* same as r_anal_get_fcn_in but served from the prefetched window */
+static RAnalFunction *ds_fcn_in(RDisasmState *ds, ut64 at, int type) {
+	RAnalFunction *fcn;
+	RListIter *iter;
+	if (!ds->wfcns || type == R_ANAL_FCN_TYPE_ROOT || at < ds->wfrom || at >= ds->wto) {
+		return r_anal_get_fcn_in (ds->core->anal, at, type);
+	}
+	r_list_foreach (ds->wfcns, iter, fcn) {
+		if (!type || fcn->type & type) {
+			if (fcn->addr == at || r_anal_fcn_is_in_offset (fcn, at)) {
+				return fcn;
+			}
+		}
+	}
+	return NULL;
+}
+
 static void ds_set_pre(RDisasmState *ds, const char * str) {
 	if (!ds->show_fcnlines) {
 		if (ds->pre && !*ds->pre) {
@@ -746,7 +837,7 @@ static void ds_build_op_str(RDisasmState *ds) {
 	core->parser->relsub_addr = 0;
 	if (ds->varsub && ds->opstr) {
 		ut64 at = ds->vat;
-		RAnalFunction *f = r_anal_get_fcn_in (core->anal, at, R_ANAL_FCN_TYPE_NULL);
+		RAnalFunction *f = ds_fcn_in (ds, at, R_ANAL_FCN_TYPE_NULL);
 		core->parser->varlist = r_anal_var_list_dynamic;
 		r_parse_varsub (core->parser, f, at, ds->analop.size,
 			ds->opstr, ds->strsub, sizeof (ds->strsub));
@@ -755,7 +846,7 @@ static void ds_build_op_str(RDisasmState *ds) {
 			ds->opstr = strdup (ds->strsub);
 		}
 		if (core->parser->relsub) {
-			RList *list = r_anal_refs_get (core->anal, at);
+			RList *list = ds_refs (ds, at);
 			RListIter *iter;
 			RAnalRef *ref;
 			r_list_foreach (list, iter, ref) {
@@ -766,7 +857,6 @@ static void ds_build_op_str(RDisasmState *ds) {
 					break;
 				}
 			}
-			r_list_free (list);
 		}
 	}
 	char *asm_str = colorize_asm_string (core, ds);
@@ -929,7 +1019,7 @@ static void ds_show_refs(RDisasmState *ds) {
 	if (!ds->show_cmtrefs) {
 		return;
 	}
-	list = r_anal_xrefs_get_from (ds->core->anal, ds->at);
+	list = ds_refs (ds, ds->at);
 	r_list_foreach (list, iter, ref) {
 		cmt = r_meta_get_string (ds->core->anal, R_META_TYPE_COMMENT, ref->addr);
 		flagi = r_flag_get_i (ds->core->flags, ref->addr);
@@ -979,7 +1069,7 @@ static void ds_show_xrefs(RDisasmState *ds) {
 		return;
 	}
 	/* show xrefs */
-	xrefs = r_anal_xref_get (core->anal, ds->at);
+	xrefs = ds_xrefs (ds, ds->at);
 	if (!xrefs) {
 		return;
 	}
@@ -1006,13 +1096,12 @@ static void ds_show_xrefs(RDisasmState *ds) {
 		}
 		ds_print_color_reset (ds);
 		r_cons_newline ();
-		r_list_free (xrefs);
 		return;
 	}
 
 	r_list_foreach (xrefs, iter, refi) {
 		if (refi->at == ds->at) {
-			RAnalFunction *fun = r_anal_get_fcn_in (core->anal, refi->addr, -1);
+			RAnalFunction *fun = ds_fcn_in (ds, refi->addr, -1);
 			if (fun) {
 				name = strdup (fun->name);
 			} else {
@@ -1038,7 +1127,6 @@ static void ds_show_xrefs(RDisasmState *ds) {
 			R_FREE (name);
 		}
 	}
-	r_list_free (xrefs);
 }
 
 static void ds_atabs_option(RDisasmState *ds) {
@@ -1216,7 +1304,7 @@ static void ds_show_functions(RDisasmState *ds) {
 	demangle = r_config_get_i (core->config, "bin.demangle");
 	call = r_config_get_i (core->config, "asm.calls");
 	lang = demangle ? r_config_get (core->config, "bin.lang") : NULL;
-	f = r_anal_get_fcn_in (core->anal, ds->at, R_ANAL_FCN_TYPE_NULL);
+	f = ds_fcn_in (ds, ds->at, R_ANAL_FCN_TYPE_NULL);
 	if (!f || (f->addr != ds->at)) {
 		return;
 	}
@@ -1425,7 +1513,7 @@ static void ds_setup_pre(RDisasmState *ds, bool tail, bool middle) {
 	if (!ds->show_functions) {
 		return;
 	}
-	f = r_anal_get_fcn_in (core->anal, ds->at, R_ANAL_FCN_TYPE_NULL);
+	f = ds_fcn_in (ds, ds->at, R_ANAL_FCN_TYPE_NULL);
 	if (f) {
 		if (f->addr == ds->at) {
 			if (ds->analop.size == r_anal_fcn_size (f) && !middle) {
@@ -1449,13 +1537,12 @@ static void ds_setup_pre(RDisasmState *ds, bool tail, bool middle) {
 }
 
 static void ds_print_pre(RDisasmState *ds) {
-	RCore *core = ds->core;
 	RAnalFunction *f;
 
 	if (!ds->show_functions) {
 		return;
 	}
-	f = r_anal_get_fcn_in (core->anal, ds->at, R_ANAL_FCN_TYPE_NULL);
+	f = ds_fcn_in (ds, ds->at, R_ANAL_FCN_TYPE_NULL);
 	if (f) {
 		r_cons_printf ("%s%s%s", COLOR (ds, color_fline),
 			ds->pre, COLOR_RESET (ds));
@@ -1555,7 +1642,8 @@ static void ds_show_flags(RDisasmState *ds) {
 		return;
 	}
 	RCore *core = ds->core;
-	f = r_anal_get_fcn_in (core->anal, ds->at, R_ANAL_FCN_TYPE_NULL);
+	f = ds_fcn_in (ds, ds->at, R_ANAL_FCN_TYPE_NULL);
+	r_th_rwlock_read_enter (core->flags->lock);
 	flaglist = r_flag_get_list (core->flags, ds->at);
 	r_list_foreach (flaglist, iter, flag) {
 		if (f && f->addr == flag->offset && !strcmp (flag->name, f->name)) {
@@ -1590,6 +1678,7 @@ static void ds_show_flags(RDisasmState *ds) {
 			r_cons_printf ("%s:\n", flag->name);
 		}
 	}
+	r_th_rwlock_read_leave (core->flags->lock);
 }
 
 static void ds_update_ref_lines(RDisasmState *ds) {
@@ -1888,7 +1977,7 @@ static void ds_print_offset(RDisasmState *ds) {
 		if (ds->show_reloff) {
 			RAnalFunction *f = r_anal_get_fcn_at (core->anal, at, R_ANAL_FCN_TYPE_NULL);
 			if (!f) {
-				f = r_anal_get_fcn_in (core->anal, at, R_ANAL_FCN_TYPE_NULL);
+				f = ds_fcn_in (ds, at, R_ANAL_FCN_TYPE_NULL);
 			}
 			if (f) {
 				delta = at - f->addr;
@@ -2053,12 +2142,15 @@ static bool ds_print_data_type(RDisasmState *ds, const ut8 *buf, int ib, int siz
 				}
 			}
 		}
-		const RList *flags = r_flag_get_list (core->flags, n);
+		const RList *flags;
 		RListIter *iter;
 		RFlagItem *fi;
+		r_th_rwlock_read_enter (core->flags->lock);
+		flags = r_flag_get_list (core->flags, n);
 		r_list_foreach (flags, iter, fi) {
 			r_cons_printf (" ; %s", fi->name);
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	}
 	return true;
 }
@@ -2425,7 +2517,7 @@ static bool ds_print_labels(RDisasmState *ds, RAnalFunction *f) {
 	RCore *core = ds->core;
 	const char *label;
 	if (!f) {
-		f = r_anal_get_fcn_in (core->anal, ds->at, 0);
+		f = ds_fcn_in (ds, ds->at, 0);
 	}
 	label = r_anal_fcn_label_at (core->anal, f, ds->at);
 	if (!label) {
@@ -2492,7 +2584,7 @@ static void ds_print_fcn_name(RDisasmState *ds) {
 	case R_ANAL_OP_TYPE_JMP:
 	case R_ANAL_OP_TYPE_CJMP:
 	case R_ANAL_OP_TYPE_CALL:
-		f = r_anal_get_fcn_in (core->anal, ds->analop.jump, R_ANAL_FCN_TYPE_NULL);
+		f = ds_fcn_in (ds, ds->analop.jump, R_ANAL_FCN_TYPE_NULL);
 		if (f && f->name && ds->opstr && !strstr (ds->opstr, f->name)) {
 			//beginline (core, ds, f);
 			// print label
@@ -2502,7 +2594,7 @@ static void ds_print_fcn_name(RDisasmState *ds) {
 				ALIGN;
 				ds_comment (ds, true, "; %s.%s%s", f->name, label, nl);
 			} else {
-				RAnalFunction *f2 = r_anal_get_fcn_in (core->anal, ds->at, 0);
+				RAnalFunction *f2 = ds_fcn_in (ds, ds->at, 0);
 				if (f != f2) {
 					ALIGN;
 					if (delta > 0) {
@@ -2806,7 +2898,7 @@ static void ds_print_ptr(RDisasmState *ds, int len, int idx) {
 	RList *list = NULL;
 	RListIter *iter;
 	RAnalRef *ref;
-	list = r_anal_refs_get (core->anal, ds->at);
+	list = ds_refs (ds, ds->at);
 	r_list_foreach (list, iter, ref) {
 		if (ref->type == R_ANAL_REF_TYPE_STRING || ref->type == R_ANAL_REF_TYPE_DATA) {
 			if ((f = r_flag_get_i (core->flags, ref->addr))) {
@@ -2815,7 +2907,6 @@ static void ds_print_ptr(RDisasmState *ds, int len, int idx) {
 			}
 		}
 	}
-	r_list_free (list);
 	bool flag_printed = false;
 	bool refaddr_printed = false;
 	bool string_printed = false;
@@ -3504,7 +3595,7 @@ static void ds_print_calls_hints(RDisasmState *ds) {
 		return;
 	}
 	RAnal *anal = ds->core->anal;
-	RAnalFunction *fcn = r_anal_get_fcn_in (anal, ds->analop.jump, -1);
+	RAnalFunction *fcn = ds_fcn_in (ds, ds->analop.jump, -1);
 	char *name;
 	if (!fcn) {
 		return;
@@ -3676,6 +3767,7 @@ toro:
 	}
 
 	ds->stackptr = core->anal->stackptr;
+	ds_prefetch_fcns (ds, ds->addr, ds->addr + len);
 	r_cons_break_push (NULL, NULL);
 	r_anal_build_range_on_hints (core->anal);
 	for (i = idx = ret = 0; addrbytes * idx < len && ds->lines < ds->l; idx += inc, i++, ds->index += inc, ds->lines++) {
@@ -3692,7 +3784,7 @@ toro:
 		ds->hint = r_core_hint_begin (core, ds->hint, ds->at);
 		r_asm_set_pc (core->assembler, ds->at);
 		ds_update_ref_lines (ds);
-		f = r_anal_get_fcn_in (core->anal, ds->at, R_ANAL_FCN_TYPE_NULL);
+		f = ds_fcn_in (ds, ds->at, R_ANAL_FCN_TYPE_NULL);
 		ds->fcn = f;
 		if (f && f->folded && r_anal_fcn_is_in_offset (f, ds->at)) {
 			int delta = (ds->at <= f->addr)? (ds->at - f->addr + r_anal_fcn_size (f)): 0;
@@ -3815,7 +3907,7 @@ toro:
 		}
 		ds_setup_print_pre (ds, false, false);
 		ds_print_lines_left (ds);
-		f = r_anal_get_fcn_in (core->anal, ds->addr, 0);
+		f = ds_fcn_in (ds, ds->addr, 0);
 		if (ds_print_labels (ds, f)) {
 			ds_show_functions (ds);
 			ds_show_xrefs (ds);
@@ -4361,9 +4453,11 @@ R_API int r_core_print_disasm_json(RCore *core, ut64 addr, ut8 *buf, int nb_byte
 		}
 		/* add flags */
 		{
-			const RList *flags = r_flag_get_list (core->flags, at);
+			const RList *flags;
 			RFlagItem *flag;
 			RListIter *iter;
+			r_th_rwlock_read_enter (core->flags->lock);
+			flags = r_flag_get_list (core->flags, at);
 			if (flags && !r_list_empty (flags)) {
 				r_cons_printf (",\"flags\":[");
 				r_list_foreach (flags, iter, flag) {
@@ -4371,6 +4465,7 @@ R_API int r_core_print_disasm_json(RCore *core, ut64 addr, ut8 *buf, int nb_byte
 				}
 				r_cons_printf ("]");
 			}
+			r_th_rwlock_read_leave (core->flags->lock);
 		}
 		/* add comments */
 		{
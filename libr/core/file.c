@@ -799,6 +799,7 @@ R_API int r_core_file_close(RCore *r, RCoreFile *fh) {
 	int ret;
 	RIODesc *desc = fh && r ? r_io_desc_get (r->io, fh->fd) : NULL;
 	RCoreFile *prev_cf = r && r->file != fh? r->file: NULL;
+	Sdb *ropidx;
 
 	// TODO: This is not correclty done. because map and iodesc are
 	// still referenced // we need to fully clear all R_IO structs
@@ -813,6 +814,10 @@ R_API int r_core_file_close(RCore *r, RCoreFile *fh) {
 	if (!r || !desc || r_list_empty (r->files)) {
 		return false;
 	}
+	/* the gadget index of /Ri was built from the maps of this file too */
+	if ((ropidx = sdb_ns (r->sdb, "ropidx", false))) {
+		sdb_reset (ropidx);
+	}
 
 	if (fh == r->file) {
 		r->file = NULL;
@@ -33,11 +33,14 @@ R_API int r_core_gdiff(RCore *c, RCore *c2) {
 		return false;
 	for (i = 0; i < 2; i++) {
 		/* remove strings */
+		r_th_rwlock_write_enter (cores[i]->anal->fcns_lock);
 		r_list_foreach_safe (cores[i]->anal->fcns, iter, iter2, fcn) {
 			if (!strncmp (fcn->name, "str.", 4)) {
+				r_anal_fcn_tree_delete (cores[i]->anal, fcn);
 				r_list_delete (cores[i]->anal->fcns, iter);
 			}
 		}
+		r_th_rwlock_write_leave (cores[i]->anal->fcns_lock);
 		/* Fingerprint fcn bbs (functions basic-blocks) */
 		r_list_foreach (cores[i]->anal->fcns, iter, fcn) {
 			r_list_foreach (fcn->bbs, iter2, bb) {
@@ -929,6 +929,7 @@ static int r_cmd_java_handle_find_cp_const (RCore *core, const char *cmd) {
 	find_list = r_list_new ();
 	find_list->free = free;
 	// XXX - this will break once RAnal moves to sdb
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, fn_iter, fcn) {
 		r_list_foreach (fcn->bbs, bb_iter, bb) {
 			char op = bb->op_bytes[0];
@@ -954,6 +955,7 @@ static int r_cmd_java_handle_find_cp_const (RCore *core, const char *cmd) {
 			}
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	if (idx == (ut16) -1) {
 		r_list_foreach (find_list, iter, cp_res) {
 			const char *t = ((RBinJavaCPTypeMetas *) cp_res->obj->metas->type_info)->name;
@@ -1788,6 +1790,7 @@ static int r_cmd_java_handle_list_code_references (RCore *core, const char *inpu
 
 	fmt = "addr:0x%"PFMT64x" method_name:\"%s\", op:\"%s\" type:\"%s\" info:\"%s\"\n";
 
+	r_th_rwlock_read_enter (anal->fcns_lock);
 	r_list_foreach (anal->fcns, fcn_iter, fcn) {
 		ut8 do_this_one = func_addr == -1 || r_anal_fcn_is_in_offset (fcn, func_addr);
 		if (!do_this_one) continue;
@@ -1875,6 +1878,7 @@ static int r_cmd_java_handle_list_code_references (RCore *core, const char *inpu
 			free (operation);
 		}
 	}
+	r_th_rwlock_read_leave (anal->fcns_lock);
 	return true;
 }
 
@@ -811,6 +811,8 @@ static bool projectLoadXrefs(RCore *core, const char *prjName) {
 		free (path);
 		return false;
 	}
+	/* replay the changes saved after the file was written */
+	sdb_config (DB, DB->options | SDB_OPTION_JOURNAL);
 	sdb_ns_set (core->anal->sdb, "xrefs", DB);
 	free (path);
 
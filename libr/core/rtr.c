@@ -388,6 +388,7 @@ static void activateDieTime (RCore *core) {
 static int r_core_rtr_http_run(RCore *core, int launch, const char *path) {
 	RConfig *newcfg = NULL, *origcfg = NULL;
 	char headers[128] = R_EMPTY;
+	RSocketHTTPServer *hs;
 	RSocketHTTPRequest *rs;
 	char buf[32];
 	int ret = 0;
@@ -458,6 +459,11 @@ static int r_core_rtr_http_run(RCore *core, int launch, const char *path) {
 		eprintf ("Cannot listen on http.port\n");
 		return 1;
 	}
+	hs = r_socket_http_server_new (s, timeout);
+	if (!hs) {
+		r_socket_free (s);
+		return 1;
+	}
 	if (launch=='H') {
 		const char *browser = r_config_get (core->config, "http.browser");
 		r_sys_cmdf ("%s http://%s:%d/%s &",
@@ -517,7 +523,7 @@ static int r_core_rtr_http_run(RCore *core, int launch, const char *path) {
 
 		/* this is blocking */
 		activateDieTime (core);
-		rs = r_socket_http_accept (s, timeout);
+		rs = r_socket_http_server_accept (hs);
 
 		origoff = core->offset;
 		origblk = core->block;
@@ -721,7 +727,7 @@ static int r_core_rtr_http_run(RCore *core, int launch, const char *path) {
 					if (r_file_is_directory (path)) {
 						char *res = r_str_newf ("Location: %s/\n%s", rs->path, headers);
 						r_socket_http_response (rs, 302, NULL, 0, res);
-						r_socket_http_close (rs);
+						r_socket_http_server_close (hs, rs);
 						free (path);
 						free (res);
 						R_FREE (dir);
@@ -792,7 +798,7 @@ static int r_core_rtr_http_run(RCore *core, int launch, const char *path) {
 		} else {
 			r_socket_http_response (rs, 404, "Invalid protocol", 0, headers);
 		}
-		r_socket_http_close (rs);
+		r_socket_http_server_close (hs, rs);
 		free (dir);
 	}
 the_end:
@@ -813,6 +819,7 @@ the_end:
 	}
 	r_cons_break_pop ();
 	core->http_up = false;
+	r_socket_http_server_free (hs);
 	r_socket_free (s);
 	r_config_free (newcfg);
 	if (restoreSandbox) {
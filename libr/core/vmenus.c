@@ -849,10 +849,12 @@ R_API bool r_core_visual_hudstuff(RCore *core) {
 		return false;
 	}
 	list->free = free;
+	r_th_rwlock_read_enter (core->flags->lock);
 	r_list_foreach (core->flags->flags, iter, flag) {
 		r_list_append (list, r_str_newf ("0x%08"PFMT64x"  %s",
 			flag->offset, flag->name));
 	}
+	r_th_rwlock_read_leave (core->flags->lock);
 	sdb_foreach (core->anal->sdb_meta, cmtcb, list);
 	res = r_cons_hud (list, NULL);
 	if (res) {
@@ -1194,6 +1196,7 @@ R_API int r_core_visual_trackflags(RCore *core) {
 			(core->flags->space_idx==-1)?"*":core->flags->spaces[core->flags->space_idx]);
 			hit = 0;
 			i = j = 0;
+			r_th_rwlock_read_enter (core->flags->lock);
 			r_list_foreach (core->flags->flags, iter, flag) {
 				/* filter per flag spaces */
 				if ((core->flags->space_idx != -1) &&
@@ -1212,6 +1215,7 @@ R_API int r_core_visual_trackflags(RCore *core) {
 				}
 				i++;
 			}
+			r_th_rwlock_read_leave (core->flags->lock);
 			if (!hit && i > 0) {
 				option = i - 1;
 				continue;
@@ -2145,6 +2149,7 @@ static void function_rename(RCore *core, ut64 addr, const char *name) {
 	RListIter *iter;
 	RAnalFunction *fcn;
 
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		if (fcn->addr == addr) {
 			r_flag_unset_name (core->flags, fcn->name);
@@ -2154,6 +2159,7 @@ static void function_rename(RCore *core, ut64 addr, const char *name) {
 			break;
 		}
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 }
 
 static void variable_rename (RCore *core, ut64 addr, int vindex, const char *name) {
@@ -2194,6 +2200,7 @@ static ut64 var_functions_show(RCore *core, int idx, int show) {
 	(void)r_cons_get_size (&window);
 	window -= 8; // Size of printed things
 
+	r_th_rwlock_read_enter (core->anal->fcns_lock);
 	r_list_foreach (core->anal->fcns, iter, fcn) {
 		if (i >= wdelta) {
 			if (i> window+wdelta) {
@@ -2211,6 +2218,7 @@ static ut64 var_functions_show(RCore *core, int idx, int show) {
 		}
 		i++;
 	}
+	r_th_rwlock_read_leave (core->anal->fcns_lock);
 	return addr;
 }
 
@@ -2571,26 +2579,32 @@ R_API void r_core_seek_next(RCore *core, const char *type) {
 	} else
 	if (strstr (type, "fun")) {
 		RAnalFunction *fcni;
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcni) {
 			if (fcni->addr < next && fcni->addr > core->offset) {
 				next = fcni->addr;
 			}
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 	} else
 	if (strstr (type, "hit")) {
 		const char *pfx = r_config_get (core->config, "search.prefix");
 		RFlagItem *flag;
+		r_th_rwlock_read_enter (core->flags->lock);
 		r_list_foreach (core->flags->flags, iter, flag) {
 			if (!strncmp (flag->name, pfx, strlen (pfx)))
 				if (flag->offset < next && flag->offset > core->offset)
 					next = flag->offset;
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	} else { // flags
 		RFlagItem *flag;
+		r_th_rwlock_read_enter (core->flags->lock);
 		r_list_foreach (core->flags->flags, iter, flag) {
 			if (flag->offset < next && flag->offset > core->offset)
 				next = flag->offset;
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	}
 	if (next != UT64_MAX)
 		r_core_seek (core, next, 1);
@@ -2604,25 +2618,31 @@ R_API void r_core_seek_previous (RCore *core, const char *type) {
 	} else
 	if (strstr (type, "fun")) {
 		RAnalFunction *fcni;
+		r_th_rwlock_read_enter (core->anal->fcns_lock);
 		r_list_foreach (core->anal->fcns, iter, fcni) {
 			if (fcni->addr > next && fcni->addr < core->offset)
 				next = fcni->addr;
 		}
+		r_th_rwlock_read_leave (core->anal->fcns_lock);
 	} else
 	if (strstr (type, "hit")) {
 		RFlagItem *flag;
 		const char *pfx = r_config_get (core->config, "search.prefix");
+		r_th_rwlock_read_enter (core->flags->lock);
 		r_list_foreach (core->flags->flags, iter, flag) {
 			if (!strncmp (flag->name, pfx, strlen (pfx)))
 				if (flag->offset > next && flag->offset< core->offset)
 					next = flag->offset;
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	} else { // flags
 		RFlagItem *flag;
+		r_th_rwlock_read_enter (core->flags->lock);
 		r_list_foreach (core->flags->flags, iter, flag) {
 			if (flag->offset > next && flag->offset < core->offset)
 				next = flag->offset;
 		}
+		r_th_rwlock_read_leave (core->flags->lock);
 	}
 	if (next!=0)
 		r_core_seek (core, next, 1);
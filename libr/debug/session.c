@@ -142,6 +142,7 @@ static void r_debug_session_set_registers(RDebug *dbg, RDebugSession *session) {
 		arena = iterr->data;
 		if (dbg->reg->regset[i].arena->bytes) {
 			memcpy (dbg->reg->regset[i].arena->bytes, arena->bytes, arena->size);
+			r_reg_arena_dirty (dbg->reg->regset[i].arena, 0, arena->size);
 		}
 	}
 	r_debug_reg_sync (dbg, R_REG_TYPE_ALL, 1);
@@ -18,24 +18,44 @@ static const char *str_callback(RNum *user, ut64 off, int *ok) {
 		*ok = 0;
 	}
 	if (f) {
+		const char *name = NULL;
+		r_th_rwlock_read_enter (f->lock);
 		list = r_flag_get_list (f, off);
 		item = r_list_get_top (list);
 		if (item) {
 			if (ok) {
 				*ok = true;
 			}
-			return item->name;
+			name = item->name;
 		}
+		r_th_rwlock_read_leave (f->lock);
+		return name;
 	}
 	return NULL;
 }
 
 static void flag_free_kv(HtKv *kv) {
-	free (kv->key);
-	//we do not free kv->value since there is a reference in other list
+	//the key is the interned item name and kv->value is referenced
+	//in other list, so none of them is freed here
 	free (kv);
 }
 
+/* insert the item by its name, without copying it */
+static bool ht_name_insert(RFlag *f, RFlagItem *item) {
+	HtKv *kv = R_NEW0 (HtKv);
+	if (!kv) {
+		return false;
+	}
+	kv->key = item->name;
+	kv->key_len = strlen (item->name);
+	kv->value = item;
+	if (!ht_insert_kv (f->ht_name, kv, false)) {
+		free (kv);
+		return false;
+	}
+	return true;
+}
+
 static void flag_skiplist_free(void *data) {
 	RFlagsAtOffset *item = (RFlagsAtOffset *)data;
 	r_list_free (item->flags);
@@ -99,18 +119,22 @@ static void remove_offsetmap(RFlag *f, RFlagItem *item) {
 	}
 }
 
-static int set_name(RFlagItem *item, const char *name) {
-	if (item->name != item->realname) {
-		free (item->name);
+static int set_name(RFlag *f, RFlagItem *item, const char *name) {
+	char *s = strdup (name);
+	if (!s) {
+		return false;
 	}
-	item->name = strdup (name);
-	if (!item->name) {
+	r_str_chop (s);
+	r_name_filter (s, 0); // TODO: name_filter should be chopping already
+	name = r_str_intern_get (f->names, s);
+	free (s);
+	if (!name) {
 		return false;
 	}
-	r_str_chop (item->name);
-	r_name_filter (item->name, 0); // TODO: name_filter should be chopping already
-	free (item->realname);
-	item->realname = item->name;
+	r_str_intern_put (item->name);
+	r_str_intern_put (item->realname);
+	item->name = (char *)name;
+	item->realname = r_str_intern_dup (name);
 	return true;
 }
 
@@ -143,7 +167,9 @@ R_API RFlag * r_flag_new() {
 		return NULL;
 	}
 	f->ht_name = ht_new (NULL, flag_free_kv, NULL);
+	f->names = r_str_intern_new ();
 	f->by_off = r_skiplist_new (flag_skiplist_free, flag_skiplist_cmp);
+	f->lock = r_th_rwlock_new ();
 #if R_FLAG_ZONE_USE_SDB
 	sdb_free (f->zones);
 #else
@@ -160,11 +186,8 @@ R_API void r_flag_item_free(RFlagItem *item) {
 		free (item->color);
 		free (item->comment);
 		free (item->alias);
-		/* release only one of the two pointers if they are the same */
-		if (item->name != item->realname) {
-			free (item->name);
-		}
-		free (item->realname);
+		r_str_intern_put (item->name);
+		r_str_intern_put (item->realname);
 		free (item);
 	}
 }
@@ -180,6 +203,8 @@ R_API RFlag *r_flag_free(RFlag *f) {
 	r_list_free (f->flags);
 	r_list_free (f->spacestack);
 	r_num_free (f->num);
+	r_str_intern_free (f->names);
+	r_th_rwlock_free (f->lock);
 	free (f);
 	return NULL;
 }
@@ -214,6 +239,7 @@ R_API void r_flag_list(RFlag *f, int rad, const char *pfx) {
 		pfx = NULL;
 	}
 
+	r_th_rwlock_read_enter (f->lock);
 	switch (rad) {
 	case 'j': {
 		int first = 1;
@@ -305,6 +331,7 @@ R_API void r_flag_list(RFlag *f, int rad, const char *pfx) {
 		}
 		break;
 	}
+	r_th_rwlock_read_leave (f->lock);
 }
 
 static RFlagItem *evalFlag(RFlag *f, RFlagItem *item) {
@@ -319,19 +346,21 @@ static RFlagItem *evalFlag(RFlag *f, RFlagItem *item) {
 R_API bool r_flag_exist_at(RFlag *f, const char *flag_prefix, ut16 fp_size, ut64 off) {
 	RListIter *iter = NULL;
 	RFlagItem *item = NULL;
+	const RList *list;
+	bool ret = false;
 	if (!f) {
 		return false;
 	}
-	const RList *list = r_flag_get_list (f, off);
-	if (!list) {
-		return false;
-	}
+	r_th_rwlock_read_enter (f->lock);
+	list = r_flag_get_list (f, off);
 	r_list_foreach (list, iter, item) {
 		if (item->name && !strncmp (item->name, flag_prefix, fp_size)) {
-			return true;
+			ret = true;
+			break;
 		}
 	}
-	return false;
+	r_th_rwlock_read_leave (f->lock);
+	return ret;
 }
 
 /* return the flag item with name "name" in the RFlag "f", if it exists.
@@ -341,18 +370,24 @@ R_API RFlagItem *r_flag_get(RFlag *f, const char *name) {
 	if (!f) {
 		return NULL;
 	}
-	r = ht_find (f->ht_name, name, NULL);
-	return evalFlag (f, r);
+	r_th_rwlock_read_enter (f->lock);
+	r = evalFlag (f, ht_find (f->ht_name, name, NULL));
+	r_th_rwlock_read_leave (f->lock);
+	return r;
 }
 
 /* return the first flag item that can be found at offset "off", or NULL otherwise */
 R_API RFlagItem *r_flag_get_i(RFlag *f, ut64 off) {
 	const RList *list;
+	RFlagItem *item;
 	if (!f) {
 		return NULL;
 	}
+	r_th_rwlock_read_enter (f->lock);
 	list = r_flag_get_list (f, off);
-	return list ? evalFlag (f, r_list_get_top (list)) : NULL;
+	item = evalFlag (f, list? r_list_get_top (list): NULL);
+	r_th_rwlock_read_leave (f->lock);
+	return item;
 }
 
 /* return the first flag item at offset "off" that doesn't start with "loc.",
@@ -362,10 +397,9 @@ R_API RFlagItem *r_flag_get_i(RFlag *f, ut64 off) {
 R_API RFlagItem *r_flag_get_i2(RFlag *f, ut64 off) {
 	RFlagItem *oitem = NULL, *item = NULL;
 	RListIter *iter;
-	const RList *list = r_flag_get_list (f, off);
-	if (!list) {
-		return NULL;
-	}
+	const RList *list;
+	r_th_rwlock_read_enter (f->lock);
+	list = r_flag_get_list (f, off);
 	r_list_foreach (list, iter, item) {
 		if (!item->name) {
 			continue;
@@ -392,7 +426,9 @@ R_API RFlagItem *r_flag_get_i2(RFlag *f, ut64 off) {
 		if (strlen (item->name) < 5 || item->name[3]!='.') continue;
 		oitem = item;
 	}
-	return evalFlag (f, oitem);
+	oitem = evalFlag (f, oitem);
+	r_th_rwlock_read_leave (f->lock);
+	return oitem;
 }
 
 static bool isFunctionFlag(const char *n) {
@@ -403,9 +439,7 @@ static bool isFunctionFlag(const char *n) {
 	|| !strncmp (n, "fcn.0", 5));
 }
 
-/* returns the last flag item defined before or at the given offset.
- * NULL is returned if such a item is not found. */
-R_API RFlagItem *r_flag_get_at(RFlag *f, ut64 off, bool closest) {
+static RFlagItem *flag_get_at(RFlag *f, ut64 off, bool closest) {
 	RFlagItem *item, *nice = NULL;
 	RListIter *iter;
 	const RFlagsAtOffset *flags_at = r_flag_get_nearest_list (f, off, -1);
@@ -452,7 +486,18 @@ R_API RFlagItem *r_flag_get_at(RFlag *f, ut64 off, bool closest) {
 	return evalFlag (f, nice);
 }
 
-/* return the list of flag items that are associated with a given offset */
+/* returns the last flag item defined before or at the given offset.
+ * NULL is returned if such a item is not found. */
+R_API RFlagItem *r_flag_get_at(RFlag *f, ut64 off, bool closest) {
+	RFlagItem *item;
+	r_th_rwlock_read_enter (f->lock);
+	item = flag_get_at (f, off, closest);
+	r_th_rwlock_read_leave (f->lock);
+	return item;
+}
+
+/* return the list of flag items that are associated with a given offset.
+ * The list belongs to the flags: the caller holds f->lock while using it */
 R_API const RList* /*<RFlagItem*>*/ r_flag_get_list(RFlag *f, ut64 off) {
 	const RFlagsAtOffset *item = r_flag_get_nearest_list (f, off, 0);
 	return item ? item->flags : NULL;
@@ -461,37 +506,47 @@ R_API const RList* /*<RFlagItem*>*/ r_flag_get_list(RFlag *f, ut64 off) {
 R_API char *r_flag_get_liststr(RFlag *f, ut64 off) {
 	RFlagItem *fi;
 	RListIter *iter;
-	const RList *list = r_flag_get_list (f, off);
+	const RList *list;
 	char *p = NULL;
+	r_th_rwlock_read_enter (f->lock);
+	list = r_flag_get_list (f, off);
 	r_list_foreach (list, iter, fi) {
 		p = r_str_appendf (p, "%s%s",
 			fi->realname, iter->n ? "," : ":");
 	}
+	r_th_rwlock_read_leave (f->lock);
 	return p;
 }
 
 R_API RFlagItem *r_flag_set_next(RFlag *f, const char *name, ut64 off, ut32 size) {
+	RFlagItem *fi = NULL;
+	char *newName;
+	int i, newNameSize;
+	/* nobody takes the name between the lookup and the set */
+	r_th_rwlock_write_enter (f->lock);
 	if (!r_flag_get (f, name)) {
-		return r_flag_set (f, name, off, size);
-	}
-	int i, newNameSize = strlen (name);
-	char *newName = malloc (newNameSize + 16);
-	strcpy (newName, name);
-	for (i = 0; ; i++) {
-		snprintf (newName + newNameSize, 15, ".%d", i);
-		if (!r_flag_get (f, newName)) {
-			RFlagItem *fi = r_flag_set (f, newName, off, size);
-			free (newName);
-			return fi;
+		fi = r_flag_set (f, name, off, size);
+		r_th_rwlock_write_leave (f->lock);
+		return fi;
+	}
+	newNameSize = strlen (name);
+	newName = malloc (newNameSize + 16);
+	if (newName) {
+		strcpy (newName, name);
+		for (i = 0; ; i++) {
+			snprintf (newName + newNameSize, 15, ".%d", i);
+			if (!r_flag_get (f, newName)) {
+				fi = r_flag_set (f, newName, off, size);
+				break;
+			}
 		}
+		free (newName);
 	}
-	return NULL;
+	r_th_rwlock_write_leave (f->lock);
+	return fi;
 }
 
-/* create or modify an existing flag item with the given name and parameters.
- * The realname of the item will be the same as the name.
- * NULL is returned in case of any errors during the process. */
-R_API RFlagItem *r_flag_set(RFlag *f, const char *name, ut64 off, ut32 size) {
+static RFlagItem *flag_set(RFlag *f, const char *name, ut64 off, ut32 size) {
 	RFlagItem *item = NULL;
 	RList *list;
 
@@ -512,14 +567,14 @@ R_API RFlagItem *r_flag_set(RFlag *f, const char *name, ut64 off, ut32 size) {
 		if (!item) {
 			return NULL;
 		}
-		if (!set_name (item, name)) {
+		if (!set_name (f, item, name)) {
 			eprintf ("Invalid flag name '%s'.\n", name);
 			r_flag_item_free (item);
 			return NULL;
 		}
 		//item share ownership prone to uaf, that is why only
 		//f->flags has set up free pointer
-		ht_insert (f->ht_name, item->name, item);
+		ht_name_insert (f, item);
 		r_list_append (f->flags, item);
 	}
 
@@ -541,6 +596,17 @@ R_API RFlagItem *r_flag_set(RFlag *f, const char *name, ut64 off, ut32 size) {
 	return item;
 }
 
+/* create or modify an existing flag item with the given name and parameters.
+ * The realname of the item will be the same as the name.
+ * NULL is returned in case of any errors during the process. */
+R_API RFlagItem *r_flag_set(RFlag *f, const char *name, ut64 off, ut32 size) {
+	RFlagItem *item;
+	r_th_rwlock_write_enter (f->lock);
+	item = flag_set (f, name, off, size);
+	r_th_rwlock_write_leave (f->lock);
+	return item;
+}
+
 /* add/replace/remove the alias of a flag item */
 R_API void r_flag_item_set_alias(RFlagItem *item, const char *alias) {
 	if (item) {
@@ -560,10 +626,11 @@ R_API void r_flag_item_set_comment(RFlagItem *item, const char *comment) {
 /* add/replace/remove the realname of a flag item */
 R_API void r_flag_item_set_realname(RFlagItem *item, const char *realname) {
 	if (item) {
-		if (item->name != item->realname) {
-			free (item->realname);
-		}
-		item->realname = ISNULLSTR (realname) ? NULL : strdup (realname);
+		/* interned in the pool of the name */
+		char *s = ISNULLSTR (realname)? NULL
+			: r_str_intern_get (r_str_intern_pool (item->name), realname);
+		r_str_intern_put (item->realname);
+		item->realname = s;
 	}
 }
 
@@ -580,13 +647,16 @@ R_API int r_flag_rename(RFlag *f, RFlagItem *item, const char *name) {
 	r_flag_set (f, name, off, size);
 	return true;
 #else
+	bool ret = true;
+	r_th_rwlock_write_enter (f->lock);
 	ht_delete (f->ht_name, item->name);
-	if (!set_name (item, name)) {
-		return false;
+	if (!set_name (f, item, name)) {
+		ret = false;
 	}
-	ht_insert (f->ht_name, item->name, item);
+	ht_name_insert (f, item);
+	r_th_rwlock_write_leave (f->lock);
+	return ret;
 #endif
-	return true;
 }
 
 /* unset the given flag item.
@@ -594,20 +664,26 @@ R_API int r_flag_rename(RFlag *f, RFlagItem *item, const char *name) {
  *
  * NOTE: the item is freed. */
 R_API int r_flag_unset(RFlag *f, RFlagItem *item) {
+	r_th_rwlock_write_enter (f->lock);
 	remove_offsetmap (f, item);
 	ht_delete (f->ht_name, item->name);
 	r_list_delete_data (f->flags, item);
+	r_th_rwlock_write_leave (f->lock);
 	return true;
 }
 
 /* unset the first flag item found at offset off.
  * return true if such a flag is found and unset, false otherwise. */
 R_API int r_flag_unset_off(RFlag *f, ut64 off) {
-	RFlagItem *item = r_flag_get_i (f, off);
+	RFlagItem *item;
+	bool ret = false;
+	r_th_rwlock_write_enter (f->lock);
+	item = r_flag_get_i (f, off);
 	if (item && r_flag_unset (f, item)) {
-		return true;
+		ret = true;
 	}
-	return false;
+	r_th_rwlock_write_leave (f->lock);
+	return ret;
 }
 
 /* unset all the flag items that satisfy the given glob.
@@ -617,6 +693,7 @@ R_API int r_flag_unset_glob(RFlag *f, const char *glob) {
 	RFlagItem *flag;
 	int n = 0;
 
+	r_th_rwlock_write_enter (f->lock);
 	r_list_foreach (f->flags, iter, flag) {
 		if (IS_IN_SPACE (f, flag)) continue;
 		if (!glob || r_str_glob (flag->name, glob)) {
@@ -626,22 +703,30 @@ R_API int r_flag_unset_glob(RFlag *f, const char *glob) {
 			n++;
 		}
 	}
+	r_th_rwlock_write_leave (f->lock);
 	return n;
 }
 
 /* unset the flag item with the given name.
  * returns true if the item is found and unset, false otherwise. */
 R_API int r_flag_unset_name(RFlag *f, const char *name) {
-	RFlagItem *item = ht_find (f->ht_name, name, NULL);
-	return item && r_flag_unset (f, item);
+	RFlagItem *item;
+	bool ret;
+	r_th_rwlock_write_enter (f->lock);
+	item = ht_find (f->ht_name, name, NULL);
+	ret = item && r_flag_unset (f, item);
+	r_th_rwlock_write_leave (f->lock);
+	return ret;
 }
 
 /* unset all flag items in the RFlag f */
 R_API void r_flag_unset_all(RFlag *f) {
+	r_th_rwlock_write_enter (f->lock);
 	f->space_idx = -1;
 	r_list_free (f->flags);
 	f->flags = r_list_newf ((RListFree)r_flag_item_free);
 	if (!f->flags) {
+		r_th_rwlock_write_leave (f->lock);
 		return;
 	}
 	ht_free (f->ht_name);
@@ -649,6 +734,7 @@ R_API void r_flag_unset_all(RFlag *f) {
 	f->ht_name = ht_new (NULL, flag_free_kv, NULL);
 	r_skiplist_purge (f->by_off);
 	r_flag_space_unset (f, NULL);
+	r_th_rwlock_write_leave (f->lock);
 }
 
 R_API int r_flag_relocate(RFlag *f, ut64 off, ut64 off_mask, ut64 to) {
@@ -657,6 +743,7 @@ R_API int r_flag_relocate(RFlag *f, ut64 off, ut64 off_mask, ut64 to) {
 	RListIter *iter;
 	int n = 0;
 
+	r_th_rwlock_write_enter (f->lock);
 	r_list_foreach (f->flags, iter, item) {
 		ut64 fn = item->offset & neg_mask;
 		ut64 on = off & neg_mask;
@@ -667,16 +754,21 @@ R_API int r_flag_relocate(RFlag *f, ut64 off, ut64 off_mask, ut64 to) {
 			n++;
 		}
 	}
+	r_th_rwlock_write_leave (f->lock);
 	return n;
 }
 
 R_API int r_flag_move(RFlag *f, ut64 at, ut64 to) {
-	RFlagItem *item = r_flag_get_i (f, at);
+	RFlagItem *item;
+	bool ret = false;
+	r_th_rwlock_write_enter (f->lock);
+	item = r_flag_get_i (f, at);
 	if (item) {
 		r_flag_set (f, item->name, to, item->size);
-		return true;
+		ret = true;
 	}
-	return false;
+	r_th_rwlock_write_leave (f->lock);
+	return ret;
 }
 
 #ifdef MYTEST
@@ -726,9 +818,11 @@ R_API int r_flag_count(RFlag *f, const char *glob) {
 	int count = 0;
 	RFlagItem *flag;
 	RListIter *iter;
+	r_th_rwlock_read_enter (f->lock);
 	r_list_foreach (f->flags, iter, flag) {
 		if (r_str_glob (flag->name, glob))
 			count ++;
 	}
+	r_th_rwlock_read_leave (f->lock);
 	return count;
 }
@@ -33,9 +33,6 @@ R_LIB_VERSION_HEADER(r_anal);
    bb_has_ops=1 -> 600M
    bb_has_ops=0 -> 350MB
  */
-/* TODO: work in progress */
-#define USE_NEW_FCN_STORE 0
-
 // TODO: Remove this define? /cc @nibble_ds
 #define VERBOSE_ANAL if(0)
 
@@ -285,6 +282,7 @@ typedef struct r_anal_type_function_t {
 	int nargs; // Function arguments counter
 	int depth;
 	bool folded;
+	int dirty; // basic blocks patched since they were analyzed
 	RAnalType *args; // list of arguments
 	ut8 *fingerprint; // TODO: make is fuzzy and smarter
 	RAnalDiff *diff;
@@ -298,6 +296,10 @@ typedef struct r_anal_type_function_t {
 #endif
 	RAnalFcnMeta meta;
 	RRangeTiny bbr;
+	RBNode rb; // node in anal->fcn_tree
+	ut64 rb_from, rb_to; // indexed bounds
+	ut64 rb_max_addr; // max rb_to in the subtree
+	struct r_anal_t *anal; // owner of the index this function is in
 } RAnalFunction;
 
 struct r_anal_type_t {
@@ -598,7 +600,8 @@ typedef struct r_anal_t {
 	void *user;
 	ut64 gp; // global pointer. used for mips. but can be used by other arches too in the future
 	RList *fcns;
-	RListRange *fcnstore;
+	RBNode *fcn_tree; // interval tree of the functions, see fcnstore.c
+	int fcn_tree_count;
 	RList *refs;
 	RList *vartypes;
 	RReg *reg;
@@ -657,6 +660,9 @@ typedef struct r_anal_t {
 	int stackptr;
 	bool (*log)(struct r_anal_t *anal, const char *msg);
 	char *cmdtail;
+	RMemoryPool *bb_pool; // basic blocks of the functions
+	RMemoryPool *iter_pool; // nodes of the function bb and ref lists
+	RThreadRWLock *fcns_lock; // guards fcns and fcn_tree, see fcn.c
 } RAnal;
 
 typedef RAnalFunction *(* RAnalGetFcnIn)(RAnal *anal, ut64 addr, int type);
@@ -778,6 +784,7 @@ typedef struct r_anal_bb_t {
 	int returnbb;
 	int conditional;
 	int traced;
+	bool dirty; // bytes written over it since it was analyzed
 	char *label;
 	ut8 *fingerprint;
 	RAnalDiff *diff;
@@ -802,6 +809,7 @@ typedef struct r_anal_bb_t {
 	ut8 *parent_reg_arena;
 	int stackptr;
 	int parent_stackptr;
+	RMemoryPool *pool; // slab it was taken from, if any
 #undef RAnalBlock
 } RAnalBlock;
 
@@ -1061,6 +1069,7 @@ typedef int (*RAnalRegProfCallback)(RAnal *a);
 typedef char*(*RAnalRegProfGetCallback)(RAnal *a);
 typedef int (*RAnalFPBBCallback)(RAnal *a, RAnalBlock *bb);
 typedef int (*RAnalFPFcnCallback)(RAnal *a, RAnalFunction *fcn);
+typedef bool (*RAnalFcnTreeCb)(RAnalFunction *fcn, void *user);
 typedef int (*RAnalDiffBBCallback)(RAnal *anal, RAnalFunction *fcn, RAnalFunction *fcn2);
 typedef int (*RAnalDiffFcnCallback)(RAnal *anal, RList *fcns, RList *fcns2);
 typedef int (*RAnalDiffEvalCallback)(RAnal *anal);
@@ -1162,15 +1171,16 @@ int * (r_anal_compare) (RAnalFunction , RAnalFunction );
 /*----------------------------------------------------------------------------------------------*/
 
 #ifdef R_API
-/* --------- */ /* REFACTOR */ /* ---------- */
-R_API RListRange* r_listrange_new (void);
-R_API void r_listrange_free(RListRange *s);
-R_API void r_listrange_add(RListRange *s, RAnalFunction *f);
-R_API void r_listrange_del(RListRange *s, RAnalFunction *f);
-R_API void r_listrange_resize(RListRange *s, RAnalFunction *f, int newsize);
-R_API RAnalFunction *r_listrange_find_in_range(RListRange* s, ut64 addr);
-R_API RAnalFunction *r_listrange_find_root(RListRange* s, ut64 addr);
-/* --------- */ /* REFACTOR */ /* ---------- */
+/* fcnstore.c */
+R_API void r_anal_fcn_tree_insert(RAnal *anal, RAnalFunction *fcn);
+R_API bool r_anal_fcn_tree_delete(RAnal *anal, RAnalFunction *fcn);
+R_API void r_anal_fcn_tree_update(RAnalFunction *fcn);
+R_API void r_anal_fcn_tree_reset(RAnal *anal);
+R_API bool r_anal_fcn_tree_sync(RAnal *anal);
+R_API RAnalFunction *r_anal_fcn_tree_find_at(RAnal *anal, ut64 addr, int type);
+R_API RAnalFunction *r_anal_fcn_tree_find_in(RAnal *anal, ut64 addr, int type);
+R_API RAnalFunction *r_anal_fcn_tree_find_in_bounds(RAnal *anal, ut64 addr, int type);
+R_API void r_anal_fcn_tree_foreach_in(RAnal *anal, ut64 from, ut64 to, RAnalFcnTreeCb cb, void *user);
 /* type.c */
 R_API int r_anal_type_get_size (RAnal *anal, const char *type);
 R_API RAnalType *r_anal_type_new(void);
@@ -1229,6 +1239,7 @@ R_API const char *r_anal_get_fcnsign(RAnal *anal, const char *sym);
 
 /* bb.c */
 R_API RAnalBlock *r_anal_bb_new(void);
+R_API RAnalBlock *r_anal_bb_new_pool(RMemoryPool *pool);
 R_API RList *r_anal_bb_list_new(void);
 R_API void r_anal_bb_free(RAnalBlock *bb);
 R_API int r_anal_bb(RAnal *anal, RAnalBlock *bb, ut64 addr, ut8 *buf, ut64 len, int head);
@@ -1352,6 +1363,9 @@ R_API ut32 r_anal_fcn_realsize(const RAnalFunction *fcn);
 R_API int r_anal_fcn_cc(RAnalFunction *fcn);
 R_API int r_anal_fcn_split_bb(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb, ut64 addr);
 R_API int r_anal_fcn_bb_overlaps(RAnalFunction *fcn, RAnalBlock *bb);
+R_API int r_anal_fcn_invalidate(RAnal *anal, ut64 addr, int len);
+R_API int r_anal_fcn_refresh(RAnal *anal, ut64 addr, int len);
+R_API int r_anal_fcn_reanal_dirty(RAnal *anal, RAnalFunction *fcn);
 R_API RAnalVar *r_anal_fcn_get_var(RAnalFunction *fs, int num, int dir);
 R_API void r_anal_fcn_fit_overlaps (RAnal *anal, RAnalFunction *fcn);
 R_API void r_anal_trim_jmprefs(RAnalFunction *fcn);
@@ -273,6 +273,7 @@ typedef struct r_bin_t {
 	int strpurge; // purge false positive strings
 	char *srcdir; // dir.source
 	char *prefix; // bin.prefix
+	char *cache_dir; // bin.cache
 	ut64 filter_rules;
 	bool demanglercmd;
 	bool verbose;
@@ -670,6 +671,10 @@ R_API void r_bin_filter_symbols (RList *list);
 R_API void r_bin_filter_sections (RList *list);
 R_API void r_bin_filter_classes (RList *list);
 
+/* cache */
+R_API bool r_bin_cache_load(RBinFile *bf, RBinObject *o);
+R_API bool r_bin_cache_save(RBinFile *bf, RBinObject *o);
+
 /* plugin pointers */
 extern RBinPlugin r_bin_plugin_any;
 extern RBinPlugin r_bin_plugin_fs;
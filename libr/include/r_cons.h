@@ -74,6 +74,7 @@ typedef struct r_cons_grep_t {
 	int begin;
 	int end;
 	int icase;
+	int stream_pos; // buffer offset of the first line not yet filtered
 } RConsGrep;
 
 #if ENUM_FOR_PAL
@@ -625,6 +626,8 @@ R_API void r_cons_grep_help(void);
 R_API void r_cons_grep_parsecmd(char *cmd, const char *quotestr);
 R_API int r_cons_grep_line(char *buf, int len); // must be static
 R_API int r_cons_grepbuf(char *buf, int len);
+R_API bool r_cons_grep_stream_enabled(void);
+R_API void r_cons_grep_stream(bool final);
 
 R_API void r_cons_rgb(ut8 r, ut8 g, ut8 b, int is_bg);
 R_API void r_cons_rgb_fgbg(ut8 r, ut8 g, ut8 b, ut8 R, ut8 G, ut8 B);
@@ -113,6 +113,13 @@ typedef struct r_core_asmsteps_t {
 	int cols;
 } RCoreAsmsteps;
 
+/* gadget index being built by /Ri, see cmd_search.c */
+typedef struct r_core_rop_index_t {
+	Sdb *db; // the ropidx namespace of RCore.sdb
+	Sdb *cls; // classes of the gadgets found so far
+	RList *keys; // one address list per key
+} RCoreRopIndex;
+
 typedef struct r_core_t {
 	RBin *bin;
 	RConfig *config;
@@ -188,6 +195,8 @@ typedef struct r_core_t {
 	char *cmdfilter;
 	bool break_loop;
 	RThreadLock *lock;
+	RThreadPool *pool; // workers of the parallel passes, see r_core_pool
+	RCoreRopIndex *rop_index; // only set while /Ri runs
 } RCore;
 
 R_API int r_core_bind(RCore *core, RCoreBind *bnd);
@@ -213,6 +222,7 @@ R_API bool r_core_init(RCore *core);
 R_API RCore *r_core_new(void);
 R_API RCore *r_core_free(RCore *core);
 R_API RCore *r_core_fini(RCore *c);
+R_API RThreadPool *r_core_pool(RCore *core);
 R_API RCore *r_core_ncast(ut64 p);
 R_API RCore *r_core_cast(void *p);
 R_API int r_core_config_init(RCore *core);
@@ -365,6 +375,7 @@ R_API int r_core_process_input_pade(RCore *core, const char *input, char** hex,
 /* anal.c */
 R_API RAnalOp* r_core_anal_op(RCore *core, ut64 addr);
 R_API void r_core_anal_esil(RCore *core, const char *str, const char *addr);
+R_API int r_core_anal_explore(RCore *core, ut64 until, int maxpaths, int maxsteps, int mode);
 R_API void r_core_anal_fcn_merge (RCore *core, ut64 addr, ut64 addr2);
 R_API const char *r_core_anal_optype_colorfor(RCore *core, ut64 addr, bool verbose);
 R_API ut64 r_core_anal_address (RCore *core, ut64 addr);
@@ -544,6 +555,7 @@ R_API int r_core_visual_comments (RCore *core);
 R_API int r_core_visual_prompt (RCore *core);
 R_API bool r_core_visual_esil (RCore *core);
 R_API int r_core_search_preludes(RCore *core);
+R_API void r_core_rop_index_free(RCoreRopIndex *ri);
 R_API int r_core_search_prelude(RCore *core, ut64 from, ut64 to, const ut8 *buf, int blen, const ut8 *mask, int mlen);
 R_API RList* /*<RIOMap*>*/ r_core_get_boundaries_prot (RCore *core, int protection, const char *mode);
 R_API RList* /*<RIOMap*>*/ r_core_get_boundaries (RCore *core, const char *mode);
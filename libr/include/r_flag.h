@@ -48,6 +48,11 @@ typedef struct r_flag_item_t {
 	char *alias;    /* used to define a flag based on a math expression (e.g. foo + 3) */
 } RFlagItem;
 
+/* The name and offset indexes are guarded by lock: lookups share it and
+ * the functions changing flags take it alone, so flags can be set from a
+ * background task while the prompt reads them. The returned items are not
+ * locked, they stay valid until someone unsets them. The list returned by
+ * r_flag_get_list is only valid while the caller holds the lock */
 typedef struct r_flag_t {
 	st64 base;         /* base address for all flag items */
 	int space_idx;     /* index of the selected space in spaces array */
@@ -56,7 +61,9 @@ typedef struct r_flag_t {
 	RNum *num;
 	RSkipList *by_off; /* flags sorted by offset, value=RFlagsAtOffset */
 	SdbHash *ht_name; /* hashmap key=item name, value=RList of items */
+	RStrIntern *names; /* interned names and realnames of the items */
 	RList *flags;   /* list of RFlagItem contained in the flag */
+	RThreadRWLock *lock; /* guards by_off, ht_name and flags */
 	RList *spacestack;
 	PrintfCallback cb_printf;
 #if R_FLAG_ZONE_USE_SDB
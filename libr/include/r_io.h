@@ -35,6 +35,7 @@ typedef struct r_io_undo_t {
 	/* write stuff */
 	RList *w_list;
 	int w_init;
+	RBNode *w_tree; /* w_list entries by address */
 	/* seek stuff */
 	int idx;
 	int undos; /* available undos */
@@ -49,6 +50,11 @@ typedef struct r_io_undo_w_t {
 	ut8 *o;   /* old data */
 	ut8 *n;   /* new data */
 	int len;  /* length */
+	ut8 *packed; /* cold entries keep o and o^n run-length encoded here */
+	int packed_len;
+	int idx;  /* position in the journal */
+	ut64 max_end;
+	RBNode rb;
 } RIOUndoWrite;
 
 typedef struct r_io_t {
@@ -75,6 +81,7 @@ typedef struct r_io_t {
 	RIDStorage *files;
 	RCache *buffer;
 	RList *cache;	//sdblist?
+	RThreadRWLock *cache_lock; // guards cache, see cache.c
 	ut8 *write_mask;
 	int write_mask_len;
 	RIOUndo undo;
@@ -113,6 +120,11 @@ typedef struct {
 	RSocket *fd;
 	RSocket *client;
 	int listener;
+	ut32 caps; // RMT_CAP_* agreed with the server, 0 speaks the old protocol
+	ut64 offset; // with caps the seek is local, it only travels before writes
+	ut64 next; // end of the last read, to read ahead sequential ones
+	ut8 *cache; // RMT_CACHE pages of RMT_PAGE bytes
+	ut64 *cache_addr; // address of each page, UT64_MAX when empty
 } RIORap;
 
 #define RMT_MAX    4096
@@ -123,8 +135,19 @@ typedef struct {
 #define RMT_CLOSE  0x05
 #define RMT_SYSTEM 0x06
 #define RMT_CMD    0x07
+#define RMT_READAT 0x08
 #define RMT_REPLY  0x80
 
+/* rap v2, see doc/rap. The capabilities are asked with a seek of this
+ * whence, old servers answer their offset which lacks the magic */
+#define RMT_HELLO  0x80
+#define RMT_MAGIC  0x5241503200000000ULL
+#define RMT_CAP_READAT 1
+#define RMT_CAP_LZ4    2
+#define RMT_PAGE   4096
+#define RMT_CACHE  64
+#define RMT_READAT_MAX 0x10000
+
 typedef struct r_io_plugin_t {
 	char *name;
 	char *desc;
@@ -374,6 +397,7 @@ R_API int r_io_wundo_apply(RIO *io, struct r_io_undo_w_t *u, int set);
 R_API void r_io_wundo_clear(RIO *io);
 R_API int r_io_wundo_size(RIO *io);
 R_API void r_io_wundo_list(RIO *io);
+R_API bool r_io_wundo_read_at(RIO *io, int idx, ut64 addr, ut8 *buf, int len);
 R_API int r_io_wundo_set_t(RIO *io, RIOUndoWrite *u, int set) ;
 R_API void r_io_wundo_set_all(RIO *io, int set);
 R_API int r_io_wundo_set(RIO *io, int n, int set);
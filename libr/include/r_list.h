@@ -25,6 +25,7 @@ typedef struct r_list_t {
 	RListFree free;
 	int length;
 	bool sorted;
+	struct r_mem_pool_t *pool; // nodes are taken from it when set
 } RList;
 
 typedef struct r_list_range_t {
@@ -71,6 +72,8 @@ typedef struct r_oflist_t {
 #endif
 R_API RList *r_list_new(void);
 R_API RList *r_list_newf(RListFree f);
+R_API RList *r_list_new_pool(struct r_mem_pool_t *pool, RListFree f);
+R_API bool r_list_set_pool(RList *list, struct r_mem_pool_t *pool);
 R_API RListIter *r_list_iter_get_next(RListIter *list);
 R_API int r_list_set_n(RList *list, int n, void *p);
 R_API void *r_list_iter_get_data(RListIter *list);
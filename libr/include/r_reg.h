@@ -91,9 +91,14 @@ typedef struct r_reg_item_t {
 	int arena; /* in which arena is this reg living */
 } RRegItem;
 
+/* popped arenas kept around per regset to be reused by the next push */
+#define R_REG_ARENA_CACHE 16
+
 typedef struct r_reg_arena_t {
 	ut8 *bytes;
 	int size;
+	int dirty_from; /* bytes written since the arena was pushed */
+	int dirty_to;
 } RRegArena;
 
 typedef struct r_reg_set_t {
@@ -101,6 +106,8 @@ typedef struct r_reg_set_t {
 	RList *pool;      /* RRegArena */
 	RList *regs;      /* RRegItem */
 	RListIter *cur;
+	RRegArena *cache[R_REG_ARENA_CACHE];
+	int ncache;
 	int maskregstype; /* which type of regs have this reg set (logic mask with RRegisterType  R_REG_TYPE_XXX) */
 } RRegSet;
 
@@ -203,6 +210,8 @@ R_API int r_reg_fit_arena(RReg *reg);
 R_API void r_reg_arena_swap(RReg *reg, int copy);
 R_API int r_reg_arena_push(RReg *reg);
 R_API void r_reg_arena_pop(RReg *reg);
+R_API void r_reg_arena_restore(RReg *reg);
+R_API void r_reg_arena_dirty(RRegArena *arena, int off, int len);
 R_API void r_reg_arena_zero(RReg *reg);
 
 R_API ut8 *r_reg_arena_peek(RReg *reg);
@@ -7,6 +7,7 @@
 #endif
 
 #include "r_types.h"
+#include "r_list.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,8 +52,23 @@ typedef struct {
 	int input[2];
 	int output[2];
 #endif
+	ut32 seq; // id of the last framed request
+	int framed; // the peer takes frames: 1 yes, -1 no, 0 not asked yet
+	ut8 *reply; // framed replies read ahead while sending
+	int reply_len;
+	int reply_size;
 } R2Pipe;
 
+/* framed r2pipe messages: a header with the magic, the request id and the
+ * payload size, all little endian, followed by the payload. The first byte
+ * of the magic never starts a text command. Only the #!pipe server of
+ * r_lang takes frames, so the first r2p_send sends a hello frame with id 0
+ * and a newline as payload. The server answers with an empty frame of id
+ * 0, any other peer (like r2 -0) runs it as a bogus text command and
+ * answers with text, and then r2p_send fails: use r2p_cmd with those */
+#define R2P_FRAME_MAGIC 0x663272ff /* "\xffr2f" */
+#define R2P_FRAME_SIZE 12
+
 typedef struct r_socket_t {
 #ifdef _MSC_VER
 	SOCKET fd;
@@ -134,9 +150,22 @@ typedef struct r_socket_http_request {
 	char *referer;
 	ut8 *data;
 	int data_length;
+	bool keepalive; // the client wants the connection open afterwards
+	int version; // minor number of the HTTP/1.x of the client
+	struct r_socket_http_conn_t *conn;
 } RSocketHTTPRequest;
 
+typedef struct r_socket_http_server_t {
+	RSocket *s; // listening socket, not owned
+	RList *conns; // idle keep-alive connections
+	int timeout;
+} RSocketHTTPServer;
+
 R_API RSocketHTTPRequest *r_socket_http_accept(RSocket *s, int timeout);
+R_API RSocketHTTPServer *r_socket_http_server_new(RSocket *s, int timeout);
+R_API void r_socket_http_server_free(RSocketHTTPServer *hs);
+R_API RSocketHTTPRequest *r_socket_http_server_accept(RSocketHTTPServer *hs);
+R_API void r_socket_http_server_close(RSocketHTTPServer *hs, RSocketHTTPRequest *rs);
 R_API void r_socket_http_response(RSocketHTTPRequest *rs, int code, const char *out, int x, const char *headers);
 R_API void r_socket_http_close(RSocketHTTPRequest *rs);
 R_API ut8 *r_socket_http_handle_upload(const ut8 *str, int len, int *olen);
@@ -241,6 +270,10 @@ R_API char *r2p_read(R2Pipe *r2p);
 R_API void r2p_free(R2Pipe *r2p);
 R_API char *r2p_cmd(R2Pipe *r2p, const char *str);
 R_API char *r2p_cmdf(R2Pipe *r2p, const char *fmt, ...);
+R_API ut32 r2p_send(R2Pipe *r2p, const char *str);
+R_API char *r2p_recv(R2Pipe *r2p, ut32 *id);
+R_API void r2p_frame_pack(ut8 *hdr, ut32 id, ut32 size);
+R_API bool r2p_frame_unpack(const ut8 *hdr, ut32 *id, ut32 *size);
 #endif
 
 #ifdef __cplusplus
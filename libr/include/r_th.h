@@ -10,6 +10,7 @@
 #define HAVE_PTHREAD 0
 #define R_TH_TID HANDLE
 #define R_TH_LOCK_T CRITICAL_SECTION
+#define R_TH_COND_T CONDITION_VARIABLE
 //HANDLE
 
 #elif HAVE_PTHREAD
@@ -17,6 +18,7 @@
 #include <pthread.h>
 #define R_TH_TID pthread_t
 #define R_TH_LOCK_T pthread_mutex_t
+#define R_TH_COND_T pthread_cond_t
 
 #else
 #error Threading library only supported for pthread and w32
@@ -44,9 +46,39 @@ typedef struct r_th_t {
 	int ready;     // thread is properly setup
 } RThread;
 
+typedef struct r_th_cond_t {
+	R_TH_COND_T cond;
+} RThreadCond;
+
+/* shared readers or a single writer, see thread_rwlock.c */
+typedef struct r_th_rwlock_t {
+	RThreadLock *lock; // guards the counters below
+	RThreadCond *cond;
+	int readers;
+	int writers; // nesting depth of the owner
+	ut64 owner;
+} RThreadRWLock;
+
+typedef void *(*RThreadTaskCallback)(void *user);
+typedef void (*RThreadForCallback)(void *user, ut64 from, ut64 to);
+
+/* pending work, returned by r_th_pool_submit and released by joining it */
+typedef struct r_th_task_t {
+	RThreadTaskCallback fcn;
+	void *user;
+	void *result;
+	bool done;
+} RThreadTask;
+
 typedef struct r_th_pool_t {
 	int size;
-	RThread **threads;
+	struct r_th_worker_t *workers;
+	struct r_th_deque_t *inject; // tasks submitted from outside the pool
+	RThreadLock *lock; // guards the sleep and completion state below
+	RThreadCond *cond;
+	int sleeping;
+	int waiting;
+	bool stop;
 } RThreadPool;
 
 #ifdef R_API
@@ -57,6 +89,7 @@ R_API int r_th_wait_async(RThread *th);
 R_API void r_th_break(RThread *th);
 R_API void *r_th_free(RThread *th);
 R_API int r_th_kill(RThread *th, int force);
+R_API int r_th_ncpus(void);
 
 R_API RThreadLock *r_th_lock_new(bool recursive);
 R_API int r_th_lock_wait(RThreadLock *th);
@@ -65,6 +98,26 @@ R_API int r_th_lock_enter(RThreadLock *thl);
 R_API int r_th_lock_leave(RThreadLock *thl);
 R_API void *r_th_lock_free(RThreadLock *thl);
 
+R_API RThreadCond *r_th_cond_new(void);
+R_API void r_th_cond_signal(RThreadCond *cond);
+R_API void r_th_cond_signal_all(RThreadCond *cond);
+R_API void r_th_cond_wait(RThreadCond *cond, RThreadLock *lock);
+R_API void r_th_cond_free(RThreadCond *cond);
+
+R_API RThreadRWLock *r_th_rwlock_new(void);
+R_API void r_th_rwlock_free(RThreadRWLock *rw);
+R_API void r_th_rwlock_read_enter(RThreadRWLock *rw);
+R_API void r_th_rwlock_read_leave(RThreadRWLock *rw);
+R_API void r_th_rwlock_write_enter(RThreadRWLock *rw);
+R_API void r_th_rwlock_write_leave(RThreadRWLock *rw);
+
+R_API RThreadPool *r_th_pool_new(int size);
+R_API void r_th_pool_free(RThreadPool *pool);
+R_API RThreadTask *r_th_pool_submit(RThreadPool *pool, RThreadTaskCallback fcn, void *user);
+R_API bool r_th_task_done(RThreadPool *pool, RThreadTask *task);
+R_API void *r_th_task_join(RThreadPool *pool, RThreadTask *task);
+R_API void r_th_pool_for(RThreadPool *pool, ut64 from, ut64 to, ut64 grain, RThreadForCallback cb, void *user);
+
 typedef struct r_thread_msg_t {
 	char *text;
 	char done;
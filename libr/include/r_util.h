@@ -40,6 +40,7 @@ int gettimeofday (struct timeval* p, void* tz);
 #include "r_util/r_file.h"
 #include "r_util/r_hex.h"
 #include "r_util/r_log.h"
+#include "r_util/r_lz4.h"
 #include "r_util/r_mem.h"
 #include "r_util/r_mixed.h"
 #include "r_util/r_name.h"
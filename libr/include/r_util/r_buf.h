@@ -1,12 +1,14 @@
 #ifndef R_BUF_H
 #define R_BUF_H
 #include <r_util/r_mem.h>
+#include <r_util/r_rbtree.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define R_BUF_CUR UT64_MAX
+#define R_BUF_SPARSE_PAGE 4096
 
 typedef struct r_buf_t {
 	ut8 *buf;
@@ -18,7 +20,8 @@ typedef struct r_buf_t {
 	bool ro; // read-only
 	int fd;
 	int Oxff;
-	RList *sparse;
+	bool sparse;
+	RBNode *sparse_pages; // page tree, unwritten bytes read as Oxff
 } RBuffer;
 
 typedef struct r_buf_cache_t {
@@ -41,6 +44,7 @@ R_API RBuffer *r_buf_new_slurp(const char *file);
 R_API RBuffer *r_buf_new_empty (ut64 len);
 R_API RBuffer *r_buf_mmap(const char *file, int flags);
 R_API RBuffer *r_buf_new_sparse(ut8 Oxff);
+R_API RList *r_buf_sparse_chunks(RBuffer *b);
 R_API bool r_buf_dump (RBuffer *buf, const char *file);
 /* methods */
 R_API bool r_buf_set_bits(RBuffer *b, ut64 at, const ut8* buf, int bitoff, int count);
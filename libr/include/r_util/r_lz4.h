@@ -0,0 +1,21 @@
+#ifndef R_LZ4_H
+#define R_LZ4_H
+
+#include <r_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// LZ4 block format, fast to compress and to decompress. The frames are
+// not handled, the sizes travel elsewhere.
+
+R_API int r_lz4_bound(int len);
+R_API int r_lz4_compress(const ut8 *src, int len, ut8 *dst, int dstlen);
+R_API int r_lz4_decompress(const ut8 *src, int len, ut8 *dst, int dstlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // R_LZ4_H
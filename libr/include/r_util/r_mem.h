@@ -18,13 +18,15 @@ typedef struct r_mmap_t {
 } RMmap;
 
 typedef struct r_mem_pool_t {
-	ut8 **nodes;
-	int ncount;
-	int npool;
+	ut8 **nodes;	// slabs of poolsize nodes each
+	int ncount;	// nodes taken from the last slab
+	int npool;	// last slab in use
 	//
 	int nodesize;
 	int poolsize;
-	int poolcount;
+	int poolcount;	// room for slabs in nodes
+	void *freelist;	// released nodes, linked through their first word
+	int used;	// nodes handed out and not released yet
 } RMemoryPool;
 
 R_API ut64 r_mem_get_num(const ut8 *b, int size);
@@ -34,6 +36,8 @@ R_API RMemoryPool* r_mem_pool_deinit(RMemoryPool *pool);
 R_API RMemoryPool *r_mem_pool_new(int nodesize, int poolsize, int poolcount);
 R_API RMemoryPool *r_mem_pool_free(RMemoryPool *pool);
 R_API void* r_mem_pool_alloc(RMemoryPool *pool);
+R_API int r_mem_pool_dealloc(RMemoryPool *pool, void *p);
+R_API void r_mem_pool_reset(RMemoryPool *pool);
 R_API void *r_mem_dup(void *s, int l);
 R_API void *r_mem_alloc(int sz);
 R_API void r_mem_free(void *);
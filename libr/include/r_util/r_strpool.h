@@ -27,6 +27,19 @@ R_API char *r_strpool_next(RStrpool *p, int index);
 R_API char *r_strpool_slice(RStrpool *p, int index);
 R_API char *r_strpool_empty(RStrpool *p);
 
+typedef struct r_str_intern_t {
+	SdbHash *ht; // text -> entry
+	int refs;
+} RStrIntern;
+
+R_API RStrIntern *r_str_intern_new(void);
+R_API RStrIntern *r_str_intern_ref(RStrIntern *si);
+R_API void r_str_intern_free(RStrIntern *si);
+R_API char *r_str_intern_get(RStrIntern *si, const char *s);
+R_API char *r_str_intern_dup(const char *s);
+R_API RStrIntern *r_str_intern_pool(const char *s);
+R_API void r_str_intern_put(const char *s);
+
 #ifdef __cplusplus
 }
 #endif
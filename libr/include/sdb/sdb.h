@@ -84,6 +84,10 @@ typedef struct sdb_t {
 	int refs; // reference counter
 	int lock;
 	int journal;
+	char *journal_buf; // log lines not synced yet
+	int journal_len;
+	int journal_size;
+	bool journal_rebase; // the file moved, the next sync writes it whole
 	struct cdb db;
 	struct cdb_make m;
 	SdbHash *ht;
@@ -162,6 +166,7 @@ int sdb_uncat(Sdb *s, const char *key, const char *value, ut32 cas);
 int sdb_add(Sdb* s, const char *key, const char *val, ut32 cas);
 bool sdb_sync(Sdb*);
 void sdb_kv_free(SdbKv *kv);
+ut32 sdb_kv_touch(Sdb *s, SdbKv *kv);
 
 /* num.c */
 int  sdb_num_exists(Sdb*, const char *key);
@@ -194,6 +199,7 @@ SDB_API bool sdb_journal_close(Sdb *s);
 SDB_API bool sdb_journal_open(Sdb *s);
 SDB_API int sdb_journal_load(Sdb *s);
 SDB_API bool sdb_journal_log(Sdb *s, const char *key, const char *val);
+SDB_API bool sdb_journal_sync(Sdb *s);
 SDB_API bool sdb_journal_clear(Sdb *s);
 SDB_API bool sdb_journal_unlink(Sdb *s);
 
@@ -3,6 +3,20 @@
 
 #include "ht.h"
 
+/* numeric view of an array value, kept by the array api to add and find
+ * numbers without parsing and rewriting the whole string every time. It is
+ * only valid while cas matches the one of the kv */
+typedef struct sdb_array_index_t {
+	ut64 *nums;
+	ut32 count;
+	ut32 size;
+	ut64 *set;	// membership set, built once the array grows
+	ut32 set_size;
+	bool set_max;	// UT64_MAX marks the empty set slots
+	ut32 cas;
+	ut32 capacity;	// bytes allocated for the value
+} SdbArrayIndex;
+
 /** keyvalue pair **/
 typedef struct sdb_kv {
 	//sub of HtKv so we can cast safely
@@ -12,12 +26,14 @@ typedef struct sdb_kv {
 	ut32 value_len;
 	ut32 cas;
 	ut64 expire;
+	SdbArrayIndex *array;
 } SdbKv;
 
 SDB_API SdbKv* sdb_kv_new2(const char *k, int kl, const char *v, int vl);
 extern SdbKv* sdb_kv_new(const char *k, const char *v);
 extern ut32 sdb_hash(const char *key);
 extern void sdb_kv_free(SdbKv *kv);
+SDB_API void sdb_array_index_free(SdbArrayIndex *ai);
 
 SdbHash* sdb_ht_new(void);
 // Destroy a hashtable and all of its entries.
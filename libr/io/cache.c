@@ -1,10 +1,16 @@
 /* radare - LGPL - Copyright 2008-2017 - pancake */
 
 // TODO: implement a more inteligent way to store cached memory
-// TODO: define limit of max mem to cache
 
 #include "r_io.h"
 
+/* io->cache is guarded by io->cache_lock: reads share it and the rest take
+ * it alone, so a background task can patch while the prompt reads. The
+ * write lock is not held while reading the original bytes */
+
+/* past this many patches the cache stops keeping every write apart */
+#define IO_CACHE_HISTORY 256
+
 static void cache_item_free(RIOCache *cache) {
 	if (!cache)
 		return;
@@ -14,13 +20,20 @@ static void cache_item_free(RIOCache *cache) {
 }
 
 R_API void r_io_cache_init(RIO *io) {
+	if (!io->cache_lock) {
+		io->cache_lock = r_th_rwlock_new ();
+	}
+	r_th_rwlock_write_enter (io->cache_lock);
+	r_list_free (io->cache);
 	io->cache = r_list_newf ((RListFree)cache_item_free);
 	io->cached = 0;
+	r_th_rwlock_write_leave (io->cache_lock);
 }
 
 R_API void r_io_cache_commit(RIO *io, ut64 from, ut64 to) {
 	RListIter *iter;
 	RIOCache *c;
+	r_th_rwlock_write_enter (io->cache_lock);
 	r_list_foreach (io->cache, iter, c) {
 		if (from <= c->to - 1 && c->from <= to - 1) {
 			int cached = io->cached;
@@ -34,11 +47,14 @@ R_API void r_io_cache_commit(RIO *io, ut64 from, ut64 to) {
 			break; // XXX old behavior, revisit this
 		}
 	}
+	r_th_rwlock_write_leave (io->cache_lock);
 }
 
 R_API void r_io_cache_reset(RIO *io, int set) {
+	r_th_rwlock_write_enter (io->cache_lock);
 	io->cached = set;
 	r_list_purge (io->cache);
+	r_th_rwlock_write_leave (io->cache_lock);
 }
 
 R_API int r_io_cache_invalidate(RIO *io, ut64 from, ut64 to) {
@@ -47,6 +63,7 @@ R_API int r_io_cache_invalidate(RIO *io, ut64 from, ut64 to) {
 	int done = false;
 
 	if (from<to) {
+		r_th_rwlock_write_enter (io->cache_lock);
 		//r_list_foreach_safe (io->cache, iter, iter_tmp, c) {
 		r_list_foreach (io->cache, iter, c) {
 			if (c->from >= from && c->to <= to) {
@@ -61,6 +78,7 @@ R_API int r_io_cache_invalidate(RIO *io, ut64 from, ut64 to) {
 				break;
 			}
 		}
+		r_th_rwlock_write_leave (io->cache_lock);
 	}
 	return done;
 }
@@ -72,6 +90,7 @@ R_API int r_io_cache_list(RIO *io, int rad) {
 	if (rad == 2) {
 		io->cb_printf ("[");
 	}
+	r_th_rwlock_read_enter (io->cache_lock);
 	r_list_foreach (io->cache, iter, c) {
 		if (rad == 1) {
 			io->cb_printf ("wx ");
@@ -108,25 +127,108 @@ R_API int r_io_cache_list(RIO *io, int rad) {
 		}
 		j++;
 	}
+	r_th_rwlock_read_leave (io->cache_lock);
 	if (rad == 2)
 		io->cb_printf ("]");
 	return false;
 }
 
+/* once the cache holds IO_CACHE_HISTORY patches, the unwritten ones that
+ * overlap ch are folded into it: the cache then grows with the patched
+ * bytes and not with the writes, which matters when emulating. Each byte
+ * keeps the odata of its oldest patch and the data of ch. Called with the
+ * write lock held, before ch is in the list */
+static void cache_fold(RIO *io, RIOCache *ch) {
+	RListIter *iter, *tmp;
+	ut64 from = ch->from, to = ch->to;
+	bool grown, found = false;
+	ut8 *data, *odata;
+	RIOCache *c;
+	int size;
+	if (r_list_length (io->cache) < IO_CACHE_HISTORY) {
+		return;
+	}
+	do {
+		grown = false;
+		r_list_foreach (io->cache, iter, c) {
+			if (!c->written && c->from < to && from < c->to) {
+				found = true;
+				if (c->from < from || c->to > to) {
+					from = R_MIN (from, c->from);
+					to = R_MAX (to, c->to);
+					grown = true;
+				}
+			}
+		}
+	} while (grown);
+	if (!found || to - from > ST32_MAX) {
+		return;
+	}
+	size = to - from;
+	data = malloc (size);
+	odata = malloc (size);
+	if (!data || !odata) {
+		free (data);
+		free (odata);
+		return;
+	}
+	/* the bytes between the patches are the current ones */
+	r_io_read_at (io, from, data, size);
+	memcpy (odata, data, size);
+	memcpy (odata + (ch->from - from), ch->odata, ch->size);
+	r_list_foreach_prev (io->cache, iter, c) {
+		if (!c->written && c->from >= from && c->to <= to) {
+			memcpy (odata + (c->from - from), c->odata, c->size);
+		}
+	}
+	memcpy (data + (ch->from - from), ch->data, ch->size);
+	r_list_foreach_safe (io->cache, iter, tmp, c) {
+		if (!c->written && c->from >= from && c->to <= to) {
+			r_list_delete (io->cache, iter);
+		}
+	}
+	free (ch->data);
+	free (ch->odata);
+	ch->data = data;
+	ch->odata = odata;
+	ch->from = from;
+	ch->to = to;
+	ch->size = size;
+}
+
 R_API bool r_io_cache_write(RIO *io, ut64 addr, const ut8 *buf, int len) {
 	RIOCache *ch;
+	ut8 *odata;
+	int from, to;
+	odata = (ut8*)calloc (1, len + 1);
+	if (!odata) {
+		return false;
+	}
+	r_io_read_at (io, addr, odata, len);
+	/* only cache the bytes that change */
+	for (from = 0; from < len && odata[from] == buf[from]; from++) {
+		;
+	}
+	if (from == len) {
+		free (odata);
+		return true;
+	}
+	for (to = len; to > from && odata[to - 1] == buf[to - 1]; to--) {
+		;
+	}
 	ch = R_NEW0 (RIOCache);
 	if (!ch) {
+		free (odata);
 		return false;
 	}
-	ch->from = addr;
-	ch->to = addr + len;
+	len = to - from;
+	ch->from = addr + from;
+	ch->to = ch->from + len;
 	ch->size = len;
-	ch->odata = (ut8*)calloc (1, len + 1);
-	if (!ch->odata) {
-		free (ch);
-		return false;
+	if (from) {
+		memmove (odata, odata + from, len);
 	}
+	ch->odata = odata;
 	ch->data = (ut8*)calloc (1, len + 1);
 	if (!ch->data) {
 		free (ch->odata);
@@ -134,9 +236,11 @@ R_API bool r_io_cache_write(RIO *io, ut64 addr, const ut8 *buf, int len) {
 		return false;
 	}
 	ch->written = false;
-	r_io_read_at (io, addr, ch->odata, len);
-	memcpy (ch->data, buf, len);
+	memcpy (ch->data, buf + from, len);
+	r_th_rwlock_write_enter (io->cache_lock);
+	cache_fold (io, ch);
 	r_list_append (io->cache, ch);
+	r_th_rwlock_write_leave (io->cache_lock);
 	return true;
 }
 
@@ -144,6 +248,7 @@ R_API bool r_io_cache_read(RIO *io, ut64 addr, ut8 *buf, int len) {
 	int l, covered = 0;
 	RListIter *iter;
 	RIOCache *c;
+	r_th_rwlock_read_enter (io->cache_lock);
 	r_list_foreach (io->cache, iter, c) {
 		if (addr < c->to && c->from < addr + len) {
 			if (addr < c->from) {
@@ -156,5 +261,6 @@ R_API bool r_io_cache_read(RIO *io, ut64 addr, ut8 *buf, int len) {
 			covered += l;
 		}
 	}
+	r_th_rwlock_read_leave (io->cache_lock);
 	return (covered == 0) ? false: true;
 }
@@ -357,7 +357,6 @@ R_API int r_io_close_all(RIO* io) { // what about undo?
 	r_io_map_fini (io);
 	r_io_section_fini (io);
 	ls_free (io->plugins);
-	r_list_free (io->cache);
 	r_io_desc_init (io);
 	r_io_map_init (io);
 	r_io_section_init (io);
@@ -508,6 +507,9 @@ R_API bool r_io_write_at(RIO* io, ut64 addr, const ut8* buf, int len) {
 			mybuf[i] &= io->write_mask[i % io->write_mask_len];
 		}
 	}
+	if (io->undo.w_enable) {
+		r_io_wundo_new (io, addr, mybuf, len);
+	}
 	if (io->cached & R_IO_WRITE) {
 		ret = r_io_cache_write (io, addr, mybuf, len);
 		io->ret = ret? len: -1;
@@ -518,6 +520,9 @@ R_API bool r_io_write_at(RIO* io, ut64 addr, const ut8* buf, int len) {
 		io->ret = r_io_pwrite_at (io, addr, mybuf, len);
 		ret = io->ret > 0;
 	}
+	if (ret && io->cb_core_post_write) {
+		io->cb_core_post_write (io->user, addr, mybuf, len);
+	}
 	if (buf != mybuf) {
 		free (mybuf);
 	}
@@ -762,6 +767,9 @@ R_API int r_io_fini(RIO* io) {
 	r_io_section_fini (io);
 	ls_free (io->plugins);
 	r_list_free (io->cache);
+	io->cache = NULL;
+	r_th_rwlock_free (io->cache_lock);
+	io->cache_lock = NULL;
 	r_list_free (io->undo.w_list);
 	if (io->runprofile) {
 		R_FREE (io->runprofile);
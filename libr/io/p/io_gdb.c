@@ -215,6 +215,8 @@ static int __system(RIO *io, RIODesc *fd, const char *cmd) {
 			                     " to target interpreter\n"
 			 " =!detach [pid]    - detach from remote/detach specific pid\n"
 			 " =!inv.reg         - invalidate reg cache\n"
+			 " =!inv.mem         - invalidate memory cache\n"
+			 " =!readahead [n]   - get/set pages read ahead (-1 = no cache)\n"
 			 " =!pktsz           - get max packet size used\n"
 			 " =!pktsz bytes     - set max. packet size as 'bytes' bytes\n"
 			 " =!exec_file [pid] - get file which was executed for"
@@ -248,6 +250,7 @@ static int __system(RIO *io, RIODesc *fd, const char *cmd) {
 		return gdbr_detach_pid (desc, pid) >= 0;
 	}
 	if (r_str_startswith (cmd, "pkt ")) {
+		gdbr_invalidate_mem_cache ();
 		if (send_msg (desc, cmd + 4) == -1) {
 			return false;
 		}
@@ -281,6 +284,20 @@ static int __system(RIO *io, RIODesc *fd, const char *cmd) {
 		gdbr_invalidate_reg_cache ();
 		return true;
 	}
+	if (r_str_startswith (cmd, "inv.mem")) {
+		gdbr_invalidate_mem_cache ();
+		return true;
+	}
+	if (r_str_startswith (cmd, "readahead")) {
+		const char *ptr = r_str_chop_ro (cmd + 9);
+		if (!*ptr) {
+			io->cb_printf ("%d\n", desc->readahead);
+			return true;
+		}
+		desc->readahead = R_MAX (atoi (ptr), -1);
+		gdbr_invalidate_mem_cache ();
+		return true;
+	}
 	if (r_str_startswith (cmd, "exec_file")) {
 		const char *ptr = cmd + strlen ("exec_file");
 		char *file;
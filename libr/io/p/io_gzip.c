@@ -1,155 +1,337 @@
-/* radare - LGPL - Copyright 2008-2017 - pancake */
+/* radare - LGPL - Copyright 2008-2018 - pancake */
 
 #include "r_io.h"
 #include "r_lib.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <zlib.h>
+
+/* random access to the uncompressed data without inflating the whole file:
+ * a full pass on open records a checkpoint (input position and the last 32K
+ * of output) every GZ_SPAN bytes, and reads inflate from the nearest one.
+ * The last GZ_CACHE decompressed spans are kept around */
+
+#define GZ_SPAN (1024 * 1024)
+#define GZ_WINSIZE 32768
+#define GZ_CHUNK 16384
+#define GZ_CACHE 8
+
+typedef struct {
+	ut64 out; // offset in the uncompressed data
+	ut64 in; // offset of the first full compressed byte
+	int bits; // bits of the previous byte still to be fed
+	ut8 *window; // output preceding this point
+} RIOGzipPoint;
 
 typedef struct {
+	int idx; // checkpoint this span starts at
 	ut8 *buf;
 	ut32 size;
+	ut64 used;
+	bool dirty; // written to, never evicted
+} RIOGzipSpan;
+
+typedef struct {
+	int fd;
+	ut64 size;
 	ut64 offset;
+	RIOGzipPoint *points;
+	int npoints;
+	RList *spans;
+	ut64 clock;
 } RIOGzip;
 
-static inline ut32 _io_malloc_sz(RIODesc *desc) {
-	if (!desc) {
-		return 0;
+static void gzip_span_free(void *p) {
+	RIOGzipSpan *span = p;
+	if (span) {
+		free (span->buf);
+		free (span);
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	return mal? mal->size: 0;
-} 
+}
 
-static inline void _io_malloc_set_sz(RIODesc *desc, ut32 sz) {
-	if (!desc) {
+static void gzip_free(RIOGzip *gz) {
+	int i;
+	if (!gz) {
 		return;
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	if (mal) {
-		mal->size = sz;
+	for (i = 0; i < gz->npoints; i++) {
+		free (gz->points[i].window);
 	}
-} 
+	free (gz->points);
+	r_list_free (gz->spans);
+	if (gz->fd != -1) {
+		r_sandbox_close (gz->fd);
+	}
+	free (gz);
+}
 
-static inline ut8* _io_malloc_buf(RIODesc *desc) {
-	if (!desc) {
-		return NULL;
+static bool gzip_add_point(RIOGzip *gz, int bits, ut64 in, ut64 out, ut32 left, const ut8 *window) {
+	RIOGzipPoint *p;
+	if (!(gz->npoints & 63)) {
+		p = realloc (gz->points, (gz->npoints + 64) * sizeof (RIOGzipPoint));
+		if (!p) {
+			return false;
+		}
+		gz->points = p;
+	}
+	p = &gz->points[gz->npoints];
+	if (!(p->window = malloc (GZ_WINSIZE))) {
+		return false;
+	}
+	p->bits = bits;
+	p->in = in;
+	p->out = out;
+	/* the window is circular, store it in order */
+	if (left) {
+		memcpy (p->window, window + GZ_WINSIZE - left, left);
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	return mal->buf;
+	if (left < GZ_WINSIZE) {
+		memcpy (p->window + left, window, GZ_WINSIZE - left);
+	}
+	gz->npoints++;
+	return true;
 }
 
+/* inflate the whole stream once, recording a checkpoint at the first block
+ * boundary after every GZ_SPAN bytes of output */
+static bool gzip_build_index(RIOGzip *gz) {
+	ut8 input[GZ_CHUNK];
+	ut8 *window = calloc (1, GZ_WINSIZE);
+	ut64 totin = 0, totout = 0, last = 0;
+	z_stream strm = {0};
+	int ret = Z_OK;
+	if (!window) {
+		return false;
+	}
+	// 47 inflates both zlib and gzip streams
+	if (inflateInit2 (&strm, 47) != Z_OK) {
+		free (window);
+		return false;
+	}
+	do {
+		int n = r_sandbox_read (gz->fd, input, sizeof (input));
+		if (n <= 0) {
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		strm.avail_in = n;
+		strm.next_in = input;
+		do {
+			if (!strm.avail_out) {
+				strm.avail_out = GZ_WINSIZE;
+				strm.next_out = window;
+			}
+			totin += strm.avail_in;
+			totout += strm.avail_out;
+			ret = inflate (&strm, Z_BLOCK);
+			totin -= strm.avail_in;
+			totout -= strm.avail_out;
+			if (ret == Z_NEED_DICT) {
+				ret = Z_DATA_ERROR;
+			}
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+				break;
+			}
+			if (ret == Z_STREAM_END) {
+				break;
+			}
+			/* end of a deflate block that is not the last one */
+			if ((strm.data_type & 128) && !(strm.data_type & 64)
+					&& (!totout || totout - last > GZ_SPAN)) {
+				if (!gzip_add_point (gz, strm.data_type & 7, totin,
+						totout, strm.avail_out, window)) {
+					ret = Z_MEM_ERROR;
+					break;
+				}
+				last = totout;
+			}
+		} while (strm.avail_in);
+	} while (ret != Z_STREAM_END && ret != Z_MEM_ERROR && ret != Z_DATA_ERROR);
+	inflateEnd (&strm);
+	free (window);
+	gz->size = totout;
+	return ret == Z_STREAM_END && gz->npoints > 0;
+}
 
-static inline ut8* _io_malloc_set_buf(RIODesc *desc, ut8* buf) {
-	if (!desc) {
+/* inflate the span between checkpoint idx and the next one */
+static RIOGzipSpan *gzip_inflate_span(RIOGzip *gz, int idx) {
+	RIOGzipPoint *p = &gz->points[idx];
+	ut64 end = (idx + 1 < gz->npoints)? gz->points[idx + 1].out: gz->size;
+	ut8 input[GZ_CHUNK];
+	z_stream strm = {0};
+	RIOGzipSpan *span;
+	int ret = Z_OK;
+	if (!(span = R_NEW0 (RIOGzipSpan))) {
+		return NULL;
+	}
+	span->idx = idx;
+	span->size = end - p->out;
+	if (!(span->buf = malloc (span->size + 1))) {
+		free (span);
 		return NULL;
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	return mal->buf = buf;
+	if (inflateInit2 (&strm, -15) != Z_OK) {
+		gzip_span_free (span);
+		return NULL;
+	}
+	r_sandbox_lseek (gz->fd, p->in - (p->bits? 1: 0), SEEK_SET);
+	if (p->bits) {
+		ut8 ch;
+		if (r_sandbox_read (gz->fd, &ch, 1) != 1) {
+			ret = Z_DATA_ERROR;
+		} else {
+			inflatePrime (&strm, p->bits, ch >> (8 - p->bits));
+		}
+	}
+	inflateSetDictionary (&strm, p->window, GZ_WINSIZE);
+	strm.next_out = span->buf;
+	strm.avail_out = span->size;
+	while (ret == Z_OK && strm.avail_out) {
+		int n = r_sandbox_read (gz->fd, input, sizeof (input));
+		if (n <= 0) {
+			break;
+		}
+		strm.next_in = input;
+		strm.avail_in = n;
+		while (strm.avail_in && strm.avail_out && ret == Z_OK) {
+			ret = inflate (&strm, Z_NO_FLUSH);
+		}
+	}
+	inflateEnd (&strm);
+	if (strm.avail_out) {
+		eprintf ("gzip: cannot inflate 0x%"PFMT64x"\n", p->out);
+		gzip_span_free (span);
+		return NULL;
+	}
+	return span;
 }
 
-static inline ut64 _io_malloc_off(RIODesc *desc) {
-	if (!desc) {
-		return 0;
+static RIOGzipSpan *gzip_span(RIOGzip *gz, ut64 off) {
+	RIOGzipSpan *span, *lru = NULL;
+	RListIter *iter;
+	int lo = 0, hi = gz->npoints - 1, clean = 0;
+	while (lo < hi) {
+		int mid = lo + (hi - lo + 1) / 2;
+		if (gz->points[mid].out <= off) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	r_list_foreach (gz->spans, iter, span) {
+		if (span->idx == lo) {
+			span->used = ++gz->clock;
+			return span;
+		}
+		if (!span->dirty) {
+			if (!lru || span->used < lru->used) {
+				lru = span;
+			}
+			clean++;
+		}
+	}
+	if (clean >= GZ_CACHE && lru) {
+		r_list_delete_data (gz->spans, lru);
+	}
+	span = gzip_inflate_span (gz, lo);
+	if (span) {
+		span->used = ++gz->clock;
+		r_list_append (gz->spans, span);
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	return mal->offset;
+	return span;
 }
 
-static inline void _io_malloc_set_off(RIODesc *desc, ut64 off) {
-	if (!desc) {
-		return;
+/* copy between buf and the uncompressed data, count is already clamped */
+static int gzip_access(RIOGzip *gz, ut8 *buf, int count, bool write) {
+	ut64 off = gz->offset;
+	int done = 0;
+	while (done < count) {
+		RIOGzipSpan *span = gzip_span (gz, off);
+		ut64 delta;
+		int n;
+		if (!span) {
+			break;
+		}
+		delta = off - gz->points[span->idx].out;
+		n = R_MIN (count - done, span->size - delta);
+		if (n < 1) {
+			break;
+		}
+		if (write) {
+			memcpy (span->buf + delta, buf + done, n);
+			span->dirty = true;
+		} else {
+			memcpy (buf + done, span->buf + delta, n);
+		}
+		done += n;
+		off += n;
 	}
-	RIOGzip *mal = (RIOGzip*)desc->data;
-	mal->offset = off;
+	return done;
 }
 
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
-	if (!fd || !buf || count < 0 || !fd->data) {
+	RIOGzip *gz = fd? fd->data: NULL;
+	if (!gz || !buf || count < 0) {
 		return -1;
 	}
-	if (_io_malloc_off (fd) > _io_malloc_sz (fd)) {
+	if (gz->offset >= gz->size) {
 		return -1;
 	}
-	if (_io_malloc_off (fd) + count > _io_malloc_sz (fd)) {
-		count -= (_io_malloc_off (fd) + count -_io_malloc_sz (fd));
+	if (gz->offset + count > gz->size) {
+		count = gz->size - gz->offset;
 	}
+	count = gzip_access (gz, (ut8 *)buf, count, true);
 	if (count > 0) {
-		memcpy (_io_malloc_buf (fd) + _io_malloc_off (fd), buf, count);
-		_io_malloc_set_off (fd, _io_malloc_off (fd) + count);
+		gz->offset += count;
 		return count;
 	}
 	return -1;
 }
 
-static bool __resize(RIO *io, RIODesc *fd, ut64 count) {
-	ut8 * new_buf = NULL;
-	if (!fd || !fd->data || count == 0) {
-		return false;
-	}
-	ut32 mallocsz = _io_malloc_sz (fd);
-	if (_io_malloc_off (fd) > mallocsz) {
-		return false;
-	}
-	new_buf = malloc (count);
-	if (!new_buf) {
-		return -1;
-	}
-	memcpy (new_buf, _io_malloc_buf (fd), R_MIN (count, mallocsz));
-	if (count > mallocsz) {
-		memset (new_buf + mallocsz, 0, count - mallocsz);
-	}
-	free (_io_malloc_buf (fd));
-	_io_malloc_set_buf (fd, new_buf);
-	_io_malloc_set_sz (fd, count);
-	return true;
-}
-
 static int __read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
+	RIOGzip *gz = fd? fd->data: NULL;
 	memset (buf, 0xff, count);
-	if (!fd || !fd->data) {
+	if (!gz) {
 		return -1;
 	}
-	ut32 mallocsz = _io_malloc_sz (fd);
-	if (_io_malloc_off (fd) > mallocsz) {
+	if (gz->offset > gz->size) {
 		return -1;
 	}
-	if (_io_malloc_off (fd) + count >= mallocsz) {
-		count = mallocsz - _io_malloc_off (fd);
+	if (gz->offset + count >= gz->size) {
+		count = gz->size - gz->offset;
 	}
-	memcpy (buf, _io_malloc_buf (fd) + _io_malloc_off (fd), count);
-	return count;
+	return gzip_access (gz, buf, count, false);
 }
 
 static int __close(RIODesc *fd) {
-	RIOGzip *riom;
 	if (!fd || !fd->data) {
 		return -1;
 	}
-	riom = fd->data;
-	R_FREE (riom->buf);
-	R_FREE (fd->data);
+	gzip_free (fd->data);
+	fd->data = NULL;
 	eprintf ("TODO: Writing changes into gzipped files is not yet supported\n");
 	return 0;
 }
 
 static ut64 __lseek(RIO* io, RIODesc *fd, ut64 offset, int whence) {
+	RIOGzip *gz = fd? fd->data: NULL;
 	ut64 r_offset = offset;
-	if (!fd || !fd->data) {
+	if (!gz) {
 		return offset;
 	}
-	ut32 mallocsz = _io_malloc_sz (fd);
 	switch (whence) {
 	case SEEK_SET:
-		r_offset = (offset <= mallocsz) ? offset : mallocsz;
+		r_offset = (offset <= gz->size)? offset: gz->size;
 		break;
 	case SEEK_CUR:
-		r_offset = (_io_malloc_off (fd) + offset <= mallocsz ) ? _io_malloc_off (fd) + offset : mallocsz;
+		r_offset = (gz->offset + offset <= gz->size)? gz->offset + offset: gz->size;
 		break;
 	case SEEK_END:
-		r_offset = _io_malloc_sz (fd);
+		r_offset = gz->size;
 		break;
 	}
-	_io_malloc_set_off (fd, r_offset);
+	gz->offset = r_offset;
 	return r_offset;
 }
 
@@ -159,20 +341,17 @@ static bool __plugin_open(RIO *io, const char *pathname, bool many) {
 
 static RIODesc *__open(RIO *io, const char *pathname, int rw, int mode) {
 	if (__plugin_open (io, pathname, 0)) {
-		RIOGzip *mal = R_NEW0 (RIOGzip);
-		if (!mal) {
+		RIOGzip *gz = R_NEW0 (RIOGzip);
+		if (!gz) {
 			return NULL;
 		}
-		int len;
-		ut8 *data = (ut8*)r_file_slurp (pathname+7, &len);	//memleak here?
-		int *size = (int*)&mal->size;
-		mal->buf = r_inflate (data, len, NULL, size);
-		if (mal->buf) {
-			return r_io_desc_new (io, &r_io_plugin_gzip, pathname, rw, mode, mal);
+		gz->spans = r_list_newf (gzip_span_free);
+		gz->fd = r_sandbox_open (pathname + 7, O_RDONLY | O_BINARY, 0);
+		if (gz->spans && gz->fd != -1 && gzip_build_index (gz)) {
+			return r_io_desc_new (io, &r_io_plugin_gzip, pathname, rw, mode, gz);
 		}
-		free (data);
-		eprintf ("Cannot allocate (%s) %d bytes\n", pathname+9, mal->size);
-		free (mal);
+		eprintf ("Cannot inflate (%s)\n", pathname + 7);
+		gzip_free (gz);
 	}
 	return NULL;
 }
@@ -187,7 +366,6 @@ RIOPlugin r_io_plugin_gzip = {
 	.check = __plugin_open,
 	.lseek = __lseek,
 	.write = __write,
-	.resize = __resize,
 };
 
 #ifndef CORELIB
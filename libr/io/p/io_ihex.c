@@ -48,6 +48,7 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 	Rihex *rih;
 	RBufferSparse *rbs;
 	RListIter *iter;
+	RList *chunks;
 
 	if (!fd || !fd->data || (fd->flags & R_IO_WRITE) == 0 || count <= 0) {
 		return -1;
@@ -66,12 +67,16 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 		return -1;
 	}
 
-	/* disk write : process each sparse chunk */
-	//TODO : sort addresses + check overlap?
-	r_list_foreach (rih->rbuf->sparse, iter, rbs) {
+	/* disk write : process each sparse chunk, sorted by address */
+	chunks = r_buf_sparse_chunks (rih->rbuf);
+	if (!chunks) {
+		fclose (out);
+		return -1;
+	}
+	r_list_foreach (chunks, iter, rbs) {
 		ut16 addl0 = rbs->from & 0xffff;
 		ut16 addh0 = rbs->from >> 16;
-		ut16 addh1 = rbs->to >> 16;
+		ut16 addh1 = (rbs->to - 1) >> 16;
 		ut16 tsiz =0;
 		if (rbs->size == 0) {
 			continue;
@@ -82,6 +87,7 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 			//04 record (ext address)
 			if (fw04b (out, addh0) < 0) {
 				eprintf("ihex:write: file error\n");
+				r_list_free (chunks);
 				fclose (out);
 				return -1;
 			}
@@ -90,6 +96,7 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 			addl0 = 0;
 			if (fwblock (out, rbs->data, rbs->from, tsiz)) {
 				eprintf ("ihex:fwblock error\n");
+				r_list_free (chunks);
 				fclose (out);
 				return -1;
 			}
@@ -97,16 +104,19 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 		//04 record (ext address)
 		if (fw04b (out, addh1) < 0) {
 			eprintf ("ihex:write: file error\n");
+			r_list_free (chunks);
 			fclose (out);
 			return -1;
 		}
 		//00 records (remaining data)
 		if (fwblock (out, rbs->data + tsiz, (addh1 << 16) | addl0, rbs->size - tsiz)) {
 			eprintf ("ihex:fwblock error\n");
+			r_list_free (chunks);
 			fclose (out);
 			return -1;
 		}
 	}	//list_foreach
+	r_list_free (chunks);
 
 	fprintf (out, ":00000001FF\n");
 	fclose (out);
@@ -38,6 +38,23 @@ procpidmem is buggy.. running this sometimes results in ffff
 #endif
 #define USE_PROC_PID_MEM 0
 
+/* process_vm_readv/writev move a whole range in one syscall instead of
+ * one PEEK/POKE per word */
+#if __linux__ && !__ANDROID__
+#define USE_PROCESS_VM 1
+#include <sys/uio.h>
+#define PROCESS_VM_PAGE 4096
+#define PROCESS_VM_IOV 64
+extern ssize_t process_vm_readv(pid_t pid, const struct iovec *local_iov,
+	unsigned long liovcnt, const struct iovec *remote_iov,
+	unsigned long riovcnt, unsigned long flags);
+extern ssize_t process_vm_writev(pid_t pid, const struct iovec *local_iov,
+	unsigned long liovcnt, const struct iovec *remote_iov,
+	unsigned long riovcnt, unsigned long flags);
+#else
+#define USE_PROCESS_VM 0
+#endif
+
 static int __waitpid(int pid) {
 	int st = 0;
 	return (waitpid (pid, &st, 0) != -1);
@@ -70,6 +87,62 @@ static int debug_os_read_at(int pid, ut32 *buf, int sz, ut64 addr) {
 	return sz;
 }
 
+#if USE_PROCESS_VM
+/* read page by page in batches of PROCESS_VM_IOV remote iovecs, the kernel
+ * stops at the first unmapped page so that one is skipped and the rest of
+ * the range is read with the next call. Returns -1 if the syscall is not
+ * usable at all, the unreadable bytes are filled with fill */
+static int process_vm_read_at(int pid, ut8 *buf, int sz, ut64 addr, int fill) {
+	struct iovec local, remote[PROCESS_VM_IOV];
+	int done = 0;
+	while (done < sz) {
+		ut64 at = addr + done;
+		ssize_t r;
+		int n, i, left = sz - done;
+		for (i = 0; i < PROCESS_VM_IOV && left > 0; i++) {
+			int chunk = PROCESS_VM_PAGE - (at % PROCESS_VM_PAGE);
+			chunk = R_MIN (chunk, left);
+			remote[i].iov_base = (void *)(size_t)at;
+			remote[i].iov_len = chunk;
+			at += chunk;
+			left -= chunk;
+		}
+		local.iov_base = buf + done;
+		local.iov_len = at - (addr + done);
+		r = process_vm_readv (pid, &local, 1, remote, i, 0);
+		if (r < 0) {
+			if (errno == ENOSYS || errno == EPERM || errno == ESRCH) {
+				if (done) {
+					memset (buf + done, fill, sz - done);
+				}
+				return done? done: -1;
+			}
+			r = 0;
+		}
+		n = (int)r;
+		if ((size_t)r < local.iov_len) {
+			/* skip the page that failed */
+			ut64 bad = addr + done + n;
+			int skip = PROCESS_VM_PAGE - (bad % PROCESS_VM_PAGE);
+			skip = R_MIN (skip, sz - done - n);
+			memset (buf + done + n, fill, skip);
+			n += skip;
+		}
+		done += n;
+	}
+	return sz;
+}
+
+static int process_vm_write_at(int pid, const ut8 *buf, int sz, ut64 addr) {
+	struct iovec local, remote;
+	local.iov_base = (void *)buf;
+	local.iov_len = sz;
+	remote.iov_base = (void *)(size_t)addr;
+	remote.iov_len = sz;
+	return process_vm_writev (pid, &local, 1, &remote, 1, 0);
+}
+#endif
+
 static int __read(RIO *io, RIODesc *desc, ut8 *buf, int len) {
 #if USE_PROC_PID_MEM
 	int ret, fd;
@@ -77,7 +150,15 @@ static int __read(RIO *io, RIODesc *desc, ut8 *buf, int len) {
 	ut64 addr = io->off;
 	if (!desc || !desc->data)
 		return -1;
-	memset (buf, '\xff', len); // TODO: only memset the non-readed bytes
+#if USE_PROCESS_VM
+	if (len > 0 && addr != UT64_MAX) {
+		int ret = process_vm_read_at (RIOPTRACE_PID (desc), buf, len, addr, io->Oxff);
+		if (ret != -1) {
+			return ret;
+		}
+	}
+#endif
+	memset (buf, io->Oxff, len); // TODO: only memset the non-readed bytes
 	/* reopen procpidmem if necessary */
 #if USE_PROC_PID_MEM
 	fd = RIOPTRACE_FD (desc);
@@ -130,6 +211,12 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int len) {
 	if (!fd || !fd->data) {
 		return -1;
 	}
+#if USE_PROCESS_VM
+	/* read-only pages like .text can only be patched with ptrace */
+	if (len > 0 && process_vm_write_at (RIOPTRACE_PID (fd), buf, len, io->off) == len) {
+		return len;
+	}
+#endif
 	return ptrace_write_at (RIOPTRACE_PID (fd), buf, len, io->off);
 }
 
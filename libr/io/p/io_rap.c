@@ -10,6 +10,174 @@
 #define RIORAP_FD(x) ((x->data)?(((RIORap*)(x->data))->client):NULL)
 #define RIORAP_IS_LISTEN(x) (((RIORap*)(x->data))->listener)
 #define RIORAP_IS_VALID(x) ((x) && (x->data) && (x->plugin == &r_io_plugin_rap))
+/* pages asked past a sequential read, they travel in the same round trip */
+#define RAP_READAHEAD 8
+#define RAP_READAT_SIZE 13
+
+static void rap_cache_reset(RIORap *rap) {
+	if (rap && rap->cache_addr) {
+		memset (rap->cache_addr, 0xff, RMT_CACHE * sizeof (ut64));
+	}
+}
+
+/* ask for the rap v2 capabilities, caps stays 0 with old servers */
+static void rap_hello(RIORap *rap) {
+	RSocket *s = rap->client;
+	ut8 tmp[10];
+	ut64 reply;
+	tmp[0] = RMT_SEEK;
+	tmp[1] = RMT_HELLO;
+	r_write_be64 (tmp + 2, RMT_MAGIC | RMT_CAP_READAT | RMT_CAP_LZ4);
+	r_socket_write (s, tmp, 10);
+	r_socket_flush (s);
+	if (r_socket_read_block (s, tmp, 9) != 9 || tmp[0] != (RMT_SEEK | RMT_REPLY)) {
+		eprintf ("rap: Unexpected hello reply\n");
+		return;
+	}
+	reply = r_read_at_be64 (tmp, 1);
+	if ((reply & ~(ut64)UT32_MAX) != RMT_MAGIC || !(reply & RMT_CAP_READAT)) {
+		return;
+	}
+	rap->cache = malloc (RMT_CACHE * RMT_PAGE);
+	rap->cache_addr = malloc (RMT_CACHE * sizeof (ut64));
+	if (!rap->cache || !rap->cache_addr) {
+		R_FREE (rap->cache);
+		R_FREE (rap->cache_addr);
+		return;
+	}
+	rap_cache_reset (rap);
+	rap->caps = (ut32)reply;
+	rap->next = UT64_MAX;
+}
+
+static void rap_copy(ut8 *buf, ut64 addr, ut64 end, const ut8 *page, ut64 at) {
+	ut64 from = R_MAX (addr, at);
+	ut64 to = R_MIN (end, at + RMT_PAGE);
+	if (from < to) {
+		memcpy (buf + (from - addr), page + (from - at), to - from);
+	}
+}
+
+/* read one page reply into its cache slot */
+static bool rap_recv_page(RIORap *rap, ut64 page, ut8 *zbuf) {
+	RSocket *s = rap->client;
+	ut8 *dst = rap->cache + ((page / RMT_PAGE) % RMT_CACHE) * RMT_PAGE;
+	ut8 tmp[9];
+	ut32 len, clen;
+	if (r_socket_read_block (s, tmp, 9) != 9 || tmp[0] != (RMT_READAT | RMT_REPLY)) {
+		eprintf ("rap__read: Unexpected rap readat reply\n");
+		return false;
+	}
+	len = r_read_at_be32 (tmp, 1);
+	clen = r_read_at_be32 (tmp, 5);
+	if (len != RMT_PAGE || clen > len) {
+		eprintf ("rap__read: Unexpected data size %d\n", len);
+		return false;
+	}
+	if (clen == len) {
+		if (r_socket_read_block (s, dst, len) != len) {
+			return false;
+		}
+	} else if (r_socket_read_block (s, zbuf, clen) != clen
+			|| r_lz4_decompress (zbuf, clen, dst, len) != len) {
+		eprintf ("rap__read: Invalid compressed page\n");
+		return false;
+	}
+	rap->cache_addr[(page / RMT_PAGE) % RMT_CACHE] = page;
+	return true;
+}
+
+/* rap v2 read: the pages missing in the cache are asked at once, and the
+ * replies are read back in order, so the whole read costs a round trip */
+static int rap_read_pages(RIORap *rap, ut8 *buf, int count) {
+	ut64 addr = rap->offset, end = addr + count;
+	ut64 first = addr - (addr % RMT_PAGE);
+	ut64 last = end + ((RMT_PAGE - (end % RMT_PAGE)) % RMT_PAGE);
+	ut64 page, *pages;
+	ut8 *req, zbuf[RMT_PAGE];
+	int i, n, queued = 0, ret = count;
+	if (end < addr || last < end) {
+		return -1;
+	}
+	if (addr == rap->next && last + RAP_READAHEAD * RMT_PAGE > last) {
+		last += RAP_READAHEAD * RMT_PAGE;
+	}
+	n = (last - first) / RMT_PAGE;
+	pages = malloc (n * sizeof (ut64));
+	req = malloc (n * RAP_READAT_SIZE);
+	if (!pages || !req) {
+		free (pages);
+		free (req);
+		return -1;
+	}
+	for (page = first; page != last; page += RMT_PAGE) {
+		int slot = (page / RMT_PAGE) % RMT_CACHE;
+		if (rap->cache_addr[slot] == page) {
+			rap_copy (buf, addr, end, rap->cache + slot * RMT_PAGE, page);
+			continue;
+		}
+		ut8 *r = req + queued * RAP_READAT_SIZE;
+		r[0] = RMT_READAT;
+		r_write_be64 (r + 1, page);
+		r_write_be32 (r + 9, RMT_PAGE);
+		pages[queued++] = page;
+	}
+	if (queued) {
+		n = queued * RAP_READAT_SIZE;
+		if (r_socket_write (rap->client, req, n) != n) {
+			ret = -1;
+			queued = 0;
+		}
+		r_socket_flush (rap->client);
+	}
+	for (i = 0; i < queued; i++) {
+		if (!rap_recv_page (rap, pages[i], zbuf)) {
+			/* the stream lost its framing, nothing else can be trusted */
+			rap_cache_reset (rap);
+			ret = -1;
+			break;
+		}
+		rap_copy (buf, addr, end, rap->cache + ((pages[i] / RMT_PAGE) % RMT_CACHE) * RMT_PAGE, pages[i]);
+	}
+	free (pages);
+	free (req);
+	if (ret > 0) {
+		rap->offset = rap->next = end;
+	}
+	return ret;
+}
+
+/* rap v2 write: the seek goes in front since the server keeps none */
+static int rap_write_at(RIORap *rap, const ut8 *buf, int count) {
+	RSocket *s = rap->client;
+	ut8 *tmp, rep[9];
+	int ret;
+	if (!(tmp = malloc (count + 15))) {
+		return -1;
+	}
+	rap_cache_reset (rap);
+	tmp[0] = RMT_SEEK;
+	tmp[1] = R_IO_SEEK_SET;
+	r_write_be64 (tmp + 2, rap->offset);
+	tmp[10] = RMT_WRITE;
+	r_write_be32 (tmp + 11, count);
+	memcpy (tmp + 15, buf, count);
+	ret = r_socket_write (s, tmp, count + 15);
+	r_socket_flush (s);
+	free (tmp);
+	if (ret != count + 15 || r_socket_read_block (s, rep, 9) != 9
+			|| rep[0] != (RMT_SEEK | RMT_REPLY)
+			|| r_socket_read_block (s, rep, 5) != 5
+			|| rep[0] != (RMT_WRITE | RMT_REPLY)) {
+		eprintf ("rap__write: error\n");
+		return -1;
+	}
+	ret = r_read_at_be32 (rep, 1);
+	if (ret > 0) {
+		rap->offset += ret;
+	}
+	return ret? ret: -1;
+}
 
 static int rap__write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 	RSocket *s = RIORAP_FD (fd);
@@ -23,6 +191,9 @@ static int rap__write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 	if (count > RMT_MAX) {
 		count = RMT_MAX;
 	}
+	if (((RIORap *)fd->data)->caps) {
+		return rap_write_at (fd->data, buf, count);
+	}
 	if (!(tmp = (ut8 *)malloc (count + 5))) {
 		eprintf ("rap__write: malloc failed\n");
 		return -1;
@@ -60,6 +231,12 @@ static int rap__read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
 	int ret, i = (int)count;
 	ut8 tmp[5];
 
+	if (count < 1) {
+		return count;
+	}
+	if (((RIORap *)fd->data)->caps) {
+		return rap_read_pages (fd->data, buf, count);
+	}
 	// XXX. if count is > RMT_MAX, just perform multiple queries
 	if (count > RMT_MAX) {
 		count = RMT_MAX;
@@ -94,6 +271,8 @@ static int rap__close(RIODesc *fd) {
 			ret = r_socket_close (r->fd);
 			ret = r_socket_close (r->client);
 			//ret = r_socket_close (r->client);
+			free (r->cache);
+			free (r->cache_addr);
 			free (fd->data);
 			fd->data = NULL;
 		}
@@ -103,8 +282,14 @@ static int rap__close(RIODesc *fd) {
 
 static ut64 rap__lseek(RIO *io, RIODesc *fd, ut64 offset, int whence) {
 	RSocket *s = RIORAP_FD (fd);
+	RIORap *rap = fd->data;
 	ut8 tmp[10];
 	int ret;
+	/* only the end is unknown here */
+	if (rap->caps && whence != R_IO_SEEK_END) {
+		rap->offset = (whence == R_IO_SEEK_SET)? offset: rap->offset + offset;
+		return rap->offset;
+	}
 	// query
 	tmp[0] = RMT_SEEK;
 	tmp[1] = (ut8)whence;
@@ -121,6 +306,9 @@ static ut64 rap__lseek(RIO *io, RIODesc *fd, ut64 offset, int whence) {
 		return -1;
 	}
 	offset = r_read_at_be64 (tmp, 1);
+	if (rap->caps) {
+		rap->offset = offset;
+	}
 	return offset;
 }
 
@@ -227,6 +415,7 @@ static RIODesc *rap__open(RIO *io, const char *pathname, int rw, int mode) {
 		if (i > 0) {
 			eprintf ("ok\n");
 		}
+		rap_hello (rior);
 #if 0
 		/* Read meta info */
 		r_socket_read (rap_fd, (ut8 *)&buf, 4);
@@ -263,6 +452,8 @@ static int rap__system(RIO *io, RIODesc *fd, const char *command) {
 	char *ptr, *res, *str;
 	ut8 buf[RMT_MAX];
 
+	/* the command may write anything */
+	rap_cache_reset (fd->data);
 	buf[0] = RMT_CMD;
 	i = strlen (command) + 1;
 	if (i > RMT_MAX - 5) {
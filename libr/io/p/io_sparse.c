@@ -43,7 +43,7 @@ static int __close(RIODesc *fd) {
 	if (!fd || !fd->data)
 		return -1;
 	riom = fd->data;
-	free (riom->buf);
+	r_buf_free (riom->buf);
 	riom->buf = NULL;
 	free (fd->data);
 	fd->data = NULL;
@@ -62,6 +62,13 @@ static ut64 __lseek(RIO* io, RIODesc *fd, ut64 offset, int whence) {
 	return r_offset;
 }
 
+static bool __resize(RIO *io, RIODesc *fd, ut64 count) {
+	if (!fd || !fd->data) {
+		return false;
+	}
+	return r_buf_resize (RIOSPARSE_BUF (fd), count);
+}
+
 static bool __plugin_open(struct r_io_t *io, const char *pathname, bool many) {
 	return (!strncmp (pathname, "sparse://", 9));
 }
@@ -107,7 +114,7 @@ RIOPlugin r_io_plugin_sparse = {
 	.check = __plugin_open,
 	.lseek = __lseek,
 	.write = __write,
-	.resize = NULL,
+	.resize = __resize,
 };
 
 #ifndef CORELIB
@@ -2,6 +2,8 @@
 
 #include <r_io.h>
 
+static void wundo_free(RIOUndoWrite *u);
+
 #if 0
 * TODO:
 * - make path of indirections shortr (io->undo.foo is slow) */
@@ -16,8 +18,8 @@ R_API int r_io_undo_init(RIO *io) {
 	/* write undo */
 	io->undo.w_init = 0;
 	io->undo.w_enable = 0;
-	io->undo.w_enable = 0;
-	io->undo.w_list = r_list_new ();
+	io->undo.w_list = r_list_newf ((RListFree)wundo_free);
+	io->undo.w_tree = NULL;
 
 	return true;
 }
@@ -187,34 +189,218 @@ R_API RList *r_io_sundo_list(RIO *io, int mode) {
 
 /* undo writez */
 
+/* the write journal keeps only the bytes each write changed, skips writes
+ * that change nothing and run-length encodes the old data and the xor delta
+ * of the entries older than the last R_IO_WUNDO_HOT ones. Entries are also
+ * indexed by address in an interval tree to rebuild past contents */
+
+#define R_IO_WUNDO_HOT 64
+#define WUNDO_CONTAINER(x) container_of ((RBNode *)x, RIOUndoWrite, rb)
+
+static void wundo_free(RIOUndoWrite *u) {
+	if (u) {
+		free (u->o);
+		free (u->n);
+		free (u->packed);
+		free (u);
+	}
+}
+
+/* packbits: n < 128 is followed by n + 1 literals, else the next byte
+ * repeats n - 126 times. Returns -1 if the output would exceed max */
+static int rle_pack(const ut8 *in, int len, ut8 *out, int max) {
+	int i = 0, o = 0;
+	while (i < len) {
+		int run = 1;
+		while (i + run < len && run < 129 && in[i + run] == in[i]) {
+			run++;
+		}
+		if (run > 1) {
+			if (o + 2 > max) {
+				return -1;
+			}
+			out[o++] = run + 126;
+			out[o++] = in[i];
+			i += run;
+		} else {
+			int lit = 1;
+			while (i + lit < len && lit < 128
+					&& (i + lit + 1 >= len || in[i + lit] != in[i + lit + 1])) {
+				lit++;
+			}
+			if (o + lit + 1 > max) {
+				return -1;
+			}
+			out[o++] = lit - 1;
+			memcpy (out + o, in + i, lit);
+			o += lit;
+			i += lit;
+		}
+	}
+	return o;
+}
+
+static bool rle_unpack(const ut8 *in, int inlen, ut8 *out, int outlen) {
+	int i = 0, o = 0;
+	while (i < inlen) {
+		int n = in[i++];
+		if (n < 128) {
+			n++;
+			if (i + n > inlen || o + n > outlen) {
+				return false;
+			}
+			memcpy (out + o, in + i, n);
+			i += n;
+		} else {
+			n -= 126;
+			if (i >= inlen || o + n > outlen) {
+				return false;
+			}
+			memset (out + o, in[i++], n);
+		}
+		o += n;
+	}
+	return o == outlen;
+}
+
+static void wundo_pack(RIOUndoWrite *u) {
+	int i, len;
+	ut8 *raw, *out;
+	if (u->packed || !u->o || !u->n) {
+		return;
+	}
+	raw = malloc (u->len * 2);
+	out = malloc (u->len * 2);
+	if (raw && out) {
+		memcpy (raw, u->o, u->len);
+		for (i = 0; i < u->len; i++) {
+			raw[u->len + i] = u->o[i] ^ u->n[i];
+		}
+		len = rle_pack (raw, u->len * 2, out, u->len * 2 - 1);
+		if (len > 0) {
+			ut8 *shrunk = realloc (out, len);
+			u->packed = shrunk? shrunk: out;
+			u->packed_len = len;
+			out = NULL;
+			R_FREE (u->o);
+			R_FREE (u->n);
+		}
+	}
+	free (raw);
+	free (out);
+}
+
+/* returns the old and new data of the entry, the caller frees *o */
+static bool wundo_data(RIOUndoWrite *u, ut8 **o, ut8 **n) {
+	ut8 *raw;
+	int i;
+	if (!u->packed) {
+		*o = u->o;
+		*n = u->n;
+		return false;
+	}
+	raw = malloc (u->len * 2);
+	if (!raw || !rle_unpack (u->packed, u->packed_len, raw, u->len * 2)) {
+		free (raw);
+		*o = *n = NULL;
+		return false;
+	}
+	for (i = 0; i < u->len; i++) {
+		raw[u->len + i] ^= raw[i];
+	}
+	*o = raw;
+	*n = raw + u->len;
+	return true;
+}
+
+static int wundo_cmp(const void *incoming, const RBNode *in_tree) {
+	const RIOUndoWrite *a = incoming;
+	const RIOUndoWrite *b = WUNDO_CONTAINER (in_tree);
+	if (a->off != b->off) {
+		return a->off < b->off? -1: 1;
+	}
+	return (a->idx < b->idx)? -1: (a->idx > b->idx)? 1: 0;
+}
+
+static void wundo_calc_max_end(RBNode *node) {
+	RIOUndoWrite *u = WUNDO_CONTAINER (node);
+	int i;
+	u->max_end = u->off + u->len;
+	for (i = 0; i < 2; i++) {
+		if (node->child[i]) {
+			RIOUndoWrite *child = WUNDO_CONTAINER (node->child[i]);
+			if (child->max_end > u->max_end) {
+				u->max_end = child->max_end;
+			}
+		}
+	}
+}
+
 R_API void r_io_wundo_new(RIO *io, ut64 off, const ut8 *data, int len) {
 	RIOUndoWrite *uw;
-	if (!io->undo.w_enable)
+	ut8 *o;
+	int from, to;
+	if (!io->undo.w_enable || !data || len < 1) {
 		return;
-	/* undo write changes */
+	}
+	o = malloc (len);
+	if (!o) {
+		return;
+	}
+	r_io_read_at (io, off, o, len);
+	/* keep only the changed range */
+	for (from = 0; from < len && o[from] == data[from]; from++) {
+		;
+	}
+	if (from == len) {
+		free (o);
+		return;
+	}
+	for (to = len; to > from && o[to - 1] == data[to - 1]; to--) {
+		;
+	}
 	uw = R_NEW0 (RIOUndoWrite);
-	if (!uw) return;
+	if (!uw) {
+		free (o);
+		return;
+	}
 	uw->set = true;
-	uw->off = off;
-	uw->len = len;
-	uw->n = (ut8*) malloc (len);
-	if (!uw->n) {
-		R_FREE (uw);
+	uw->off = off + from;
+	uw->len = to - from;
+	uw->o = malloc (uw->len);
+	uw->n = malloc (uw->len);
+	if (!uw->o || !uw->n) {
+		wundo_free (uw);
+		free (o);
 		return;
 	}
-	memcpy(uw->n, data, len);
-	uw->o = (ut8*) malloc (len);
-	if (!uw->o) {
-		R_FREE (uw);
+	memcpy (uw->o, o + from, uw->len);
+	memcpy (uw->n, data + from, uw->len);
+	free (o);
+	uw->idx = r_list_length (io->undo.w_list);
+	if (!r_list_append (io->undo.w_list, uw)) {
+		wundo_free (uw);
 		return;
 	}
-	r_io_read_at(io, off, uw->o, len);
-	r_list_append (io->undo.w_list, uw);
+	r_rbtree_aug_insert (&io->undo.w_tree, uw, &uw->rb, wundo_cmp, wundo_calc_max_end);
+	if (io->undo.w_list->length > R_IO_WUNDO_HOT) {
+		RListIter *iter = io->undo.w_list->tail;
+		int i;
+		for (i = 0; i < R_IO_WUNDO_HOT && iter; i++) {
+			iter = iter->p;
+		}
+		if (iter) {
+			wundo_pack (iter->data);
+		}
+	}
+	io->undo.w_init = true;
 }
 
 R_API void r_io_wundo_clear(RIO *io) {
-	// XXX memory leak
-	io->undo.w_list = r_list_new ();
+	r_list_free (io->undo.w_list);
+	io->undo.w_list = r_list_newf ((RListFree)wundo_free);
+	io->undo.w_tree = NULL;
+	io->undo.w_init = false;
 }
 
 // rename to r_io_undo_length ?
@@ -231,29 +417,98 @@ R_API void r_io_wundo_list(RIO *io) {
 
 	if (io->undo.w_init)
 	r_list_foreach (io->undo.w_list, iter, u) {
+		ut8 *o, *n;
+		bool owned = wundo_data (u, &o, &n);
+		if (!o) {
+			continue;
+		}
 		io->cb_printf ("%02d %c %d %08"PFMT64x": ", i, u->set?'+':'-', u->len, u->off);
 		len = (u->len>BW)?BW:u->len;
-		for (j=0;j<len;j++) io->cb_printf ("%02x ", u->o[j]);
+		for (j=0;j<len;j++) io->cb_printf ("%02x ", o[j]);
 		if (len == BW) io->cb_printf (".. ");
 		io->cb_printf ("=> ");
-		for (j=0;j<len;j++) io->cb_printf ("%02x ", u->n[j]);
+		for (j=0;j<len;j++) io->cb_printf ("%02x ", n[j]);
 		if (len == BW) io->cb_printf (".. ");
 		io->cb_printf ("\n");
+		if (owned) {
+			free (o);
+		}
 		i++;
 	}
 }
 
+static void wundo_collect(RBNode *node, ut64 from, ut64 to, int idx, RList *list) {
+	while (node) {
+		RIOUndoWrite *u = WUNDO_CONTAINER (node);
+		if (u->max_end <= from) {
+			return;
+		}
+		wundo_collect (node->child[0], from, to, idx, list);
+		if (u->off >= to) {
+			return;
+		}
+		if (u->off + u->len > from && u->idx >= idx && u->set) {
+			r_list_append (list, u);
+		}
+		node = node->child[1];
+	}
+}
+
+static int wundo_cmp_idx_desc(const void *a, const void *b) {
+	return ((const RIOUndoWrite *)b)->idx - ((const RIOUndoWrite *)a)->idx;
+}
+
+/* read the contents as they were before the write number idx, by undoing
+ * on top of the current contents the later writes overlapping the range */
+R_API bool r_io_wundo_read_at(RIO *io, int idx, ut64 addr, ut8 *buf, int len) {
+	RListIter *iter;
+	RIOUndoWrite *u;
+	RList *list;
+	ut64 end;
+	if (!io || !buf || len < 1 || !r_io_read_at (io, addr, buf, len)) {
+		return false;
+	}
+	end = (addr + len < addr)? UT64_MAX: addr + len;
+	if (!(list = r_list_new ())) {
+		return false;
+	}
+	wundo_collect (io->undo.w_tree, addr, end, idx, list);
+	r_list_sort (list, wundo_cmp_idx_desc);
+	r_list_foreach (list, iter, u) {
+		ut64 from = R_MAX (u->off, addr);
+		ut64 to = R_MIN (u->off + u->len, end);
+		ut8 *o, *n;
+		bool owned = wundo_data (u, &o, &n);
+		if (o) {
+			memcpy (buf + (from - addr), o + (from - u->off), to - from);
+		}
+		if (owned) {
+			free (o);
+		}
+	}
+	r_list_free (list);
+	return true;
+}
+
 R_API int r_io_wundo_apply(RIO *io, struct r_io_undo_w_t *u, int set) {
 	int orig = io->undo.w_enable;
+	ut8 *o, *n;
+	bool owned = wundo_data (u, &o, &n);
+	if (!o) {
+		return 0;
+	}
 	io->undo.w_enable = 0;
 	if (set) {
-		r_io_write_at (io, u->off, u->n, u->len);
+		r_io_write_at (io, u->off, n, u->len);
 		u->set = true;
 	} else {
-		r_io_write_at (io, u->off, u->o, u->len);
+		r_io_write_at (io, u->off, o, u->len);
 		u->set = false;
 	}
 	io->undo.w_enable = orig;
+	if (owned) {
+		free (o);
+	}
 	return 0;
 }
 
@@ -261,9 +516,17 @@ R_API void r_io_wundo_apply_all(RIO *io, int set) {
 	RListIter *iter;
 	RIOUndoWrite *u;
 
+	/* undo newest first, redo oldest first */
+	if (set) {
+		r_list_foreach (io->undo.w_list, iter, u) {
+			r_io_wundo_apply (io, u, set);
+			eprintf ("redo 0x%08"PFMT64x"\n", u->off);
+		}
+		return;
+	}
 	r_list_foreach_prev (io->undo.w_list, iter, u) {
 		r_io_wundo_apply (io, u, set); //UNDO_WRITE_UNSET);
-		eprintf ("%s 0x%08"PFMT64x"\n", set?"redo":"undo", u->off);
+		eprintf ("undo 0x%08"PFMT64x"\n", u->off);
 	}
 }
 
@@ -101,6 +101,108 @@ static void env(const char *s, int f) {
 //	eprintf ("%s %s\n", s, a);
 	free (a);
 }
+
+typedef struct {
+	ut8 *data;
+	int len;
+	int size;
+} PipeOut;
+
+static bool pipe_out_append(PipeOut *o, const void *data, int len) {
+	if (o->len + len > o->size) {
+		int size = R_MAX (o->size * 2, o->len + len);
+		ut8 *d = realloc (o->data, size);
+		if (!d) {
+			return false;
+		}
+		o->data = d;
+		o->size = size;
+	}
+	memcpy (o->data + o->len, data, len);
+	o->len += len;
+	return true;
+}
+
+/* serve framed requests (see r2p_send) until the client goes away. The
+ * replies to all the frames found in one read go back in a single write.
+ * Commands run one after the other, RCore is not reentrant, but each reply
+ * carries the id of its request so clients already take them in any order */
+static void lang_pipe_framed(RLang *lang, int fdin, int fdout, const char *pre, int prelen) {
+	int len = prelen, size = R_MAX (prelen, 4096);
+	ut8 *buf = malloc (size);
+	PipeOut out = {0};
+	if (!buf) {
+		return;
+	}
+	memcpy (buf, pre, prelen);
+	for (;;) {
+		int off = 0, n;
+		ut32 id, cmdlen;
+		while (len - off >= R2P_FRAME_SIZE) {
+			ut8 hdr[R2P_FRAME_SIZE];
+			char *cmd, *res;
+			if (!r2p_frame_unpack (buf + off, &id, &cmdlen)) {
+				eprintf ("r_lang_pipe: invalid frame\n");
+				goto beach;
+			}
+			if (len - off - R2P_FRAME_SIZE < cmdlen) {
+				break;
+			}
+			cmd = r_str_ndup ((const char *)buf + off + R2P_FRAME_SIZE, cmdlen);
+			off += R2P_FRAME_SIZE + cmdlen;
+			/* id 0 is the hello of r2p_send, it gets an empty reply */
+			res = (cmd && id)? lang->cmd_str ((RCore*)lang->user, cmd): NULL;
+			n = res? strlen (res): 0;
+			r2p_frame_pack (hdr, id, n);
+			if (!pipe_out_append (&out, hdr, sizeof (hdr))
+					|| (n && !pipe_out_append (&out, res, n))) {
+				free (res);
+				free (cmd);
+				goto beach;
+			}
+			free (res);
+			free (cmd);
+		}
+		if (out.len > 0) {
+			int w, done = 0;
+			while (done < out.len && (w = write (fdout, out.data + done, out.len - done)) > 0) {
+				done += w;
+			}
+			if (done < out.len) {
+				break;
+			}
+			out.len = 0;
+		}
+		memmove (buf, buf + off, len - off);
+		len -= off;
+		if (len >= R2P_FRAME_SIZE) {
+			/* make room for the rest of a big request */
+			r2p_frame_unpack (buf, &id, &cmdlen);
+			if (cmdlen >= INT_MAX - R2P_FRAME_SIZE) {
+				break;
+			}
+			if (R2P_FRAME_SIZE + cmdlen > size) {
+				ut8 *nbuf = realloc (buf, R2P_FRAME_SIZE + cmdlen);
+				if (!nbuf) {
+					break;
+				}
+				buf = nbuf;
+				size = R2P_FRAME_SIZE + cmdlen;
+			}
+		}
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+		n = read (fdin, buf + len, size - len);
+		if (n < 1) {
+			break;
+		}
+		len += n;
+	}
+beach:
+	free (buf);
+	free (out.data);
+}
 #endif
 
 static int lang_pipe_run(RLang *lang, const char *code, int len) {
@@ -145,6 +247,10 @@ static int lang_pipe_run(RLang *lang, const char *code, int len) {
 			if (ret < 1 || !buf[0]) {
 				break;
 			}
+			if ((ut8)buf[0] == (R2P_FRAME_MAGIC & 0xff)) {
+				lang_pipe_framed (lang, output[0], input[1], buf, ret);
+				break;
+			}
 			buf[sizeof (buf) - 1] = 0;
 			res = lang->cmd_str ((RCore*)lang->user, buf);
 			//eprintf ("%d %s\n", ret, buf);
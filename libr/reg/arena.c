@@ -2,6 +2,37 @@
 
 #include <r_reg.h>
 
+/* push and pop are used by the emulation to save and restore the register
+ * state around every step, so popped arenas are cached per regset instead of
+ * being freed, and every arena records the span of bytes written since it was
+ * pushed: r_reg_arena_restore only copies that span back from the saved one */
+
+static void arena_dirty_all(RRegArena *arena) {
+	if (arena) {
+		arena->dirty_from = 0;
+		arena->dirty_to = arena->size;
+	}
+}
+
+R_API void r_reg_arena_dirty(RRegArena *arena, int off, int len) {
+	int end;
+	if (!arena || len < 1) {
+		return;
+	}
+	end = R_MIN (off + len, arena->size);
+	off = R_MAX (off, 0);
+	if (off >= end) {
+		return;
+	}
+	if (arena->dirty_from >= arena->dirty_to) {
+		arena->dirty_from = off;
+		arena->dirty_to = end;
+		return;
+	}
+	arena->dirty_from = R_MIN (arena->dirty_from, off);
+	arena->dirty_to = R_MAX (arena->dirty_to, end);
+}
+
 /* non-endian safe - used for raw mapping with system registers */
 R_API ut8* r_reg_get_bytes(RReg* reg, int type, int* size) {
 	RRegArena* arena;
@@ -75,6 +106,7 @@ R_API bool r_reg_read_regs(RReg* reg, ut8* buf, const int len) {
 		memset (arena->bytes, 0, arena->size);
 		memcpy (arena->bytes, buf + off,
 			R_MIN (len - off, arena->size));
+		arena_dirty_all (arena);
 		off += arena->size;
 		if (off > len) {
 			return false;
@@ -121,6 +153,7 @@ R_API bool r_reg_set_bytes(RReg* reg, int type, const ut8* buf, const int len) {
 	if (arena->bytes) {
 		memset (arena->bytes, 0, arena->size);
 		memcpy (arena->bytes, buf, minsz);
+		arena_dirty_all (arena);
 		return true;
 	}
 	return false;
@@ -156,6 +189,7 @@ R_API int r_reg_fit_arena(RReg* reg) {
 				memset (arena->bytes, 0, arena->size);
 			}
 		}
+		arena_dirty_all (arena);
 	}
 	return true;
 }
@@ -183,6 +217,25 @@ R_API void r_reg_arena_free(RRegArena* ra) {
 	}
 }
 
+static RRegArena *arena_get(RRegSet *rs, int size) {
+	while (rs->ncache > 0) {
+		RRegArena *a = rs->cache[--rs->ncache];
+		if (a->size == size) {
+			return a;
+		}
+		r_reg_arena_free (a);
+	}
+	return r_reg_arena_new (size);
+}
+
+static void arena_put(RRegSet *rs, RRegArena *a) {
+	if (rs->ncache < R_REG_ARENA_CACHE) {
+		rs->cache[rs->ncache++] = a;
+	} else {
+		r_reg_arena_free (a);
+	}
+}
+
 R_API void r_reg_arena_swap(RReg* reg, int copy) {
 	/* XXX: swap current arena to head(previous arena) */
 	int i;
@@ -194,6 +247,8 @@ R_API void r_reg_arena_swap(RReg* reg, int copy) {
 			ia->data = ib->data;
 			ib->data = tmp;
 			reg->regset[i].arena = ia->data;
+			arena_dirty_all (ia->data);
+			arena_dirty_all (ib->data);
 		} else {
 			//eprintf ("Cannot pop more\n");
 			break;
@@ -209,7 +264,7 @@ R_API void r_reg_arena_pop(RReg* reg) {
 			continue;
 		}
 		a = r_list_pop (reg->regset[i].pool);
-		r_reg_arena_free (a);
+		arena_put (&reg->regset[i], a);
 		a = reg->regset[i].pool->tail->data;
 		if (a) {
 			reg->regset[i].arena = a;
@@ -225,14 +280,15 @@ R_API int r_reg_arena_push(RReg* reg) {
 		if (!a) {
 			continue;
 		}
-		RRegArena* b = r_reg_arena_new (a->size); // new arena
+		RRegArena* b = arena_get (&reg->regset[i], a->size); // new arena
 		if (!b) {
 			continue;
 		}
-		//b->size == a->size always because of how r_reg_arena_new behave
+		//b->size == a->size always because of how arena_get behaves
 		if (a->bytes) {
 			memcpy (b->bytes, a->bytes, b->size);
 		}
+		b->dirty_from = b->dirty_to = 0;
 		r_list_push (reg->regset[i].pool, b);
 		reg->regset[i].arena = b;
 		reg->regset[i].cur = reg->regset[i].pool->tail;
@@ -240,12 +296,48 @@ R_API int r_reg_arena_push(RReg* reg) {
 	return r_list_length (reg->regset[0].pool);
 }
 
+/* same as a pop followed by a push, but only the bytes written since the
+ * last push are copied back from the saved arena */
+R_API void r_reg_arena_restore(RReg* reg) {
+	int i;
+	for (i = 0; i < R_REG_TYPE_LAST; i++) {
+		RRegSet *rs = &reg->regset[i];
+		RListIter *it = rs->pool? rs->pool->tail: NULL;
+		RRegArena *a, *b;
+		if (!it || !it->p) {
+			continue;
+		}
+		a = it->p->data; // saved
+		b = it->data; // current
+		if (!a || !b || !a->bytes || !b->bytes) {
+			continue;
+		}
+		if (a->size != b->size) {
+			arena_put (rs, r_list_pop (rs->pool));
+			rs->arena = a;
+			rs->cur = rs->pool->tail;
+			if (!(b = arena_get (rs, a->size))) {
+				continue;
+			}
+			memcpy (b->bytes, a->bytes, b->size);
+			r_list_push (rs->pool, b);
+			rs->arena = b;
+			rs->cur = rs->pool->tail;
+		} else if (b->dirty_from < b->dirty_to) {
+			memcpy (b->bytes + b->dirty_from, a->bytes + b->dirty_from,
+				b->dirty_to - b->dirty_from);
+		}
+		b->dirty_from = b->dirty_to = 0;
+	}
+}
+
 R_API void r_reg_arena_zero(RReg* reg) {
 	int i;
 	for (i = 0; i < R_REG_TYPE_LAST; i++) {
 		RRegArena* a = reg->regset[i].arena;
 		if (a->size > 0) {
 			memset (reg->regset[i].arena->bytes, 0, a->size);
+			arena_dirty_all (a);
 		}
 	}
 }
@@ -269,6 +361,7 @@ R_API void r_reg_arena_poke(RReg* reg, const ut8* ret) {
 		return;
 	}
 	memcpy (regset->arena->bytes, ret, regset->arena->size);
+	arena_dirty_all (regset->arena);
 }
 
 R_API ut8* r_reg_arena_dup(RReg* reg, const ut8* source) {
@@ -327,6 +420,7 @@ R_API void r_reg_arena_shrink(RReg* reg) {
 			/* ha ha ha */
 			a->bytes = calloc (1024, 1);
 			a->size = 1024;
+			arena_dirty_all (a);
 			/* looks like sizing down the arena breaks the regsync */
 			/* and sizing it up fixes reallocation when fit() is called */
 		}
@@ -56,6 +56,8 @@ R_API bool r_reg_set_double(RReg *reg, RRegItem *item, double value) {
 		r_mem_copybits (reg->regset[item->arena].arena->bytes +
 					BITS2BYTES (item->offset),
 				src, item->size);
+		r_reg_arena_dirty (reg->regset[item->arena].arena,
+			BITS2BYTES (item->offset), BITS2BYTES (item->size));
 		return true;
 	}
 	eprintf ("r_reg_set_value: Cannot set %s to %lf\n", item->name, value);
@@ -111,6 +113,8 @@ R_API bool r_reg_set_longdouble(RReg *reg, RRegItem *item, long double value) {
 		r_mem_copybits (reg->regset[item->arena].arena->bytes +
 					BITS2BYTES (item->offset),
 				src, item->size);
+		r_reg_arena_dirty (reg->regset[item->arena].arena,
+			BITS2BYTES (item->offset), BITS2BYTES (item->size));
 		return true;
 	}
 
@@ -208,6 +208,9 @@ R_API void r_reg_free(RReg* reg) {
 	for (i = 0; i < R_REG_TYPE_LAST; i++) {
 		r_list_free (reg->regset[i].pool);
 		reg->regset[i].pool = NULL;
+		while (reg->regset[i].ncache > 0) {
+			r_reg_arena_free (reg->regset[i].cache[--reg->regset[i].ncache]);
+		}
 	}
 	r_list_free (reg->allregs);
 	r_reg_free_internal (reg, false);
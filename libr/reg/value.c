@@ -138,6 +138,8 @@ R_API bool r_reg_set_value(RReg *reg, RRegItem *item, ut64 value) {
 		eprintf ("r_reg_set_value: item is NULL\n");
 		return false;
 	}
+	r_reg_arena_dirty (reg->regset[item->arena].arena, item->offset / 8,
+		BITS2BYTES ((item->offset % 8) + item->size));
 	switch (item->size) {
 	case 80:
 	case 96: // long floating value
@@ -286,6 +288,7 @@ R_API int r_reg_set_pack(RReg *reg, RRegItem *item, int packidx, int packbits, u
 	if (reg->regset[item->arena].arena->size - BITS2BYTES (off) - BITS2BYTES (packbytes) >= 0) {
 		ut8 *dst = reg->regset[item->arena].arena->bytes + BITS2BYTES (off);
 		r_mem_copybits (dst, (ut8 *)&val, packbytes);
+		r_reg_arena_dirty (reg->regset[item->arena].arena, BITS2BYTES (off), BITS2BYTES (item->size));
 		return true;
 	}
 	eprintf ("r_reg_set_value: Cannot set %s to 0x%" PFMT64x "\n", item->name, val);
@@ -34,9 +34,9 @@ R_API RSearch *r_search_new(int mode) {
 	s->pattern_size = 0;
 	s->string_max = 255;
 	s->string_min = 3;
-	s->hits = r_list_newf (free);
+	/* the hits are owned by the pool */
+	s->hits = r_list_new ();
 	s->maxhits = 0;
-	// TODO: review those mempool sizes. ensure never gets NULL
 	s->pool = r_mem_pool_new (sizeof (RSearchHit), 1024, 10);
 	s->kws = r_list_newf (free);
 	if (!s->kws) {
@@ -51,8 +51,8 @@ R_API RSearch *r_search_free(RSearch *s) {
 	if (!s) {
 		return NULL;
 	}
-	r_mem_pool_free (s->pool);
 	r_list_free (s->hits);
+	r_mem_pool_free (s->pool);
 	r_list_free (s->kws);
 	//r_io_free(s->iob.io); this is suposed to be a weak reference
 	free (s);
@@ -545,5 +545,6 @@ R_API void r_search_reset(RSearch *s, int mode) {
 R_API void r_search_kw_reset(RSearch *s) {
 	r_list_purge (s->kws);
 	r_list_purge (s->hits);
+	r_mem_pool_reset (s->pool);
 	R_FREE (s->data);
 }
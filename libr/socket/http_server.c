@@ -1,6 +1,7 @@
-/* radare - LGPL - Copyright 2012-2016 - pancake */
+/* radare - LGPL - Copyright 2012-2018 - pancake */
 
 #include <r_socket.h>
+#include <r_util.h>
 
 static bool *breaked = NULL;
 
@@ -8,69 +9,239 @@ R_API void r_socket_http_server_set_breaked(bool *b) {
 	breaked = b;
 }
 
-R_API RSocketHTTPRequest *r_socket_http_accept (RSocket *s, int timeout) {
-	int content_length = 0, xx, yy;
-	int pxx = 1, first = 0;
-	char buf[1500], *p, *q;
+#define HTTP_LINE 1500
+#define HTTP_HEAD_MAX 0x10000
+#define HTTP_BODY_MAX 0x4000000
+#define HTTP_IDLE_MAX 64
+
+/* a client connection. The bytes read and not parsed yet stay in buf: a
+ * request still coming in, or the next ones when the client pipelines */
+typedef struct r_socket_http_conn_t {
+	RSocket *s;
+	char *buf;
+	int off;
+	int len;
+	int size;
+	ut64 last; // http_now of the last request
+} RSocketHTTPConn;
+
+/* microseconds, r_sys_now packs the seconds in the bits over 20 */
+static ut64 http_now(void) {
+	struct timeval now;
+	gettimeofday (&now, NULL);
+	return (ut64)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static RSocketHTTPConn *http_conn_new(RSocket *s, int timeout) {
+	RSocketHTTPConn *c = R_NEW0 (RSocketHTTPConn);
+	if (!c) {
+		r_socket_free (s);
+		return NULL;
+	}
+	c->s = s;
+	c->last = http_now ();
+	if (timeout > 0) {
+		r_socket_block_time (s, 1, timeout);
+	}
+	return c;
+}
+
+static void http_conn_free(RSocketHTTPConn *c) {
+	if (c) {
+		r_socket_free (c->s);
+		free (c->buf);
+		free (c);
+	}
+}
+
+/* append one read of the socket to the buffer, false at the end of the
+ * stream. It only waits when nothing is pending on the socket */
+static bool http_conn_fill(RSocketHTTPConn *c) {
+	int n;
+	if (c->off > 0) {
+		memmove (c->buf, c->buf + c->off, c->len - c->off);
+		c->len -= c->off;
+		c->off = 0;
+	}
+	if (c->size - c->len < 1024) {
+		int size = c->size + R_MAX (c->size, 4096);
+		char *buf = realloc (c->buf, size);
+		if (!buf) {
+			return false;
+		}
+		c->buf = buf;
+		c->size = size;
+	}
+	n = r_socket_read (c->s, (ut8 *)c->buf + c->len, c->size - c->len);
+	if (n < 1) {
+		return false;
+	}
+	c->len += n;
+	return true;
+}
+
+static int http_conn_read(RSocketHTTPConn *c, ut8 *buf, int len) {
+	int n = R_MIN (len, c->len - c->off);
+	if (n > 0) {
+		memcpy (buf, c->buf + c->off, n);
+		c->off += n;
+		return n;
+	}
+	if (!http_conn_fill (c)) {
+		return -1;
+	}
+	return http_conn_read (c, buf, len);
+}
+
+/* 1 if a whole request is in the buffer, 0 if it is still coming in, or
+ * -1 if its headers are too long to ever be. A body over HTTP_BODY_MAX is
+ * not waited for, http_conn_request refuses it after the headers */
+static int http_conn_complete(RSocketHTTPConn *c) {
+	const char *p = c->buf + c->off, *end = c->buf + c->len;
+	const char *line, *nl;
+	int content_length = 0;
+	while (p < end && (*p == '\r' || *p == '\n')) {
+		p++;
+	}
+	for (line = p; (nl = memchr (line, '\n', end - line)); line = nl + 1) {
+		if (line > p && (nl == line || (nl == line + 1 && *line == '\r'))) {
+			return content_length > HTTP_BODY_MAX || end - nl - 1 >= content_length;
+		}
+		if (nl - line > 16 && !strncmp (line, "Content-Length: ", 16)) {
+			content_length = R_MAX (atoi (line + 16), 0);
+		}
+	}
+	return (end - p > HTTP_HEAD_MAX)? -1: 0;
+}
+
+/* one line without its \r\n, or -1 at the end of the stream */
+static int http_conn_gets(RSocketHTTPConn *c, char *line, int size) {
+	int i = 0;
+	for (;;) {
+		ut8 ch;
+		if (http_conn_read (c, &ch, 1) != 1) {
+			return i > 0? i: -1;
+		}
+		if (ch == '\n') {
+			break;
+		}
+		if (i < size - 1) {
+			line[i++] = ch;
+		}
+	}
+	if (i > 0 && line[i - 1] == '\r') {
+		i--;
+	}
+	line[i] = 0;
+	return i;
+}
+
+static RSocketHTTPRequest *http_conn_request(RSocketHTTPConn *c) {
+	int content_length = 0, n;
+	char buf[HTTP_LINE], *p, *q;
 	RSocketHTTPRequest *hr = R_NEW0 (RSocketHTTPRequest);
-	if (!hr) return NULL;
-	hr->s = r_socket_accept (s);
-	if (!hr->s) {
+	if (!hr) {
+		return NULL;
+	}
+	hr->conn = c;
+	hr->s = c->s;
+	/* blank lines between pipelined requests are allowed */
+	while (!(n = http_conn_gets (c, buf, sizeof (buf)))) {
+		;
+	}
+	if (n < 3) {
 		free (hr);
 		return NULL;
 	}
-	if (timeout>0)
-		r_socket_block_time (hr->s, 1, timeout);
-	for (;;) {
+	p = strchr (buf, ' ');
+	if (p) {
+		*p = 0;
+	}
+	hr->method = strdup (buf);
+	if (p) {
+		q = strstr (p + 1, " HTTP");
+		if (q) {
+			*q = 0;
+			hr->version = !strncmp (q + 1, "HTTP/1.1", 8);
+			hr->keepalive = hr->version > 0;
+		}
+		hr->path = strdup (p + 1);
+	}
+	while ((n = http_conn_gets (c, buf, sizeof (buf))) > 0) {
 #if __WINDOWS__
-		if (breaked)
-			break;
-#endif
-		memset (buf, 0, sizeof (buf));
-		xx = r_socket_gets (hr->s, buf, sizeof (buf));
-		yy = r_socket_ready (hr->s, 0, 20 * 1000); //this function uses usecs as argument
-//		eprintf ("READ %d (%s) READY %d\n", xx, buf, yy);
-		if (!yy || (!xx && !pxx)) {
+		if (breaked && *breaked) {
 			break;
 		}
-		pxx = xx;
-
-		if (first==0) {
-			first = 1;
-			if (strlen (buf)<3) {
-				r_socket_http_close (hr);
-				return NULL;
-			}
-			p = strchr (buf, ' ');
-			if (p) *p = 0;
-			hr->method = strdup (buf);
-			if (p) {
-				q = strstr (p+1, " HTTP"); //strchr (p+1, ' ');
-				if (q) *q = 0;
-				hr->path = strdup (p+1);
+#endif
+		if (!hr->referer && !strncmp (buf, "Referer: ", 9)) {
+			hr->referer = strdup (buf + 9);
+		} else if (!hr->agent && !strncmp (buf, "User-Agent: ", 12)) {
+			hr->agent = strdup (buf + 12);
+		} else if (!hr->host && !strncmp (buf, "Host: ", 6)) {
+			hr->host = strdup (buf + 6);
+		} else if (!strncmp (buf, "Content-Length: ", 16)) {
+			content_length = atoi (buf + 16);
+		} else if (!strncasecmp (buf, "Connection: ", 12)) {
+			if (!strncasecmp (buf + 12, "close", 5)) {
+				hr->keepalive = false;
+			} else if (!strncasecmp (buf + 12, "keep-alive", 10)) {
+				hr->keepalive = true;
 			}
-		} else {
-			if (!hr->referer && !strncmp (buf, "Referer: ", 9)) {
-				hr->referer = strdup (buf + 9);
-			} else
-			if (!hr->agent && !strncmp (buf, "User-Agent: ", 12)) {
-				hr->agent = strdup (buf + 12);
-			} else
-			if (!hr->host && !strncmp (buf, "Host: ", 6)) {
-				hr->host = strdup (buf + 6);
-			} else
-			if (!strncmp (buf, "Content-Length: ", 16)) {
-				content_length = atoi (buf+16);
+		}
+	}
+	if (n < 0) {
+		/* the headers were cut, there is no request to answer */
+		hr->keepalive = false;
+	}
+	if (content_length > HTTP_BODY_MAX) {
+		/* the body is not read, so the connection can not be reused */
+		hr->keepalive = false;
+		r_socket_http_response (hr, 413, "Payload too large\n", 0, NULL);
+		/* the callers free the connection */
+		free (hr->path);
+		free (hr->host);
+		free (hr->agent);
+		free (hr->method);
+		free (hr->referer);
+		free (hr);
+		return NULL;
+	}
+	if (content_length > 0) {
+		int done = 0;
+		hr->data = malloc (content_length + 1);
+		if (!hr->data) {
+			hr->keepalive = false;
+			return hr;
+		}
+		while (done < content_length) {
+			n = http_conn_read (c, hr->data + done, content_length - done);
+			if (n < 1) {
+				hr->keepalive = false;
+				break;
 			}
+			done += n;
 		}
+		hr->data_length = done;
+		hr->data[done] = 0;
+	}
+	c->last = http_now ();
+	return hr;
+}
+
+R_API RSocketHTTPRequest *r_socket_http_accept (RSocket *s, int timeout) {
+	RSocketHTTPRequest *hr;
+	RSocketHTTPConn *c;
+	RSocket *cs = r_socket_accept (s);
+	if (!cs || !(c = http_conn_new (cs, timeout))) {
+		return NULL;
 	}
-	if (content_length>0) {
-		r_socket_read_block (hr->s, (ut8*)buf, 1); // one missing byte wtf
-		hr->data = malloc (content_length+1);
-		hr->data_length = content_length;
-		r_socket_read_block (hr->s, hr->data, hr->data_length);
-		hr->data[content_length] = 0;
+	hr = http_conn_request (c);
+	if (!hr) {
+		http_conn_free (c);
+		return NULL;
 	}
+	/* nobody keeps this connection around */
+	hr->keepalive = false;
 	return hr;
 }
 
@@ -80,13 +251,161 @@ R_API void r_socket_http_response (RSocketHTTPRequest *rs, int code, const char
 		code==301?"moved permanently":
 		code==302?"Found":
 		code==404?"not found":
+		code==413?"payload too large":
 		"UNKNOWN";
+	char *msg;
+	int hlen;
 	if (len<1) len = out? strlen (out): 0;
 	if (!headers) headers = "";
-	r_socket_printf (rs->s, "HTTP/1.0 %d %s\r\n%s"
-		"Connection: close\r\nContent-Length: %d\r\n\r\n",
-		code, strcode, headers, len);
-	if (out && len>0) r_socket_write (rs->s, (void*)out, len);
+	msg = r_str_newf ("HTTP/1.%d %d %s\r\n%s"
+		"Connection: %s\r\nContent-Length: %d\r\n\r\n",
+		rs->version, code, strcode, headers,
+		rs->keepalive? "keep-alive": "close", len);
+	if (!msg) {
+		return;
+	}
+	hlen = strlen (msg);
+	/* a single write, a second one waits for the delayed ack of the first */
+	if (out && len > 0) {
+		char *m = realloc (msg, hlen + len);
+		if (!m) {
+			free (msg);
+			return;
+		}
+		msg = m;
+		memcpy (msg + hlen, out, len);
+		hlen += len;
+	}
+	if (r_socket_write (rs->s, msg, hlen) != hlen) {
+		rs->keepalive = false;
+	}
+	free (msg);
+}
+
+/* keep-alive server: the listening socket and the client connections are
+ * polled together. A readable connection gets one read into its buffer,
+ * and a request is only parsed once it is all there, so a slow, partial or
+ * idle client does not block the rest */
+R_API RSocketHTTPServer *r_socket_http_server_new(RSocket *s, int timeout) {
+	RSocketHTTPServer *hs = R_NEW0 (RSocketHTTPServer);
+	if (!hs) {
+		return NULL;
+	}
+	hs->s = s;
+	hs->timeout = timeout;
+	hs->conns = r_list_newf ((RListFree)http_conn_free);
+	if (!hs->conns) {
+		free (hs);
+		return NULL;
+	}
+	return hs;
+}
+
+R_API void r_socket_http_server_free(RSocketHTTPServer *hs) {
+	if (hs) {
+		r_list_free (hs->conns);
+		free (hs);
+	}
+}
+
+#if __UNIX__ || defined(__CYGWIN__)
+/* take the first connection with a whole request buffered out of the list */
+static RSocketHTTPConn *http_server_next(RSocketHTTPServer *hs) {
+	RSocketHTTPConn *c;
+	RListIter *iter;
+	r_list_foreach (hs->conns, iter, c) {
+		if (c->off < c->len && http_conn_complete (c) > 0) {
+			r_list_split (hs->conns, c);
+			return c;
+		}
+	}
+	return NULL;
+}
+
+static RSocketHTTPConn *http_server_ready(RSocketHTTPServer *hs, int msecs) {
+	RSocketHTTPConn *c;
+	RListIter *iter, *tmp;
+	struct pollfd *fds;
+	int i, n;
+	/* pipelined requests are already in the buffer, poll does not see them */
+	if ((c = http_server_next (hs))) {
+		return c;
+	}
+	/* drop the idle ones before polling, a quiet server still closes them */
+	if (hs->timeout > 0) {
+		ut64 now = http_now ();
+		r_list_foreach_safe (hs->conns, iter, tmp, c) {
+			if (now > c->last && now - c->last > (ut64)hs->timeout * 1000000) {
+				r_list_delete (hs->conns, iter);
+			}
+		}
+	}
+	n = r_list_length (hs->conns);
+	if (!(fds = calloc (n + 1, sizeof (struct pollfd)))) {
+		return NULL;
+	}
+	fds[0].fd = hs->s->fd;
+	fds[0].events = POLLIN;
+	i = 1;
+	r_list_foreach (hs->conns, iter, c) {
+		fds[i].fd = c->s->fd;
+		fds[i].events = POLLIN;
+		i++;
+	}
+	if (poll (fds, n + 1, msecs) < 1) {
+		free (fds);
+		return NULL;
+	}
+	/* poll said these have data, so the reads return right away */
+	i = 1;
+	r_list_foreach_safe (hs->conns, iter, tmp, c) {
+		if (fds[i++].revents && (!http_conn_fill (c) || http_conn_complete (c) < 0)) {
+			r_list_delete (hs->conns, iter);
+		}
+	}
+	if (fds[0].revents) {
+		RSocket *cs = r_socket_accept (hs->s);
+		RSocketHTTPConn *nc = cs? http_conn_new (cs, hs->timeout): NULL;
+		if (nc) {
+			r_list_append (hs->conns, nc);
+		}
+	}
+	free (fds);
+	c = http_server_next (hs);
+	/* drop the oldest idle ones when there are too many */
+	while (r_list_length (hs->conns) > HTTP_IDLE_MAX) {
+		http_conn_free (r_list_pop_head (hs->conns));
+	}
+	return c;
+}
+#endif
+
+/* the next request of any client, or NULL if none came in a while */
+R_API RSocketHTTPRequest *r_socket_http_server_accept(RSocketHTTPServer *hs) {
+#if __UNIX__ || defined(__CYGWIN__)
+	RSocketHTTPRequest *hr;
+	RSocketHTTPConn *c = http_server_ready (hs, 500);
+	if (!c) {
+		return NULL;
+	}
+	hr = http_conn_request (c);
+	if (!hr) {
+		http_conn_free (c);
+	}
+	return hr;
+#else
+	return r_socket_http_accept (hs->s, hs->timeout);
+#endif
+}
+
+/* finish the request, keeping its connection for the next one if both
+ * sides want to */
+R_API void r_socket_http_server_close(RSocketHTTPServer *hs, RSocketHTTPRequest *rs) {
+	if (rs && rs->keepalive && rs->conn && r_list_append (hs->conns, rs->conn)) {
+		rs->conn = NULL;
+		rs->s = NULL;
+	}
+	r_socket_http_close (rs);
 }
 
 R_API ut8 *r_socket_http_handle_upload(const ut8 *str, int len, int *retlen) {
@@ -124,7 +443,14 @@ R_API ut8 *r_socket_http_handle_upload(const ut8 *str, int len, int *retlen) {
 
 /* close client socket and free struct */
 R_API void r_socket_http_close (RSocketHTTPRequest *rs) {
-	r_socket_free (rs->s);
+	if (!rs) {
+		return;
+	}
+	if (rs->conn) {
+		http_conn_free (rs->conn);
+	} else {
+		r_socket_free (rs->s);
+	}
 	free (rs->path);
 	free (rs->host);
 	free (rs->agent);
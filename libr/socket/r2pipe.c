@@ -1,8 +1,11 @@
-/* radare - LGPL - Copyright 2015-2016 - pancake */
+/* radare - LGPL - Copyright 2015-2018 - pancake */
 
 #include <r_util.h>
 #include <r_cons.h>
 #include <r_socket.h>
+#if !__WINDOWS__
+#include <limits.h>
+#endif
 
 #define R2P_MAGIC 0x329193
 #define R2P_PID(x) (((R2Pipe*)x->data)->pid)
@@ -43,6 +46,7 @@ R_API int r2p_close(R2Pipe *r2p) {
 		r2p->child = -1;
 	}
 #endif
+	free (r2p->reply);
 	free (r2p);
 	return 0;
 }
@@ -274,6 +278,192 @@ R_API char *r2p_read(R2Pipe *r2p) {
 	return buf;
 }
 
+/* framed mode: r2p_send queues a request and returns its id right away,
+ * so many can be in flight, and r2p_recv returns the next reply with the id
+ * of its request, which is not necessarily the oldest one. The server
+ * switches to framed mode on the first frame, do not mix it with r2p_cmd.
+ * Only the #!pipe server of r_lang takes frames, see r_socket.h.
+ * The server stops reading while its replies do not fit in the pipe, so
+ * r2p_send keeps reading them into r2p->reply while it writes, and any
+ * number of requests can be sent before the first r2p_recv. On Windows
+ * there is no such read ahead, keep the requests in flight below the pipe
+ * buffer size (4K) there */
+
+/* append what the pipe has to r2p->reply, waiting for something */
+static bool r2p_read_ahead(R2Pipe *r2p) {
+	int n;
+	if (r2p->reply_size - r2p->reply_len < 4096) {
+		int size = r2p->reply_size + R_MAX (r2p->reply_size, 4096);
+		ut8 *buf = realloc (r2p->reply, size);
+		if (!buf) {
+			return false;
+		}
+		r2p->reply = buf;
+		r2p->reply_size = size;
+	}
+#if __WINDOWS__ && !defined(__CYGWIN__)
+	DWORD dw = 0;
+	if (!ReadFile (r2p->pipe, r2p->reply + r2p->reply_len,
+			r2p->reply_size - r2p->reply_len, &dw, NULL) || !dw) {
+		return false;
+	}
+	n = dw;
+#else
+	n = read (r2p->output[0], r2p->reply + r2p->reply_len, r2p->reply_size - r2p->reply_len);
+	if (n < 1) {
+		return false;
+	}
+#endif
+	r2p->reply_len += n;
+	return true;
+}
+
+static bool r2p_write_all(R2Pipe *r2p, const ut8 *buf, int len) {
+	while (len > 0) {
+#if __WINDOWS__ && !defined(__CYGWIN__)
+		DWORD n = 0;
+		if (!WriteFile (r2p->pipe, buf, len, &n, NULL) || !n) {
+			return false;
+		}
+#else
+		/* write a pipe buffer at a time, taking the replies that come in
+		 * meanwhile, or both ends would wait for the other to read */
+		struct pollfd pfd[2] = {
+			{ r2p->input[1], POLLOUT, 0 },
+			{ r2p->output[0], POLLIN, 0 }
+		};
+		int n;
+		if (poll (pfd, 2, -1) < 1) {
+			return false;
+		}
+		if (pfd[1].revents && !r2p_read_ahead (r2p)) {
+			return false;
+		}
+		if (!(pfd[0].revents & POLLOUT)) {
+			if (pfd[0].revents) {
+				return false;
+			}
+			continue;
+		}
+		n = write (r2p->input[1], buf, R_MIN (len, PIPE_BUF));
+		if (n < 1) {
+			return false;
+		}
+#endif
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* take len bytes of replies, reading the pipe if r2p->reply has less */
+static bool r2p_read_all(R2Pipe *r2p, ut8 *buf, int len) {
+	while (r2p->reply_len < len) {
+		if (!r2p_read_ahead (r2p)) {
+			return false;
+		}
+	}
+	memcpy (buf, r2p->reply, len);
+	r2p->reply_len -= len;
+	memmove (r2p->reply, r2p->reply + len, r2p->reply_len);
+	return true;
+}
+
+R_API void r2p_frame_pack(ut8 *hdr, ut32 id, ut32 size) {
+	r_write_le32 (hdr, R2P_FRAME_MAGIC);
+	r_write_le32 (hdr + 4, id);
+	r_write_le32 (hdr + 8, size);
+}
+
+R_API bool r2p_frame_unpack(const ut8 *hdr, ut32 *id, ut32 *size) {
+	if (r_read_le32 (hdr) != R2P_FRAME_MAGIC) {
+		return false;
+	}
+	*id = r_read_le32 (hdr + 4);
+	*size = r_read_le32 (hdr + 8);
+	return true;
+}
+
+/* ask the peer whether it takes frames, see r_socket.h */
+static bool r2p_frame_hello(R2Pipe *r2p) {
+	ut8 msg[R2P_FRAME_SIZE + 1], hdr[R2P_FRAME_SIZE];
+	ut32 id, size;
+	r2p->framed = -1;
+	r2p_frame_pack (msg, 0, 1);
+	msg[R2P_FRAME_SIZE] = '\n';
+	if (!r2p_write_all (r2p, msg, sizeof (msg)) || !r2p_read_all (r2p, hdr, 1)) {
+		return false;
+	}
+	if (hdr[0] != (R2P_FRAME_MAGIC & 0xff)) {
+		/* a text reply, skip it up to its null byte */
+		while (hdr[0] && r2p_read_all (r2p, hdr, 1)) {
+			;
+		}
+		eprintf ("r2p_send: the peer does not take framed requests\n");
+		return false;
+	}
+	if (!r2p_read_all (r2p, hdr + 1, R2P_FRAME_SIZE - 1)
+			|| !r2p_frame_unpack (hdr, &id, &size) || id || size) {
+		return false;
+	}
+	r2p->framed = 1;
+	return true;
+}
+
+/* queue str without waiting for its reply, returns the request id or 0 */
+R_API ut32 r2p_send(R2Pipe *r2p, const char *str) {
+	int len;
+	ut8 *msg;
+	ut32 id;
+	if (!r2p || !str) {
+		return 0;
+	}
+	if (r2p->framed < 0 || (!r2p->framed && !r2p_frame_hello (r2p))) {
+		return 0;
+	}
+	len = strlen (str);
+	if (!(msg = malloc (R2P_FRAME_SIZE + len))) {
+		return 0;
+	}
+	if (!++r2p->seq) {
+		r2p->seq++;
+	}
+	id = r2p->seq;
+	r2p_frame_pack (msg, id, len);
+	memcpy (msg + R2P_FRAME_SIZE, str, len);
+	if (!r2p_write_all (r2p, msg, R2P_FRAME_SIZE + len)) {
+		id = 0;
+	}
+	free (msg);
+	return id;
+}
+
+/* wait for the next reply, id is set to the one of its request */
+R_API char *r2p_recv(R2Pipe *r2p, ut32 *id) {
+	ut8 hdr[R2P_FRAME_SIZE];
+	ut32 rid, size;
+	char *buf;
+	if (!r2p || r2p->framed < 1 || !r2p_read_all (r2p, hdr, sizeof (hdr))) {
+		return NULL;
+	}
+	if (!r2p_frame_unpack (hdr, &rid, &size)) {
+		eprintf ("r2p_recv: invalid frame\n");
+		return NULL;
+	}
+	if (size == UT32_MAX || !(buf = malloc (size + 1))) {
+		return NULL;
+	}
+	if (!r2p_read_all (r2p, (ut8 *)buf, size)) {
+		free (buf);
+		return NULL;
+	}
+	buf[size] = 0;
+	if (id) {
+		*id = rid;
+	}
+	return buf;
+}
+
 R_API void r2p_free (R2Pipe *r2p) {
 	r2p->magic = 0;
 	r2p_close (r2p);
@@ -7,103 +7,200 @@
 // TODO: Optimize to use memcpy when buffers are not in range..
 // check buf boundaries and offsets and use memcpy or memmove
 
-// copied from libr/io/cache.c:r_io_cache_read
-// ret # of bytes copied
-static int sparse_read(RList *list, ut64 addr, ut8 *buf, int len) {
-	int l, covered = 0;
-	RListIter *iter;
-	RBufferSparse *c;
-	r_list_foreach (list, iter, c) {
-		if (addr < c->to && c->from < addr + len) {
-			if (addr < c->from) {
-				l = R_MIN (addr + len - c->from, c->size);
-				memcpy (buf + c->from - addr, c->data, l);
-			} else {
-				l = R_MIN (c->to - addr, len);
-				memcpy (buf, c->data + addr - c->from, l);
-			}
-			covered += l;
-		}
+/* sparse buffers keep the written data in R_BUF_SPARSE_PAGE sized pages
+ * indexed by address in a red-black tree, so reads and writes cost a lookup
+ * per page touched and resizing only changes the logical length. A bitmap
+ * per page tells the written bytes from the Oxff filler between them */
+
+#define PAGE_SIZE_MASK ((ut64)R_BUF_SPARSE_PAGE - 1)
+#define PAGE_CONTAINER(x) container_of ((RBNode *)x, RBufferPage, rb)
+#define PAGE_USED(p, i) (((p)->used[(i) >> 3] >> ((i) & 7)) & 1)
+
+typedef struct {
+	ut64 addr; // page aligned
+	ut32 lo; // written range inside the page
+	ut32 hi;
+	RBNode rb;
+	ut8 used[R_BUF_SPARSE_PAGE / 8];
+	ut8 data[R_BUF_SPARSE_PAGE];
+} RBufferPage;
+
+static int page_cmp(const void *incoming, const RBNode *in_tree) {
+	ut64 addr = *(const ut64 *)incoming;
+	ut64 page = PAGE_CONTAINER (in_tree)->addr;
+	return (addr < page)? -1: (addr > page)? 1: 0;
+}
+
+static void page_free(RBNode *node) {
+	free (PAGE_CONTAINER (node));
+}
+
+/* set or clear the written bits of [from, to) */
+static void page_mark(RBufferPage *p, ut32 from, ut32 to, bool set) {
+	for (; from < to && (from & 7); from++) {
+		p->used[from >> 3] = set? p->used[from >> 3] | (1 << (from & 7))
+			: p->used[from >> 3] & ~(1 << (from & 7));
 	}
-	return covered;
-}
-
-static RBufferSparse *sparse_append(RList *l, ut64 addr, const ut8 *data, int len) {
-	if (l && data && len > 0) {
-		RBufferSparse *s = R_NEW0 (RBufferSparse);
-		if (s) {
-			s->data = calloc (1, len);
-			if (s->data) {
-				s->from = addr;
-				s->to = addr + len;
-				s->size = len;
-				s->odata = NULL;
-				memcpy (s->data, data, len);
-				return r_list_append (l, s)? s: NULL;
-			}
-			free (s);
+	if (to - from >= 8 && from < to) {
+		memset (p->used + (from >> 3), set? 0xff: 0, (to - from) >> 3);
+		from += (to - from) & ~7;
+	}
+	for (; from < to; from++) {
+		p->used[from >> 3] = set? p->used[from >> 3] | (1 << (from & 7))
+			: p->used[from >> 3] & ~(1 << (from & 7));
+	}
+}
+
+static RBufferPage *sparse_page(RBuffer *b, ut64 addr, bool create) {
+	RBufferPage *p;
+	RBNode *node;
+	addr &= ~PAGE_SIZE_MASK;
+	node = r_rbtree_find (b->sparse_pages, &addr, page_cmp);
+	if (node) {
+		return PAGE_CONTAINER (node);
+	}
+	if (!create || !(p = R_NEW0 (RBufferPage))) {
+		return NULL;
+	}
+	p->addr = addr;
+	p->lo = R_BUF_SPARSE_PAGE;
+	memset (p->data, b->Oxff, sizeof (p->data));
+	r_rbtree_insert (&b->sparse_pages, &p->addr, &p->rb, page_cmp);
+	return p;
+}
+
+/* copy the pages overlapping [addr, addr + len) into buf, the rest of buf
+ * is left as is */
+static void sparse_read(RBuffer *b, ut64 addr, ut8 *buf, int len) {
+	ut64 last = (addr + len - 1 < addr)? UT64_MAX: addr + len - 1;
+	ut64 at = addr & ~PAGE_SIZE_MASK;
+	RBNode *node;
+	while ((node = r_rbtree_lower_bound (b->sparse_pages, &at, page_cmp))) {
+		RBufferPage *p = PAGE_CONTAINER (node);
+		ut64 from, to;
+		if (p->addr > last) {
+			break;
+		}
+		from = R_MAX (p->addr, addr);
+		to = R_MIN (p->addr + PAGE_SIZE_MASK, last);
+		memcpy (buf + (from - addr), p->data + (from - p->addr), to - from + 1);
+		at = p->addr + R_BUF_SPARSE_PAGE;
+		if (!at) {
+			break;
 		}
 	}
-	return NULL;
 }
 
 //ret -1 if failed; # of bytes copied if success
-static int sparse_write(RList *l, ut64 addr, const ut8 *data, int len) {
-	RBufferSparse *s;
-	RListIter *iter;
-
-	r_list_foreach (l, iter, s) {
-		if (addr >= s->from && addr < s->to) {
-			int newlen = addr + len - s->to;
-			int delta = addr - s->from;
-			if (newlen > 0) {
-				// must realloc
-				ut8 *ndata = realloc (s->data, len + newlen);
-				if (ndata) {
-					s->data = ndata;
-				} else {
-					eprintf ("sparse write fail\n");
-					return -1;
-				}
-			}
-			memcpy (s->data + delta, data, len);
-			/* write here */
-			return len;
+static int sparse_write(RBuffer *b, ut64 addr, const ut8 *data, int len) {
+	int done = 0;
+	if (addr + len < addr) {
+		len = UT64_MAX - addr;
+	}
+	while (done < len) {
+		ut64 at = addr + done;
+		RBufferPage *p = sparse_page (b, at, true);
+		ut32 off, n;
+		if (!p) {
+			eprintf ("sparse write fail\n");
+			return -1;
 		}
+		off = at - p->addr;
+		n = R_MIN (len - done, R_BUF_SPARSE_PAGE - off);
+		memcpy (p->data + off, data + done, n);
+		page_mark (p, off, off + n, true);
+		p->lo = R_MIN (p->lo, off);
+		p->hi = R_MAX (p->hi, off + n);
+		done += n;
 	}
-	if (!sparse_append (l, addr, data, len)) {
-		return -1;
+	if (addr + len > b->length) {
+		b->length = addr + len;
 	}
 	return len;
 }
 
-static bool sparse_limits(RList *l, ut64 *min, ut64 *max) {
-	bool set = false;
-	RBufferSparse *s;
-	RListIter *iter;
-
+static bool sparse_limits(RBuffer *b, ut64 *min, ut64 *max) {
+	RBIter it = r_rbtree_first (b->sparse_pages);
 	if (min) {
-		*min = UT64_MAX;
+		*min = it.len? PAGE_CONTAINER (it.path[it.len - 1])->addr
+			+ PAGE_CONTAINER (it.path[it.len - 1])->lo: UT64_MAX;
+	}
+	if (max) {
+		*max = b->length;
+	}
+	return it.len > 0;
+}
+
+/* drop everything from newsize on */
+static void sparse_truncate(RBuffer *b, ut64 newsize) {
+	ut64 at = (newsize + PAGE_SIZE_MASK) & ~PAGE_SIZE_MASK;
+	RBufferPage *p;
+	RBNode *node;
+	if (at >= newsize) {
+		while ((node = r_rbtree_lower_bound (b->sparse_pages, &at, page_cmp))) {
+			p = PAGE_CONTAINER (node);
+			r_rbtree_delete (&b->sparse_pages, &p->addr, page_cmp, page_free);
+		}
+	}
+	p = sparse_page (b, newsize, false);
+	if (p) {
+		ut32 off = newsize - p->addr;
+		memset (p->data + off, b->Oxff, R_BUF_SPARSE_PAGE - off);
+		page_mark (p, off, R_BUF_SPARSE_PAGE, false);
+		p->hi = R_MIN (p->hi, off);
+		if (p->lo >= p->hi) {
+			r_rbtree_delete (&b->sparse_pages, &p->addr, page_cmp, page_free);
+		}
+	}
+}
+
+static bool sparse_chunk_add(RList *list, RBufferPage *p, ut32 from, ut32 to) {
+	RBufferSparse *s = R_NEW0 (RBufferSparse);
+	if (!s) {
+		return false;
+	}
+	s->from = p->addr + from;
+	s->to = p->addr + to;
+	s->size = to - from;
+	s->data = p->data + from;
+	r_list_append (list, s);
+	return true;
+}
+
+/* list of RBufferSparse with the written ranges sorted by address, one per
+ * run of written bytes inside a page. The data points into the buffer and
+ * is valid until the next write or resize */
+R_API RList *r_buf_sparse_chunks(RBuffer *b) {
+	RList *list;
+	RBufferPage *p;
+	RBIter it;
+	if (!b || !b->sparse || !(list = r_list_newf (free))) {
+		return NULL;
 	}
-	r_list_foreach (l, iter, s) {
-		if (set) {
-			if (min && s->from < *min) {
-				*min = s->from;
+	it = r_rbtree_first (b->sparse_pages);
+	r_rbtree_iter_while (it, p, RBufferPage, rb) {
+		ut32 from, i = p->lo;
+		while (i < p->hi) {
+			if (!(i & 7) && !p->used[i >> 3]) {
+				i += 8;
+				continue;
 			}
-			if (max && s->to > *max) {
-				*max = s->to;
+			if (!PAGE_USED (p, i)) {
+				i++;
+				continue;
 			}
-		} else {
-			set = true;
-			if (min) {
-				*min = s->from;
+			from = i;
+			while (i < p->hi && PAGE_USED (p, i)) {
+				i = (!(i & 7) && p->used[i >> 3] == 0xff)? i + 8: i + 1;
 			}
-			if (max) {
-				*max = s->to;
+			i = R_MIN (i, p->hi);
+			if (!sparse_chunk_add (list, p, from, i)) {
+				r_list_free (list);
+				return NULL;
 			}
 		}
 	}
-	return set;
+	return list;
 }
 
 R_API RBuffer *r_buf_new_with_pointers (const ut8 *bytes, ut64 len) {
@@ -153,7 +250,7 @@ R_API RBuffer *r_buf_new_sparse(ut8 Oxff) {
 		return NULL;
 	}
 	b->Oxff = Oxff;
-	b->sparse = r_list_newf ((RListFree)free);
+	b->sparse = true;
 	return b;
 }
 
@@ -178,11 +275,7 @@ R_API ut64 r_buf_size (RBuffer *b) {
 		return b->length;
 	}
 	if (b->sparse) {
-		ut64 max = 0LL;
-		if (sparse_limits (b->sparse, NULL, &max)) {
-			return max; // -min
-		}
-		return 0LL;
+		return b->length;
 	}
 	return b->empty? 0: b->length;
 }
@@ -253,15 +346,13 @@ R_API int r_buf_seek (RBuffer *b, st64 addr, int whence) {
 			return -1;
 		}
 	} else if (b->sparse) {
-		sparse_limits (b->sparse, &min, &max);
+		if (!sparse_limits (b, &min, &max)) {
+			min = 0;
+		}
 		switch (whence) {
 		case R_IO_SEEK_SET: b->cur = addr; break;
 		case R_IO_SEEK_CUR: b->cur = b->cur + addr; break;
-		case R_IO_SEEK_END:
-			    if (sparse_limits (b->sparse, NULL, &max)) {
-				    return max; // -min
-			    }
-			    b->cur = max + addr; break; //b->base + b->length + addr; break;
+		case R_IO_SEEK_END: b->cur = max + addr; break;
 		}
 	} else {
 		min = b->base;
@@ -463,13 +554,13 @@ static int r_buf_cpy(RBuffer *b, ut64 addr, ut8 *dst, const ut8 *src, int len, i
 	if (b->sparse) {
 		if (write) {
 			// create new with src + len
-			if (sparse_write (b->sparse, addr, src, len) < 0) {
+			if (sparse_write (b, addr, src, len) < 0) {
 				return -1;
 			}
 		} else {
 			// read from sparse and write into dst
 			memset (dst, b->Oxff, len);
-			(void)sparse_read (b->sparse, addr, dst, len);
+			sparse_read (b, addr, dst, len);
 		}
 		return len;
 	}
@@ -677,7 +768,7 @@ R_API int r_buf_write_at(RBuffer *b, ut64 addr, const ut8 *buf, int len) {
 		return r_sandbox_write (b->fd, buf, len);
 	}
 	if (b->sparse) {
-		return (sparse_write (b->sparse, addr, buf, len) < 0) ? -1 : len;
+		return (sparse_write (b, addr, buf, len) < 0) ? -1 : len;
 	}
 	if (b->empty) {
 		b->empty = 0;
@@ -699,8 +790,8 @@ R_API void r_buf_deinit(RBuffer *b) {
 		return;
 	}
 	if (b->sparse) {
-		r_list_free (b->sparse);
-		b->sparse = NULL;
+		r_rbtree_free (b->sparse_pages, page_free);
+		b->sparse_pages = NULL;
 	}
 	if (b->mmap) {
 		r_file_mmap_free (b->mmap);
@@ -750,20 +841,11 @@ R_API bool r_buf_resize (RBuffer *b, ut64 newsize) {
 		return false;
 	}
 	if (b->sparse) {
-		ut64 last_addr = 0;
-		sparse_limits (b->sparse, 0, &last_addr);
-		int buf_len = newsize - last_addr;
-		if (buf_len > 0) {
-			ut8 *buf = malloc (buf_len);
-			if (buf) {
-				memset (buf, b->Oxff, buf_len);
-				sparse_write (b->sparse, last_addr, buf, buf_len);
-				free (buf);
-				return true;
-			}
+		if (newsize < b->length) {
+			sparse_truncate (b, newsize);
 		}
-		eprintf ("Invalid resize for an sparse RBuffer\n");
-		return false;
+		b->length = newsize;
+		return true;
 	}
 	ut8 *buf = calloc (newsize, 1);
 	if (buf) {
@@ -14,6 +14,19 @@ void r_list_iter_free (RListIter *list) {
 	/* do nothing? */
 }
 
+/* nodes of pooled lists come from and go back to list->pool */
+static inline RListIter *list_iter_alloc(RList *list) {
+	return list->pool? r_mem_pool_alloc (list->pool): R_NEW (RListIter);
+}
+
+static inline void list_iter_release(RList *list, RListIter *iter) {
+	if (list->pool) {
+		r_mem_pool_dealloc (list->pool, iter);
+	} else {
+		free (iter);
+	}
+}
+
 RListIter *r_list_iter_get_next(RListIter *list) {
 	return list ? list->n : NULL;
 }
@@ -47,6 +60,7 @@ R_API void r_list_init(RList *list) {
 	list->free = NULL;
 	list->length = 0;
 	list->sorted = false;
+	list->pool = NULL;
 }
 
 R_API int r_list_length(const RList *list) {
@@ -93,7 +107,7 @@ R_API void r_list_delete(RList *list, RListIter *iter) {
 			list->free (iter->data);
 		}
 		iter->data = NULL;
-		R_FREE (iter);
+		list_iter_release (list, iter);
 	}
 }
 
@@ -104,7 +118,7 @@ R_API void r_list_split(RList *list, void *ptr) {
 			void *item = iter->data;
 			if (ptr == item) {
 				r_list_split_iter (list, iter);
-				free (iter);
+				list_iter_release (list, iter);
 				break;
 			}
 			iter = iter->n;
@@ -136,6 +150,17 @@ R_API int r_list_join(RList *list1, RList *list2) {
 	if (!(list2->length)) {
 		return 0;
 	}
+	if (list1->pool != list2->pool) {
+		/* the nodes belong to another pool, move the data instead */
+		RListIter *iter;
+		while ((iter = list2->head)) {
+			void *data = iter->data;
+			r_list_split_iter (list2, iter);
+			list_iter_release (list2, iter);
+			r_list_append (list1, data);
+		}
+		return 1;
+	}
 	if (!(list1->length)) {
 		list1->head = list2->head;
 		list1->tail = list2->tail;
@@ -168,6 +193,24 @@ R_API RList *r_list_newf(RListFree f) {
 	return l;
 }
 
+/* list whose nodes are taken from pool, which must outlive it */
+R_API RList *r_list_new_pool(RMemoryPool *pool, RListFree f) {
+	RList *l = r_list_newf (f);
+	if (l) {
+		l->pool = pool;
+	}
+	return l;
+}
+
+/* nodes already in the list were not taken from pool */
+R_API bool r_list_set_pool(RList *list, RMemoryPool *pool) {
+	if (!list || list->head) {
+		return false;
+	}
+	list->pool = pool;
+	return true;
+}
+
 R_API RListIter *r_list_item_new(void *data) {
 	RListIter *item = R_NEW0 (RListIter);
 	if (!item) {
@@ -180,7 +223,7 @@ R_API RListIter *r_list_item_new(void *data) {
 R_API RListIter *r_list_append(RList *list, void *data) {
 	RListIter *item = NULL;
 	if (list && data) {
-		item = R_NEW (RListIter);
+		item = list_iter_alloc (list);
 		if (!item) {
 			return item;
 		}
@@ -202,7 +245,7 @@ R_API RListIter *r_list_append(RList *list, void *data) {
 
 R_API RListIter *r_list_prepend(RList *list, void *data) {
 	if (list) {
-		RListIter *item = R_NEW0 (RListIter);
+		RListIter *item = list_iter_alloc (list);
 		if (!item) {
 			return NULL;
 		}
@@ -232,7 +275,7 @@ R_API RListIter *r_list_insert(RList *list, int n, void *data) {
 		}
 		for (it = list->head, i = 0; it && it->data; it = it->n, i++) {
 			if (i == n) {
-				item = R_NEW (RListIter);
+				item = list_iter_alloc (list);
 				if (!item) {
 					return NULL;
 				}
@@ -265,7 +308,7 @@ R_API void *r_list_pop(RList *list) {
 				list->tail->n = NULL;
 			}
 			data = iter->data;
-			free (iter);
+			list_iter_release (list, iter);
 		}
 		list->length--;
 		return data;
@@ -286,7 +329,7 @@ R_API void *r_list_pop_head(RList *list) {
 				list->head->p = NULL;
 			}
 			data = iter->data;
-			free (iter);
+			list_iter_release (list, iter);
 		}
 		list->length--;
 		return data;
@@ -314,7 +357,7 @@ R_API int r_list_del_n(RList *list, int n) {
 				it->p->n = it->n;
 				it->n->p = it->p;
 			}
-			free (it);
+			list_iter_release (list, it);
 			list->length--;
 			return true;
 		}
@@ -373,7 +416,7 @@ R_API RListIter *r_list_add_sorted(RList *list, void *data, RListComparator cmp)
 	if (list && data && cmp) {
 		for (it = list->head; it && it->data && cmp (data, it->data) > 0; it = it->n) ;
 		if (it) {
-			item = R_NEW0 (RListIter);
+			item = list_iter_alloc (list);
 			if (!item) {
 				return NULL;
 			}
@@ -0,0 +1,165 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+#include <r_util.h>
+
+/* LZ4 block format: every sequence is a token (literal length << 4 |
+ * match length - 4), the literals, a little endian 16 bit offset and the
+ * match length. A length of 15 in the token continues in the next bytes,
+ * adding them up while they are 255. The last sequence has only literals,
+ * and the last 5 bytes of the input are always literals */
+
+#define LZ4_MINMATCH 4
+#define LZ4_LASTLITERALS 5
+#define LZ4_MFLIMIT 12
+#define LZ4_MAXOFFSET 65535
+#define LZ4_HASHLOG 12
+
+static inline ut32 lz4_hash(ut32 v) {
+	return (v * 2654435761U) >> (32 - LZ4_HASHLOG);
+}
+
+static ut8 *lz4_length(ut8 *op, int n) {
+	for (; n >= 255; n -= 255) {
+		*op++ = 255;
+	}
+	*op++ = n;
+	return op;
+}
+
+static ut8 *lz4_literals(ut8 *op, ut8 *token, const ut8 *src, int n) {
+	*token = R_MIN (n, 15) << 4;
+	if (n >= 15) {
+		op = lz4_length (op, n - 15);
+	}
+	memcpy (op, src, n);
+	return op + n;
+}
+
+/* worst case size of len bytes compressed */
+R_API int r_lz4_bound(int len) {
+	return len + len / 255 + 16;
+}
+
+/* compress len bytes of src into dst, which has room for dstlen. Returns
+ * the compressed size, or 0 if it does not fit */
+R_API int r_lz4_compress(const ut8 *src, int len, ut8 *dst, int dstlen) {
+	int table[1 << LZ4_HASHLOG];
+	const ut8 *ip = src, *anchor = src;
+	const ut8 *end = src + len;
+	ut8 *op = dst, *oend = dst + dstlen;
+	int n;
+	if (!src || !dst || len < 0) {
+		return 0;
+	}
+	if (len > LZ4_MFLIMIT) {
+		const ut8 *mflimit = end - LZ4_MFLIMIT;
+		const ut8 *matchlimit = end - LZ4_LASTLITERALS;
+		memset (table, 0xff, sizeof (table));
+		while (ip < mflimit) {
+			ut32 seq = r_read_le32 (ip);
+			ut32 h = lz4_hash (seq);
+			const ut8 *match, *mp, *mm;
+			int ref = table[h];
+			table[h] = ip - src;
+			if (ref < 0 || ip - src - ref > LZ4_MAXOFFSET || r_read_le32 (src + ref) != seq) {
+				ip++;
+				continue;
+			}
+			match = src + ref;
+			while (ip > anchor && match > src && ip[-1] == match[-1]) {
+				ip--;
+				match--;
+			}
+			mp = ip + LZ4_MINMATCH;
+			mm = match + LZ4_MINMATCH;
+			while (mp < matchlimit && *mp == *mm) {
+				mp++;
+				mm++;
+			}
+			n = ip - anchor;
+			if ((oend - op) < 1 + n + n / 255 + 1 + 2 + (mp - ip) / 255 + 1) {
+				return 0;
+			}
+			ut8 *token = op++;
+			op = lz4_literals (op, token, anchor, n);
+			r_write_le16 (op, ip - match);
+			op += 2;
+			n = mp - ip - LZ4_MINMATCH;
+			*token |= R_MIN (n, 15);
+			if (n >= 15) {
+				op = lz4_length (op, n - 15);
+			}
+			ip = anchor = mp;
+		}
+	}
+	n = end - anchor;
+	if ((oend - op) < 1 + n + n / 255 + 1) {
+		return 0;
+	}
+	op = lz4_literals (op + 1, op, anchor, n);
+	return op - dst;
+}
+
+static const ut8 *lz4_read_length(const ut8 *ip, const ut8 *iend, int *n) {
+	if (*n == 15) {
+		ut8 b;
+		do {
+			if (ip >= iend) {
+				return NULL;
+			}
+			b = *ip++;
+			*n += b;
+		} while (b == 255);
+	}
+	return ip;
+}
+
+/* decompress len bytes of src into dst, which has room for dstlen.
+ * Returns the decompressed size, or -1 if the input is not valid */
+R_API int r_lz4_decompress(const ut8 *src, int len, ut8 *dst, int dstlen) {
+	const ut8 *ip = src, *iend = src + len;
+	ut8 *op = dst, *oend = dst + dstlen;
+	if (!src || !dst || len < 1) {
+		return -1;
+	}
+	while (ip < iend) {
+		ut8 token = *ip++;
+		int off, n = token >> 4;
+		if (!(ip = lz4_read_length (ip, iend, &n))) {
+			return -1;
+		}
+		if (n > iend - ip || n > oend - op) {
+			return -1;
+		}
+		memcpy (op, ip, n);
+		op += n;
+		ip += n;
+		if (ip == iend) {
+			break;
+		}
+		if (iend - ip < 2) {
+			return -1;
+		}
+		off = r_read_le16 (ip);
+		ip += 2;
+		n = token & 15;
+		if (!off || off > op - dst || !(ip = lz4_read_length (ip, iend, &n))) {
+			return -1;
+		}
+		n += LZ4_MINMATCH;
+		if (n > oend - op) {
+			return -1;
+		}
+		if (off >= n) {
+			memcpy (op, op - off, n);
+			op += n;
+		} else {
+			/* the match overlaps the output, it repeats the last bytes */
+			const ut8 *m = op - off;
+			while (n--) {
+				*op++ = *m++;
+			}
+		}
+	}
+	return op - dst;
+}
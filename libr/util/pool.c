@@ -1,4 +1,4 @@
-/* radare - LGPL - Copyright 2010-2011 pancake<nopcode.org> */
+/* radare - LGPL - Copyright 2010-2018 pancake<nopcode.org> */
 
 #include <r_util.h>
 #include <stdlib.h>
@@ -10,18 +10,41 @@
 // This can be useful when the application is swapping (userland swapping?)
 // Do user-swapping takes sense?
 
+/* nodes are carved from slabs of poolsize elements, released ones are kept
+ * in a free list for the next alloc and the slabs only go away together */
+
 R_API RMemoryPool *r_mem_pool_deinit(RMemoryPool *pool) {
 	int i;
-	for (i = 0; i < pool->npool; i++) {
+	for (i = 0; i <= pool->npool; i++) {
 		free (pool->nodes[i]);
 	}
 	free (pool->nodes);
 	pool->nodes = NULL;
+	pool->npool = -1;
+	pool->ncount = pool->poolsize;
+	pool->poolcount = 0;
+	pool->freelist = NULL;
+	pool->used = 0;
 	return pool;
 }
 
+/* drop every node at once, the pool can be used again after it */
+R_API void r_mem_pool_reset(RMemoryPool *pool) {
+	int i;
+	if (!pool) {
+		return;
+	}
+	for (i = 0; i <= pool->npool; i++) {
+		R_FREE (pool->nodes[i]);
+	}
+	pool->npool = -1;
+	pool->ncount = pool->poolsize;
+	pool->freelist = NULL;
+	pool->used = 0;
+}
+
 R_API RMemoryPool *r_mem_pool_new(int nodesize, int poolsize, int poolcount) {
-	RMemoryPool *mp = R_NEW (RMemoryPool);
+	RMemoryPool *mp = R_NEW0 (RMemoryPool);
 	if (mp) {
 		if (poolsize < 1) {
 			poolsize = ALLOC_POOL_SIZE;
@@ -29,10 +52,13 @@ R_API RMemoryPool *r_mem_pool_new(int nodesize, int poolsize, int poolcount) {
 		if (poolcount < 1) {
 			poolcount = ALLOC_POOL_COUNT;
 		}
-		// TODO: assert nodesize?;
+		/* released nodes hold the free list link */
+		if (nodesize < (int)sizeof (void *)) {
+			nodesize = sizeof (void *);
+		}
 		mp->poolsize = poolsize;
 		mp->poolcount = poolcount;
-		mp->nodesize = nodesize;
+		mp->nodesize = R_ROUND (nodesize, sizeof (ut64));
 		mp->npool = -1;
 		mp->ncount = mp->poolsize;	// force init
 		mp->nodes = (ut8 **) calloc (sizeof (void *), mp->poolcount);
@@ -45,33 +71,53 @@ R_API RMemoryPool *r_mem_pool_new(int nodesize, int poolsize, int poolcount) {
 }
 
 R_API RMemoryPool *r_mem_pool_free(RMemoryPool *pool) {
-	r_mem_pool_deinit (pool);
-	free (pool);
+	if (pool) {
+		r_mem_pool_deinit (pool);
+		free (pool);
+	}
 	return NULL;
 }
 
 R_API void *r_mem_pool_alloc(RMemoryPool *pool) {
+	void *p;
 	if (!pool) {
 		return NULL;
 	}
+	if (pool->freelist) {
+		p = pool->freelist;
+		pool->freelist = *(void **)p;
+		pool->used++;
+		return p;
+	}
 	if (pool->ncount >= pool->poolsize) {
-		if (++pool->npool >= pool->poolcount) {
-			eprintf ("FAIL: Cannot allocate more memory in the pool\n");
-			return NULL;
+		if (pool->npool + 1 >= pool->poolcount) {
+			int count = pool->poolcount? pool->poolcount * 2: ALLOC_POOL_COUNT;
+			ut8 **nodes = realloc (pool->nodes, count * sizeof (void *));
+			if (!nodes) {
+				return NULL;
+			}
+			pool->nodes = nodes;
+			pool->poolcount = count;
 		}
-		pool->nodes[pool->npool] = malloc (pool->nodesize * pool->poolsize);
-		if (!pool->nodes[pool->npool]) {
+		p = malloc ((size_t)pool->nodesize * pool->poolsize);
+		if (!p) {
 			return NULL;
 		}
+		pool->nodes[++pool->npool] = p;
 		pool->ncount = 0;
 	}
-	// TODO: fix warning
-	return (void *) (&(pool->nodes[pool->npool][pool->ncount++]));
+	pool->used++;
+	return pool->nodes[pool->npool] + (size_t)pool->nodesize * pool->ncount++;
 }
 
-// TODO: not implemented
 R_API int r_mem_pool_dealloc(RMemoryPool *pool, void *p) {
-	return false;
+	if (!pool || !p) {
+		return false;
+	}
+	*(void **)p = pool->freelist;
+	pool->freelist = p;
+	pool->used--;
+	return true;
 }
 
 /* poolfactory */
@@ -157,6 +157,119 @@ R_API char *r_strpool_slice (RStrpool *p, int index) {
 	return o;
 }
 
+/* interned strings: each text is stored once per pool with a reference
+ * count, so equal names taken from the same pool share the address and
+ * compare by pointer. The entry knows its pool, so references can be
+ * dropped without it, and every live entry keeps the pool alive */
+
+typedef struct {
+	RStrIntern *pool;
+	ut32 refs;
+	char str[];
+} RStrInternEntry;
+
+#define INTERN_ENTRY(s) ((RStrInternEntry *)((char *)(s) - offsetof (RStrInternEntry, str)))
+
+static void intern_kv_free(HtKv *kv) {
+	/* the key is the text inside the entry */
+	free (kv);
+}
+
+R_API RStrIntern *r_str_intern_new(void) {
+	RStrIntern *si = R_NEW0 (RStrIntern);
+	if (!si) {
+		return NULL;
+	}
+	si->ht = ht_new (NULL, intern_kv_free, NULL);
+	if (!si->ht) {
+		free (si);
+		return NULL;
+	}
+	si->refs = 1;
+	return si;
+}
+
+R_API RStrIntern *r_str_intern_ref(RStrIntern *si) {
+	if (si) {
+		si->refs++;
+	}
+	return si;
+}
+
+R_API void r_str_intern_free(RStrIntern *si) {
+	if (si && --si->refs < 1) {
+		ht_free (si->ht);
+		free (si);
+	}
+}
+
+/* returns the interned copy of s with a new reference on it. The string
+ * must not be modified, and is released with r_str_intern_put */
+R_API char *r_str_intern_get(RStrIntern *si, const char *s) {
+	RStrInternEntry *e;
+	HtKv *kv;
+	int len;
+	if (!si || !s) {
+		return NULL;
+	}
+	kv = ht_find_kv (si->ht, s, NULL);
+	if (kv) {
+		e = kv->value;
+		e->refs++;
+		return e->str;
+	}
+	len = strlen (s);
+	e = malloc (sizeof (RStrInternEntry) + len + 1);
+	kv = R_NEW0 (HtKv);
+	if (!e || !kv) {
+		free (e);
+		free (kv);
+		return NULL;
+	}
+	memcpy (e->str, s, len + 1);
+	e->pool = r_str_intern_ref (si);
+	e->refs = 1;
+	kv->key = e->str;
+	kv->key_len = len;
+	kv->value = e;
+	if (!ht_insert_kv (si->ht, kv, false)) {
+		r_str_intern_free (si);
+		free (kv);
+		free (e);
+		return NULL;
+	}
+	return e->str;
+}
+
+/* another reference to an interned string */
+R_API char *r_str_intern_dup(const char *s) {
+	if (s) {
+		INTERN_ENTRY (s)->refs++;
+	}
+	return (char *)s;
+}
+
+/* the pool holding an interned string */
+R_API RStrIntern *r_str_intern_pool(const char *s) {
+	return s? INTERN_ENTRY (s)->pool: NULL;
+}
+
+R_API void r_str_intern_put(const char *s) {
+	RStrInternEntry *e;
+	RStrIntern *si;
+	if (!s) {
+		return;
+	}
+	e = INTERN_ENTRY (s);
+	if (--e->refs) {
+		return;
+	}
+	si = e->pool;
+	ht_delete (si->ht, e->str);
+	free (e);
+	r_str_intern_free (si);
+}
+
 #if TEST
 int main() {
 	RStrpool *p = r_strpool_new (1024);
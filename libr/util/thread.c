@@ -36,6 +36,20 @@ static void *_r_th_launcher(void *_th) {
 	return 0;
 }
 
+/* number of online processors, 1 if unknown */
+R_API int r_th_ncpus(void) {
+#if __WINDOWS__ && !defined(__CYGWIN__)
+	SYSTEM_INFO si;
+	GetSystemInfo (&si);
+	return R_MAX (1, (int)si.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf (_SC_NPROCESSORS_ONLN);
+	return n > 0? (int)n: 1;
+#else
+	return 1;
+#endif
+}
+
 R_API int r_th_push_task(struct r_th_t *th, void *user) {
 	int ret = true;
 	th->user = user;
@@ -7,7 +7,6 @@
 R_API RThreadLock *r_th_lock_new(bool recursive) {
 	RThreadLock *thl = R_NEW0 (RThreadLock);
 	if (thl) {
-		// TODO: thl->refs is inconsistently guarded by mutexes and could race
 		thl->refs = 0;
 #if HAVE_PTHREAD
 		if (recursive) {
@@ -46,15 +45,14 @@ R_API int r_th_lock_enter(RThreadLock *thl) {
 }
 
 R_API int r_th_lock_leave(RThreadLock *thl) {
+	/* still holding the lock, refs is guarded by it */
+	int refs = thl->refs > 0? --thl->refs: 0;
 #if HAVE_PTHREAD
 	pthread_mutex_unlock (&thl->lock);
 #elif __WINDOWS__ && !defined(__CYGWIN__)
 	LeaveCriticalSection (&thl->lock);
 #endif
-	if (thl->refs > 0) {
-		thl->refs--;
-	}
-	return thl->refs;
+	return refs;
 }
 
 R_API int r_th_lock_check(RThreadLock *thl) {
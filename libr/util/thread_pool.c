@@ -0,0 +1,381 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+#include <r_th.h>
+
+/* work stealing pool: every worker owns a deque of tasks, pushing and
+ * popping at its bottom, and when it runs dry it steals from the top of
+ * the other ones. Tasks submitted from threads outside the pool go to a
+ * shared deque. A thread joining a task runs queued tasks meanwhile, so
+ * tasks can submit and join subtasks without starving the pool.
+ *
+ * The deques have their own lock, which is uncontended unless stealing.
+ * The pool lock is only taken to sleep, wake up and complete tasks */
+
+#define DEQUE_MIN 64
+
+typedef struct r_th_deque_t {
+	RThreadLock *lock;
+	RThreadTask **tasks;
+	int size; // power of two
+	int top;
+	int bottom;
+} RThreadDeque;
+
+typedef struct r_th_worker_t {
+	RThreadPool *pool;
+	RThreadDeque deque;
+	R_TH_TID tid;
+#if __WINDOWS__ && !defined(__CYGWIN__)
+	DWORD id;
+#endif
+} RThreadWorker;
+
+typedef struct {
+	RThreadForCallback cb;
+	void *user;
+	ut64 from;
+	ut64 to;
+} ForChunk;
+
+static bool deque_init(RThreadDeque *dq) {
+	dq->lock = r_th_lock_new (false);
+	dq->tasks = calloc (DEQUE_MIN, sizeof (RThreadTask *));
+	dq->size = DEQUE_MIN;
+	dq->top = dq->bottom = 0;
+	return dq->lock && dq->tasks;
+}
+
+static void deque_fini(RThreadDeque *dq) {
+	r_th_lock_free (dq->lock);
+	R_FREE (dq->tasks);
+}
+
+static bool deque_push(RThreadDeque *dq, RThreadTask *task) {
+	r_th_lock_enter (dq->lock);
+	if (dq->bottom - dq->top == dq->size) {
+		int i, n = dq->bottom - dq->top;
+		RThreadTask **tasks = malloc (dq->size * 2 * sizeof (RThreadTask *));
+		if (!tasks) {
+			r_th_lock_leave (dq->lock);
+			return false;
+		}
+		for (i = 0; i < n; i++) {
+			tasks[i] = dq->tasks[(dq->top + i) & (dq->size - 1)];
+		}
+		free (dq->tasks);
+		dq->tasks = tasks;
+		dq->size *= 2;
+		dq->top = 0;
+		dq->bottom = n;
+	}
+	dq->tasks[dq->bottom++ & (dq->size - 1)] = task;
+	r_th_lock_leave (dq->lock);
+	return true;
+}
+
+/* newest task, for the owner */
+static RThreadTask *deque_pop(RThreadDeque *dq) {
+	RThreadTask *task = NULL;
+	r_th_lock_enter (dq->lock);
+	if (dq->bottom != dq->top) {
+		task = dq->tasks[--dq->bottom & (dq->size - 1)];
+		if (dq->bottom == dq->top) {
+			dq->top = dq->bottom = 0;
+		}
+	}
+	r_th_lock_leave (dq->lock);
+	return task;
+}
+
+/* oldest task, for the thieves */
+static RThreadTask *deque_steal(RThreadDeque *dq) {
+	RThreadTask *task = NULL;
+	r_th_lock_enter (dq->lock);
+	if (dq->bottom != dq->top) {
+		task = dq->tasks[dq->top++ & (dq->size - 1)];
+		if (dq->bottom == dq->top) {
+			dq->top = dq->bottom = 0;
+		}
+	}
+	r_th_lock_leave (dq->lock);
+	return task;
+}
+
+/* the worker running the calling thread, NULL outside of the pool */
+static RThreadWorker *pool_self(RThreadPool *pool) {
+	int i;
+#if HAVE_PTHREAD
+	pthread_t self = pthread_self ();
+#elif __WINDOWS__ && !defined(__CYGWIN__)
+	DWORD self = GetCurrentThreadId ();
+#endif
+	for (i = 0; i < pool->size; i++) {
+		RThreadWorker *w = &pool->workers[i];
+#if HAVE_PTHREAD
+		if (pthread_equal (w->tid, self)) {
+			return w;
+		}
+#elif __WINDOWS__ && !defined(__CYGWIN__)
+		if (w->id == self) {
+			return w;
+		}
+#endif
+	}
+	return NULL;
+}
+
+static RThreadTask *pool_take(RThreadPool *pool, RThreadWorker *w) {
+	RThreadTask *task = w? deque_pop (&w->deque): NULL;
+	int i, first = w? (int)(w - pool->workers) + 1: 0;
+	if (task || (task = deque_steal (pool->inject))) {
+		return task;
+	}
+	for (i = 0; i < pool->size; i++) {
+		RThreadWorker *victim = &pool->workers[(first + i) % pool->size];
+		if (victim != w && (task = deque_steal (&victim->deque))) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static void task_run(RThreadPool *pool, RThreadTask *task) {
+	void *result = task->fcn (task->user);
+	r_th_lock_enter (pool->lock);
+	task->result = result;
+	task->done = true;
+	if (pool->waiting) {
+		r_th_cond_signal_all (pool->cond);
+	}
+	r_th_lock_leave (pool->lock);
+}
+
+/* run queued tasks until the pool stops and there are none left */
+static void worker_loop(RThreadWorker *w) {
+	RThreadPool *pool = w->pool;
+	for (;;) {
+		RThreadTask *task = pool_take (pool, w);
+		if (!task) {
+			r_th_lock_enter (pool->lock);
+			/* look again with the lock, a push now would signal too late */
+			task = pool_take (pool, w);
+			if (!task) {
+				if (pool->stop) {
+					r_th_lock_leave (pool->lock);
+					break;
+				}
+				pool->sleeping++;
+				r_th_cond_wait (pool->cond, pool->lock);
+				pool->sleeping--;
+			}
+			r_th_lock_leave (pool->lock);
+		}
+		if (task) {
+			task_run (pool, task);
+		}
+	}
+}
+
+/* the pool is set up with its lock held, taking it makes that visible */
+#if __WINDOWS__ && !defined(__CYGWIN__)
+static DWORD WINAPI worker_main(void *user) {
+	RThreadWorker *w = user;
+	r_th_lock_wait (w->pool->lock);
+	worker_loop (w);
+	return 0;
+}
+#else
+static void *worker_main(void *user) {
+	RThreadWorker *w = user;
+	r_th_lock_wait (w->pool->lock);
+	worker_loop (w);
+	return NULL;
+}
+#endif
+
+/* size workers, or one per processor if size < 1 */
+R_API RThreadPool *r_th_pool_new(int size) {
+	RThreadPool *pool = R_NEW0 (RThreadPool);
+	int i;
+	if (!pool) {
+		return NULL;
+	}
+	if (size < 1) {
+		size = r_th_ncpus ();
+	}
+	pool->lock = r_th_lock_new (false);
+	pool->cond = r_th_cond_new ();
+	pool->inject = R_NEW0 (RThreadDeque);
+	pool->workers = calloc (size, sizeof (RThreadWorker));
+	if (!pool->lock || !pool->cond || !pool->inject || !pool->workers
+			|| !deque_init (pool->inject)) {
+		r_th_pool_free (pool);
+		return NULL;
+	}
+	r_th_lock_enter (pool->lock);
+	for (i = 0; i < size; i++) {
+		RThreadWorker *w = &pool->workers[i];
+		w->pool = pool;
+		if (!deque_init (&w->deque)) {
+			break;
+		}
+#if HAVE_PTHREAD
+		if (pthread_create (&w->tid, NULL, worker_main, w)) {
+			deque_fini (&w->deque);
+			break;
+		}
+#elif __WINDOWS__ && !defined(__CYGWIN__)
+		if (!(w->tid = CreateThread (NULL, 0, worker_main, w, 0, &w->id))) {
+			deque_fini (&w->deque);
+			break;
+		}
+#endif
+		pool->size++;
+	}
+	r_th_lock_leave (pool->lock);
+	if (!pool->size) {
+		r_th_pool_free (pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/* waits for the queued tasks. The ones never joined are not released */
+R_API void r_th_pool_free(RThreadPool *pool) {
+	int i;
+	if (!pool) {
+		return;
+	}
+	if (pool->lock) {
+		r_th_lock_enter (pool->lock);
+		pool->stop = true;
+		if (pool->cond) {
+			r_th_cond_signal_all (pool->cond);
+		}
+		r_th_lock_leave (pool->lock);
+	}
+	for (i = 0; i < pool->size; i++) {
+		RThreadWorker *w = &pool->workers[i];
+#if HAVE_PTHREAD
+		pthread_join (w->tid, NULL);
+#elif __WINDOWS__ && !defined(__CYGWIN__)
+		WaitForSingleObject (w->tid, INFINITE);
+		CloseHandle (w->tid);
+#endif
+	}
+	/* not before, the running workers still steal from them */
+	for (i = 0; i < pool->size; i++) {
+		deque_fini (&pool->workers[i].deque);
+	}
+	if (pool->inject) {
+		deque_fini (pool->inject);
+		free (pool->inject);
+	}
+	free (pool->workers);
+	r_th_cond_free (pool->cond);
+	r_th_lock_free (pool->lock);
+	free (pool);
+}
+
+/* queue fcn (user) to run in the pool. The task must be joined */
+R_API RThreadTask *r_th_pool_submit(RThreadPool *pool, RThreadTaskCallback fcn, void *user) {
+	RThreadWorker *w;
+	RThreadTask *task;
+	if (!pool || !fcn || !(task = R_NEW0 (RThreadTask))) {
+		return NULL;
+	}
+	task->fcn = fcn;
+	task->user = user;
+	w = pool_self (pool);
+	if (!deque_push (w? &w->deque: pool->inject, task)) {
+		free (task);
+		return NULL;
+	}
+	r_th_lock_enter (pool->lock);
+	if (pool->sleeping || pool->waiting) {
+		r_th_cond_signal_all (pool->cond);
+	}
+	r_th_lock_leave (pool->lock);
+	return task;
+}
+
+R_API bool r_th_task_done(RThreadPool *pool, RThreadTask *task) {
+	bool done;
+	r_th_lock_enter (pool->lock);
+	done = task->done;
+	r_th_lock_leave (pool->lock);
+	return done;
+}
+
+/* wait for the task running other ones meanwhile, returns its result
+ * and releases it */
+R_API void *r_th_task_join(RThreadPool *pool, RThreadTask *task) {
+	RThreadWorker *w;
+	void *result;
+	if (!pool || !task) {
+		return NULL;
+	}
+	w = pool_self (pool);
+	while (!r_th_task_done (pool, task)) {
+		RThreadTask *t = pool_take (pool, w);
+		if (!t) {
+			r_th_lock_enter (pool->lock);
+			if (!task->done && !(t = pool_take (pool, w))) {
+				pool->waiting++;
+				r_th_cond_wait (pool->cond, pool->lock);
+				pool->waiting--;
+			}
+			r_th_lock_leave (pool->lock);
+		}
+		if (t) {
+			task_run (pool, t);
+		}
+	}
+	result = task->result;
+	free (task);
+	return result;
+}
+
+static void *for_chunk(void *user) {
+	ForChunk *c = user;
+	c->cb (c->user, c->from, c->to);
+	return NULL;
+}
+
+/* call cb (user, from, to) over [from, to) split in grain sized ranges,
+ * a grain of 0 gives every worker a few of them. Returns when all are done */
+R_API void r_th_pool_for(RThreadPool *pool, ut64 from, ut64 to, ut64 grain, RThreadForCallback cb, void *user) {
+	ForChunk *chunks;
+	RThreadTask **tasks;
+	ut64 i, n;
+	if (!pool || !cb || from >= to) {
+		return;
+	}
+	if (!grain) {
+		grain = R_MAX ((to - from) / (pool->size * 4), 1);
+	}
+	n = (to - from - 1) / grain + 1;
+	chunks = calloc (n, sizeof (ForChunk));
+	tasks = calloc (n, sizeof (RThreadTask *));
+	if (!chunks || !tasks) {
+		free (chunks);
+		free (tasks);
+		cb (user, from, to);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		ForChunk *c = &chunks[i];
+		c->cb = cb;
+		c->user = user;
+		c->from = from + i * grain;
+		c->to = (to - c->from > grain)? c->from + grain: to;
+		if (!(tasks[i] = r_th_pool_submit (pool, for_chunk, c))) {
+			for_chunk (c);
+		}
+	}
+	for (i = 0; i < n; i++) {
+		r_th_task_join (pool, tasks[i]);
+	}
+	free (chunks);
+	free (tasks);
+}
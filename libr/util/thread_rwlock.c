@@ -0,0 +1,103 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+#include <r_th.h>
+
+/* reader/writer locks built on a lock and a condition variable.
+ *
+ * Readers share the lock, a writer owns it alone. Readers are preferred:
+ * they only wait while a writer holds the lock, so a thread can nest read
+ * sections even when a writer is queued. The writer can enter again, and
+ * its read sections count as write ones. Upgrading a read section to a
+ * write one is not supported and deadlocks, take the write lock upfront.
+ * A NULL lock does nothing */
+
+static ut64 rwlock_self(void) {
+#if HAVE_PTHREAD
+	return (ut64)(size_t)pthread_self ();
+#elif __WINDOWS__ && !defined(__CYGWIN__)
+	return (ut64)GetCurrentThreadId ();
+#else
+	return 0;
+#endif
+}
+
+R_API RThreadRWLock *r_th_rwlock_new(void) {
+	RThreadRWLock *rw = R_NEW0 (RThreadRWLock);
+	if (!rw) {
+		return NULL;
+	}
+	rw->lock = r_th_lock_new (false);
+	rw->cond = r_th_cond_new ();
+	if (!rw->lock || !rw->cond) {
+		r_th_rwlock_free (rw);
+		return NULL;
+	}
+	return rw;
+}
+
+R_API void r_th_rwlock_free(RThreadRWLock *rw) {
+	if (rw) {
+		r_th_cond_free (rw->cond);
+		r_th_lock_free (rw->lock);
+		free (rw);
+	}
+}
+
+R_API void r_th_rwlock_read_enter(RThreadRWLock *rw) {
+	ut64 self = rwlock_self ();
+	if (!rw) {
+		return;
+	}
+	r_th_lock_enter (rw->lock);
+	if (rw->writers && rw->owner == self) {
+		rw->writers++;
+	} else {
+		while (rw->writers) {
+			r_th_cond_wait (rw->cond, rw->lock);
+		}
+		rw->readers++;
+	}
+	r_th_lock_leave (rw->lock);
+}
+
+R_API void r_th_rwlock_read_leave(RThreadRWLock *rw) {
+	ut64 self = rwlock_self ();
+	if (!rw) {
+		return;
+	}
+	r_th_lock_enter (rw->lock);
+	if (rw->writers && rw->owner == self) {
+		rw->writers--;
+	} else if (rw->readers > 0 && !--rw->readers) {
+		r_th_cond_signal_all (rw->cond);
+	}
+	r_th_lock_leave (rw->lock);
+}
+
+R_API void r_th_rwlock_write_enter(RThreadRWLock *rw) {
+	ut64 self = rwlock_self ();
+	if (!rw) {
+		return;
+	}
+	r_th_lock_enter (rw->lock);
+	if (!rw->writers || rw->owner != self) {
+		while (rw->writers || rw->readers) {
+			r_th_cond_wait (rw->cond, rw->lock);
+		}
+		rw->owner = self;
+	}
+	rw->writers++;
+	r_th_lock_leave (rw->lock);
+}
+
+R_API void r_th_rwlock_write_leave(RThreadRWLock *rw) {
+	if (!rw) {
+		return;
+	}
+	r_th_lock_enter (rw->lock);
+	if (rw->writers > 0 && !--rw->writers) {
+		rw->owner = 0;
+		r_th_cond_signal_all (rw->cond);
+	}
+	r_th_lock_leave (rw->lock);
+}
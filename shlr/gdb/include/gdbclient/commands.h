@@ -25,6 +25,11 @@ int gdbr_disconnect(libgdbr_t *g);
  */
 void gdbr_invalidate_reg_cache(void);
 
+/*!
+ * \brief drops the memory pages cached since the target last ran
+ */
+void gdbr_invalidate_mem_cache(void);
+
 /*!
  * \brief gets reason why remote target stopped
  */
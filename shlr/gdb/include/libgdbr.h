@@ -173,6 +173,7 @@ typedef struct libgdbr_t {
 	int pid; // little endian
 	int tid; // little endian
 	int page_size; // page size for target (useful for qemu)
+	int readahead; // pages fetched past memory reads, -1 disables the cache
 	bool attached; // Remote server attached to process or created
 	libgdbr_stub_features_t stub_features;
 
@@ -78,6 +78,82 @@ static void reg_cache_init(libgdbr_t *g) {
 	}
 }
 
+/* memory pages read since the target last ran, direct mapped by address.
+ * Bumping the epoch drops all of them at once */
+#define MEM_CACHE_PAGES 64
+
+static struct {
+	ut8 *buf;
+	ut64 addr[MEM_CACHE_PAGES];
+	ut32 epoch[MEM_CACHE_PAGES];
+	bool unmapped[MEM_CACHE_PAGES]; // the stub refused to read it
+	ut32 cur_epoch;
+	int page_size;
+} mem_cache;
+
+static bool mem_cache_init(libgdbr_t *g) {
+	if (g->page_size < 1 || (g->page_size & (g->page_size - 1))) {
+		return false;
+	}
+	if (mem_cache.buf && mem_cache.page_size == g->page_size) {
+		return true;
+	}
+	free (mem_cache.buf);
+	memset (&mem_cache, 0, sizeof (mem_cache));
+	mem_cache.cur_epoch = 1;
+	if (!(mem_cache.buf = malloc (MEM_CACHE_PAGES * g->page_size))) {
+		return false;
+	}
+	mem_cache.page_size = g->page_size;
+	return true;
+}
+
+static inline int mem_cache_slot(ut64 page) {
+	return (page / mem_cache.page_size) % MEM_CACHE_PAGES;
+}
+
+static bool mem_cache_has(ut64 page) {
+	int slot = mem_cache_slot (page);
+	return mem_cache.epoch[slot] == mem_cache.cur_epoch && mem_cache.addr[slot] == page;
+}
+
+static ut8 *mem_cache_find(ut64 page) {
+	int slot = mem_cache_slot (page);
+	if (mem_cache_has (page) && !mem_cache.unmapped[slot]) {
+		return mem_cache.buf + slot * mem_cache.page_size;
+	}
+	return NULL;
+}
+
+/* data is NULL for pages that cannot be read */
+static void mem_cache_store(ut64 page, const ut8 *data) {
+	int slot = mem_cache_slot (page);
+	if (data) {
+		memcpy (mem_cache.buf + slot * mem_cache.page_size, data, mem_cache.page_size);
+	}
+	mem_cache.unmapped[slot] = !data;
+	mem_cache.addr[slot] = page;
+	mem_cache.epoch[slot] = mem_cache.cur_epoch;
+}
+
+static void mem_cache_drop(ut64 address, ut64 len) {
+	ut64 page;
+	if (!mem_cache.buf) {
+		return;
+	}
+	page = address & ~(ut64)(mem_cache.page_size - 1);
+	for (; page < address + len; page += mem_cache.page_size) {
+		int slot = mem_cache_slot (page);
+		if (mem_cache.addr[slot] == page) {
+			mem_cache.epoch[slot] = 0;
+		}
+	}
+}
+
+void gdbr_invalidate_mem_cache() {
+	mem_cache.cur_epoch++;
+}
+
 static int gdbr_connect_lldb(libgdbr_t *g) {
 	reg_cache_init (g);
 	if (g->stub_features.qXfer_features_read) {
@@ -105,7 +181,7 @@ int gdbr_connect(libgdbr_t *g, const char *host, int port) {
 	// Initial max_packet_size for remote target (minimum so far for AVR = 64)
 	g->stub_features.pkt_sz = 64;
 	char *env_pktsz_str;
-	ut32 env_pktsz;
+	ut32 env_pktsz = 0;
 	if ((env_pktsz_str = r_sys_getenv ("R2_GDB_PKTSZ"))) {
 		if ((env_pktsz = (ut32) strtoul (env_pktsz_str, NULL, 10))) {
 			g->stub_features.pkt_sz = R_MAX (env_pktsz, GDB_MAX_PKTSZ);
@@ -200,6 +276,7 @@ int gdbr_disconnect(libgdbr_t *g) {
 	reg_cache.valid = false;
 	g->stop_reason.is_valid = false;
 	free (reg_cache.buf);
+	R_FREE (mem_cache.buf);
 	if (g->target.valid) {
 		free (g->target.regprofile);
 		free (g->registers);
@@ -211,6 +288,9 @@ int gdbr_disconnect(libgdbr_t *g) {
 int gdbr_select(libgdbr_t *g, int pid, int tid) {
 	char cmd[64] = { 0 };
 	reg_cache.valid = false;
+	if (pid != g->pid) {
+		gdbr_invalidate_mem_cache ();
+	}
 	g->pid = pid;
 	g->tid = tid;
 	strcpy (cmd, "Hg");
@@ -309,6 +389,7 @@ int gdbr_attach(libgdbr_t *g, int pid) {
 	}
 	g->stop_reason.is_valid = false;
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 
 	if (g->stub_features.extended_mode == -1) {
 		gdbr_check_extended_mode (g);
@@ -350,6 +431,7 @@ int gdbr_detach(libgdbr_t *g) {
 		return -1;
 	}
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 	g->stop_reason.is_valid = false;
 	ret = send_msg (g, "D");
 	if (ret < 0) {
@@ -368,6 +450,7 @@ int gdbr_detach_pid(libgdbr_t *g, int pid) {
 		return -1;
 	}
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 	g->stop_reason.is_valid = false;
 
 	buffer_size = strlen (CMD_DETACH_MP) + (sizeof (pid) * 2) + 1;
@@ -404,6 +487,7 @@ bool gdbr_kill(libgdbr_t *g) {
 		return false;
 	}
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 	g->stop_reason.is_valid = false;
 
 	if (g->stub_features.multiprocess) {
@@ -429,6 +513,7 @@ bool gdbr_kill_pid(libgdbr_t *g, int pid) {
 		return false;
 	}
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 	g->stop_reason.is_valid = false;
 
 	buffer_size = strlen (CMD_KILL_MP) + (sizeof (pid) * 2) + 1;
@@ -570,7 +655,7 @@ static int gdbr_read_memory_page(libgdbr_t *g, ut64 address, ut8 *buf, int len)
 	return ret_len;
 }
 
-int gdbr_read_memory(libgdbr_t *g, ut64 address, ut8 *buf, int len) {
+static int read_memory_pages(libgdbr_t *g, ut64 address, ut8 *buf, int len) {
 	int ret_len, ret, tmp;
 	int page_size = g->page_size;
 	ret_len = 0;
@@ -606,6 +691,70 @@ int gdbr_read_memory(libgdbr_t *g, ut64 address, ut8 *buf, int len) {
 	return ret_len + ret;
 }
 
+/* fetch the pages in [from, to) with as few packets as possible. If the
+ * stub refuses the whole run, only the pages up to need are retried one by
+ * one so an unmapped page does not hide the readable ones. Unreadable pages
+ * are remembered too until the target runs again */
+static void mem_cache_fill(libgdbr_t *g, ut64 from, ut64 to, ut64 need) {
+	const int ps = mem_cache.page_size;
+	ut8 *tmp = malloc (to - from);
+	ut64 page;
+	if (!tmp) {
+		return;
+	}
+	if (gdbr_read_memory_page (g, from, tmp, to - from) == to - from) {
+		for (page = from; page < to; page += ps) {
+			mem_cache_store (page, tmp + (page - from));
+		}
+	} else if (to - from > ps) {
+		for (page = from; page < need; page += ps) {
+			bool ok = gdbr_read_memory_page (g, page, tmp, ps) == ps;
+			mem_cache_store (page, ok? tmp: NULL);
+		}
+	} else {
+		mem_cache_store (from, NULL);
+	}
+	free (tmp);
+}
+
+int gdbr_read_memory(libgdbr_t *g, ut64 address, ut8 *buf, int len) {
+	ut64 page, end = address + len;
+	int ps, ret_len = 0;
+	if (!g || len < 1) {
+		return -1;
+	}
+	if (g->readahead < 0 || !mem_cache_init (g)) {
+		return read_memory_pages (g, address, buf, len);
+	}
+	ps = mem_cache.page_size;
+	page = address & ~(ut64)(ps - 1);
+	while (page < end) {
+		ut64 from = R_MAX (page, address);
+		ut64 to = R_MIN (page + ps, end);
+		ut8 *data = mem_cache_find (page);
+		if (!data && !mem_cache_has (page)) {
+			ut64 run = page + ps;
+			ut64 max = page + (ut64)MEM_CACHE_PAGES * ps;
+			while (run < end && run < max && !mem_cache_has (run)) {
+				run += ps;
+			}
+			ut64 need = run;
+			if (run >= end) {
+				run = R_MIN (run + (ut64)g->readahead * ps, max);
+			}
+			mem_cache_fill (g, page, run, need);
+			data = mem_cache_find (page);
+		}
+		if (!data) {
+			break;
+		}
+		memcpy (buf + (from - address), data + (from - page), to - from);
+		ret_len += to - from;
+		page += ps;
+	}
+	return ret_len? ret_len: -1;
+}
+
 int gdbr_write_memory(libgdbr_t *g, ut64 address, const uint8_t *data, ut64 len) {
 	int ret = 0;
 	int command_len, pkt, max_cmd_len = 64;
@@ -614,6 +763,7 @@ int gdbr_write_memory(libgdbr_t *g, ut64 address, const uint8_t *data, ut64 len)
 	if (!g || !data) {
 		return -1;
 	}
+	mem_cache_drop (address, len);
 	g->stub_features.pkt_sz = R_MAX (g->stub_features.pkt_sz, GDB_MAX_PKTSZ);
 	data_sz = g->stub_features.pkt_sz / 2;
 	if (data_sz < 1) {
@@ -940,6 +1090,7 @@ int send_vcont(libgdbr_t *g, const char *command, const char *thread_id) {
 	}
 	reg_cache.valid = false;
 	g->stop_reason.is_valid = false;
+	gdbr_invalidate_mem_cache ();
 	ret = send_msg (g, tmp);
 	if (ret < 0) {
 		return ret;
@@ -1159,6 +1310,7 @@ int gdbr_send_qRcmd(libgdbr_t *g, const char *cmd, void (*cb_printf) (const char
 	strcpy (buf, "qRcmd,");
 	g->stop_reason.is_valid = false;
 	reg_cache.valid = false;
+	gdbr_invalidate_mem_cache ();
 	pack_hex (cmd, strlen (cmd), buf + 6);
 	if (send_msg (g, buf) < 0) {
 		free (buf);
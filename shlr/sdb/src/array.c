@@ -1,6 +1,7 @@
 /* sdb - MIT - Copyright 2011-2016 - pancake */
 
 #include "sdb.h"
+#include <ctype.h>
 #include <limits.h>
 
 // TODO: Push should always prepend. do not make this configurable
@@ -62,6 +63,189 @@ static inline int int_cmp(const void *a, const void *b) {
 	return 0;
 } 
 
+/* numeric arrays are used as sets of addresses (xrefs, bb lists..) which
+ * grow one number at a time. Checking and appending on the string means
+ * parsing and copying all of it on every add, so the array api keeps a
+ * parsed copy in the kv and appends to the value in place. The string is
+ * still the real value, the index is dropped as soon as the cas changes */
+
+#define AINDEX_SET_MIN 16
+
+SDB_API void sdb_array_index_free(SdbArrayIndex *ai) {
+	if (ai) {
+		free (ai->nums);
+		free (ai->set);
+		free (ai);
+	}
+}
+
+static inline ut32 aindex_hash(ut64 n) {
+	n ^= n >> 33;
+	n *= 0xff51afd7ed558ccdULL;
+	n ^= n >> 33;
+	return (ut32)n;
+}
+
+static bool aindex_set_has(SdbArrayIndex *ai, ut64 n) {
+	ut32 mask = ai->set_size - 1;
+	ut32 i = aindex_hash (n) & mask;
+	if (n == UT64_MAX) {
+		return ai->set_max;
+	}
+	while (ai->set[i] != UT64_MAX) {
+		if (ai->set[i] == n) {
+			return true;
+		}
+		i = (i + 1) & mask;
+	}
+	return false;
+}
+
+static void aindex_set_add(SdbArrayIndex *ai, ut64 n) {
+	ut32 mask = ai->set_size - 1;
+	ut32 i = aindex_hash (n) & mask;
+	if (n == UT64_MAX) {
+		ai->set_max = true;
+		return;
+	}
+	while (ai->set[i] != UT64_MAX) {
+		if (ai->set[i] == n) {
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	ai->set[i] = n;
+}
+
+static bool aindex_set_build(SdbArrayIndex *ai) {
+	ut32 i, size = AINDEX_SET_MIN;
+	while (size < ai->count * 2 + 2) {
+		size <<= 1;
+	}
+	free (ai->set);
+	ai->set = malloc (size * sizeof (ut64));
+	if (!ai->set) {
+		ai->set_size = 0;
+		return false;
+	}
+	memset (ai->set, 0xff, size * sizeof (ut64));
+	ai->set_size = size;
+	ai->set_max = false;
+	for (i = 0; i < ai->count; i++) {
+		aindex_set_add (ai, ai->nums[i]);
+	}
+	return true;
+}
+
+static bool aindex_has(SdbArrayIndex *ai, ut64 n) {
+	ut32 i;
+	if (ai->set) {
+		return aindex_set_has (ai, n);
+	}
+	for (i = 0; i < ai->count; i++) {
+		if (ai->nums[i] == n) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool aindex_push(SdbArrayIndex *ai, ut64 n) {
+	if (ai->count == ai->size) {
+		ut32 size = ai->size? ai->size * 2: AINDEX_SET_MIN;
+		ut64 *nums = realloc (ai->nums, size * sizeof (ut64));
+		if (!nums) {
+			return false;
+		}
+		ai->nums = nums;
+		ai->size = size;
+	}
+	ai->nums[ai->count++] = n;
+	/* without a set lookups just fall back to the linear scan */
+	if (ai->set) {
+		/* keep the set at most half full */
+		if (ai->count * 2 > ai->set_size) {
+			aindex_set_build (ai);
+		} else {
+			aindex_set_add (ai, n);
+		}
+	} else if (ai->count >= AINDEX_SET_MIN) {
+		aindex_set_build (ai);
+	}
+	return true;
+}
+
+/* index of the numeric array at key, NULL if it is empty or not numeric */
+static SdbArrayIndex *aindex_get(Sdb *s, const char *key, SdbKv **pkv) {
+	SdbArrayIndex *ai;
+	const char *p;
+	char *end;
+	bool found;
+	SdbKv *kv = sdb_ht_find_kvp (s->ht, key, &found);
+	if (!found || !kv || !kv->value || !*kv->value) {
+		return NULL;
+	}
+	if (s->timestamped && kv->expire) {
+		/* let the slow path deal with expiration */
+		return NULL;
+	}
+	*pkv = kv;
+	if (kv->array && kv->array->cas == kv->cas) {
+		return kv->array;
+	}
+	sdb_array_index_free (kv->array);
+	kv->array = NULL;
+	if (!(ai = calloc (1, sizeof (SdbArrayIndex)))) {
+		return NULL;
+	}
+	for (p = kv->value; ; p = end + 1) {
+		ut64 n;
+		if (!isdigit ((ut8)*p)) {
+			sdb_array_index_free (ai);
+			return NULL;
+		}
+		n = strtoull (p, &end, 0);
+		if ((*end != SDB_RS && *end) || !aindex_push (ai, n)) {
+			sdb_array_index_free (ai);
+			return NULL;
+		}
+		if (!*end) {
+			break;
+		}
+	}
+	ai->cas = kv->cas;
+	ai->capacity = kv->value_len + 1;
+	kv->array = ai;
+	return ai;
+}
+
+/* append n to the value in place and bump the cas, returns it */
+static ut32 aindex_append(Sdb *s, SdbKv *kv, SdbArrayIndex *ai, ut64 n) {
+	char buf[SDB_NUM_BUFSZ];
+	const char *str = sdb_itoa (n, buf, SDB_NUM_BASE);
+	ut32 len = strlen (str);
+	ut32 need = kv->value_len + len + 2;
+	if (need >= SDB_VSZ) {
+		return 0;
+	}
+	if (need > ai->capacity) {
+		ut32 capacity = R_MAX (need, ai->capacity * 2);
+		char *value = realloc (kv->value, capacity);
+		if (!value) {
+			return 0;
+		}
+		kv->value = value;
+		ai->capacity = capacity;
+	}
+	if (!aindex_push (ai, n)) {
+		return 0;
+	}
+	kv->value[kv->value_len] = SDB_RS;
+	memcpy (kv->value + kv->value_len + 1, str, len + 1);
+	kv->value_len += len + 1;
+	return ai->cas = sdb_kv_touch (s, kv);
+}
+
 SDB_API ut64 sdb_array_get_num(Sdb *s, const char *key, int idx, ut32 *cas) {
 	int i;
 	const char *n, *str = sdb_const_get (s, key, cas);
@@ -212,9 +396,16 @@ SDB_API int sdb_array_set_num(Sdb *s, const char *key, int idx, ut64 val,
 SDB_API int sdb_array_add_num(Sdb *s, const char *key, ut64 val, ut32 cas) {
 	char valstr10[SDB_NUM_BUFSZ], valstr16[SDB_NUM_BUFSZ];
 	char *v10 = sdb_itoa (val, valstr10, 10);
-	char *v16 = sdb_itoa (val, valstr16, 16);
-	// TODO: optimize
-	// TODO: check cas vs mycas
+	char *v16;
+	SdbKv *kv = NULL;
+	SdbArrayIndex *ai = aindex_get (s, key, &kv);
+	if (ai) {
+		if ((cas && cas != kv->cas) || aindex_has (ai, val)) {
+			return 0;
+		}
+		return aindex_append (s, kv, ai, val);
+	}
+	v16 = sdb_itoa (val, valstr16, 16);
 	if (sdb_array_contains (s, key, v10, NULL)) {
 		return 0;
 	}
@@ -341,6 +532,14 @@ SDB_API bool sdb_array_append(Sdb *s, const char *key, const char *val,
 }
 
 SDB_API bool sdb_array_append_num(Sdb *s, const char *key, ut64 val, ut32 cas) {
+	SdbKv *kv = NULL;
+	SdbArrayIndex *ai = aindex_get (s, key, &kv);
+	if (ai) {
+		if (cas && cas != kv->cas) {
+			return false;
+		}
+		return aindex_append (s, kv, ai, val) != 0;
+	}
 	return sdb_array_set_num (s, key, -1, val, cas);
 }
 
@@ -494,7 +693,16 @@ SDB_API int sdb_array_delete(Sdb *s, const char *key, int idx, ut32 cas) {
 SDB_API int sdb_array_contains_num(Sdb *s, const char *key, ut64 num,
 				    ut32 *cas) {
 	char val[SDB_NUM_BUFSZ];
-	char *nval = sdb_itoa (num, val, SDB_NUM_BASE);
+	char *nval;
+	SdbKv *kv = NULL;
+	SdbArrayIndex *ai = aindex_get (s, key, &kv);
+	if (ai) {
+		if (cas) {
+			*cas = kv->cas;
+		}
+		return aindex_has (ai, num);
+	}
+	nval = sdb_itoa (num, val, SDB_NUM_BASE);
 	return sdb_array_contains (s, key, nval, cas);
 }
 
@@ -3,26 +3,12 @@
 #include "ht.h"
 #include "sdb.h"
 
-// Sizes of the ht.
-const int ht_primes_sizes[] = {
-#if GROWABLE
-	3, 7, 11, 17, 23, 29, 37, 47, 59, 71, 89, 107, 131,
-	163, 197, 239, 293, 353, 431, 521, 631, 761, 919,
-	1103, 1327, 1597, 1931, 2333, 2801, 3371, 4049, 4861,
-	5839, 7013, 8419, 10103, 12143, 14591, 17519, 21023,
-	25229, 30293, 36353, 43627, 52361, 62851, 75431, 90523,
-	108631, 130363, 156437, 187751, 225307, 270371, 324449,
-	389357, 467237, 560689, 672827, 807403, 968897, 1162687,
-	1395263, 1674319, 2009191, 2411033, 2893249, 3471899,
-	4166287, 4999559, 5999471, 7199369
-#else
-	1024,
-#endif
-};
-
+#define HT_MIN_SIZE 16
+/* grow the slots past 80% of load */
+#define HT_FULL(ht, n) ((ut64)(n) * 5 >= (ut64)(ht)->size * 4)
 
 // Create a new hashtable and return a pointer to it.
-// size - number of buckets in the hashtable
+// size - initial number of slots, a power of two
 // hashfunction - the function that does the hashing, must not be null.
 // comparator - the function to check if values are equal, if NULL, just checks
 // == (for storing ints).
@@ -40,73 +26,153 @@ static SdbHash* internal_ht_new(ut32 size, HashFunction hashfunction,
 	}
 	ht->size = size;
 	ht->count = 0;
-	ht->prime_idx = 0;
-	ht->load_factor = 1;
 	ht->hashfn = hashfunction;
 	ht->cmp = (ListComparator)strcmp;
 	ht->dupkey = keydup? keydup: (DupKey)strdup;
-	ht->dupvalue = valdup? valdup: NULL; 
-	ht->table = calloc (ht->size, sizeof (SdbList*));
+	ht->dupvalue = valdup? valdup: NULL;
+	ht->slots = calloc (ht->size, sizeof (HtSlot));
 	ht->calcsizeK = calcsizeK? calcsizeK: (CalcSize)strlen;
 	ht->calcsizeV = calcsizeV? calcsizeV: NULL;
 	ht->freefn = pair_free;
-	ht->deleted = ls_newf (free);
-#if INSERTORDER
-	ht->list = ls_newf (NULL);
-#endif
-	// Because we use calloc, each listptr will be NULL until used */
+	if (!ht->slots) {
+		free (ht);
+		return NULL;
+	}
 	return ht;
 }
 
-bool ht_delete_internal(SdbHash* ht, const char* key, ut32* hash) {
-	HtKv* kv;
-	SdbListIter* iter;
-	ut32 computed_hash = hash ? *hash : ht->hashfn (key);
-#if USE_KEYLEN
-	ut32 key_len = ht->calcsizeK ((void *)key);
-#endif
-	ut32 bucket = computed_hash % ht->size;
-#if INSERTORDER
-	ls_foreach (ht->list, iter, kv) {
-#if USE_KEYLEN
-		if (key_len != kv->key_len) {
-			continue;
+/* sdb_hash is weak in the low bits, which are the ones picking the slot */
+static inline ut32 ht_home(SdbHash *ht, ut32 hash) {
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+	return hash & (ht->size - 1);
+}
+
+static inline ut32 ht_dist(SdbHash *ht, ut32 slot, ut32 hash) {
+	return (slot - ht_home (ht, hash)) & (ht->size - 1);
+}
+
+static void ht_slot_insert(SdbHash *ht, ut32 hash, ut32 pos) {
+	ut32 mask = ht->size - 1;
+	ut32 i = ht_home (ht, hash);
+	ut32 dist = 0;
+	for (;;) {
+		HtSlot *slot = &ht->slots[i];
+		ut32 d;
+		if (!slot->pos) {
+			slot->hash = hash;
+			slot->pos = pos;
+			return;
 		}
-#endif
-		if (key == kv->key || !ht->cmp (key, kv->key)) {
-			ls_delete (ht->list, iter);
-			ht->count--;
-			break;
+		d = ht_dist (ht, i, slot->hash);
+		if (d < dist) {
+			/* take the place of the richer one and move it forward */
+			HtSlot tmp = *slot;
+			slot->hash = hash;
+			slot->pos = pos;
+			hash = tmp.hash;
+			pos = tmp.pos;
+			dist = d;
 		}
+		i = (i + 1) & mask;
+		dist++;
 	}
-#endif
-	SdbList* list = ht->table[bucket];
-	ls_foreach (list, iter, kv) {
-#if USE_KEYLEN
-		if (key_len != kv->key_len) {
-			continue;
+}
+
+/* move the slots into a table of the given size, using the cached hashes */
+static bool ht_rehash(SdbHash *ht, ut32 size) {
+	HtSlot *old = ht->slots;
+	ut32 i, oldsize = ht->size;
+	HtSlot *slots = calloc (size, sizeof (HtSlot));
+	if (!slots) {
+		return false;
+	}
+	ht->slots = slots;
+	ht->size = size;
+	for (i = 0; i < oldsize; i++) {
+		if (old[i].pos) {
+			ht_slot_insert (ht, old[i].hash, old[i].pos);
 		}
-#endif
-		if (key == kv->key || !ht->cmp (key, kv->key)) {
-#if EXCHANGE
-			ls_split_iter (list, iter);
-			ls_append (ht->deleted, iter);
-			if (list->free) {
-				list->free (iter->data);
+	}
+	free (old);
+	return true;
+}
+
+/* drop the holes left by deleted items, only when nobody walks the entries
+ * and they are a quarter of them, so the rehash is amortized over deletes */
+static void ht_compact(SdbHash *ht) {
+	ut32 i, n = 0;
+	if (ht->busy || ht->nentries - ht->count < ht->nentries / 4
+			|| ht->nentries == ht->count) {
+		return;
+	}
+	for (i = 0; i < ht->nentries; i++) {
+		if (ht->entries[i]) {
+			ht->entries[n++] = ht->entries[i];
+		}
+	}
+	ht->nentries = n;
+	/* the positions changed, so the keys are hashed again */
+	memset (ht->slots, 0, ht->size * sizeof (HtSlot));
+	for (i = 0; i < n; i++) {
+		ht_slot_insert (ht, ht->hashfn (ht->entries[i]->key), i + 1);
+	}
+}
+
+/* slot holding key, or -1 */
+static int ht_lookup(SdbHash *ht, const char *key, ut32 hash) {
+	ut32 mask = ht->size - 1;
+	ut32 i = ht_home (ht, hash);
+	ut32 dist = 0;
+	ut32 key_len = ht->calcsizeK ((void *)key);
+	for (;;) {
+		HtSlot *slot = &ht->slots[i];
+		if (!slot->pos || ht_dist (ht, i, slot->hash) < dist) {
+			return -1;
+		}
+		if (slot->hash == hash) {
+			HtKv *kv = ht->entries[slot->pos - 1];
+			if (kv->key_len == key_len && (key == kv->key || !ht->cmp (key, kv->key))) {
+				return i;
 			}
-			iter->data = NULL;
-#else
-			ls_delete (list, iter);
-#endif
-			ht->count--;
-			return true;
 		}
+		i = (i + 1) & mask;
+		dist++;
 	}
-	return false;
+}
+
+bool ht_delete_internal(SdbHash* ht, const char* key, ut32* hash) {
+	ut32 computed_hash, mask, i, j;
+	int slot;
+	HtKv *kv;
+	if (!ht || !key) {
+		return false;
+	}
+	computed_hash = hash ? *hash : ht->hashfn (key);
+	slot = ht_lookup (ht, key, computed_hash);
+	if (slot < 0) {
+		return false;
+	}
+	i = slot;
+	kv = ht->entries[ht->slots[i].pos - 1];
+	ht->entries[ht->slots[i].pos - 1] = NULL;
+	/* backward shift, no tombstones in the slots */
+	mask = ht->size - 1;
+	for (j = (i + 1) & mask; ht->slots[j].pos && ht_dist (ht, j, ht->slots[j].hash); j = (j + 1) & mask) {
+		ht->slots[i] = ht->slots[j];
+		i = j;
+	}
+	ht->slots[i].pos = 0;
+	ht->count--;
+	if (ht->freefn) {
+		ht->freefn (kv);
+	}
+	return true;
 }
 
 SdbHash* ht_new(DupValue valdup, HtKvFreeFunc pair_free, CalcSize calcsizeV) {
-	return internal_ht_new (ht_primes_sizes[0], (HashFunction)sdb_hash, 
+	return internal_ht_new (HT_MIN_SIZE, (HashFunction)sdb_hash,
 	  			(ListComparator)strcmp, (DupKey)strdup,
 				valdup, pair_free, (CalcSize)strlen, calcsizeV);
 }
@@ -114,80 +180,63 @@ SdbHash* ht_new(DupValue valdup, HtKvFreeFunc pair_free, CalcSize calcsizeV) {
 void ht_free(SdbHash* ht) {
 	if (ht) {
 		ut32 i;
-		for (i = 0; i < ht->size; i++) {
-			ls_free (ht->table[i]);
+		if (ht->freefn) {
+			for (i = 0; i < ht->nentries; i++) {
+				if (ht->entries[i]) {
+					ht->freefn (ht->entries[i]);
+				}
+			}
 		}
-		free (ht->table);
-		ls_free (ht->deleted);
-#if INSERTORDER
-		ls_free (ht->list);
-#endif
+		free (ht->entries);
+		free (ht->slots);
 		free (ht);
 	}
 }
 
 void ht_free_deleted(SdbHash* ht) {
-	if (!ls_empty (ht->deleted)) {
-		ls_free (ht->deleted);
-		ht->deleted = ls_newf (free);
-	}
-}
-
-// Increases the size of the hashtable by 2.
-#if GROWABLE
-static void internal_ht_grow(SdbHash* ht) {
-	SdbHash* ht2;
-	SdbHash swap;
-	HtKv* kv;
-	SdbListIter* iter;
-	ut32 i, sz = ht_primes_sizes[ht->prime_idx];
-	ht2 = internal_ht_new (sz, ht->hashfn, ht->cmp, ht->dupkey,
-			ht->dupvalue, (HtKvFreeFunc)ht->freefn, ht->calcsize);
-	ht2->prime_idx = ht->prime_idx;
-	for (i = 0; i < ht->size; i++) {
-		ls_foreach (ht->table[i], iter, kv) {
-			(void)ht_insert (ht2, kv->key, kv->value);
-		}
+	if (ht) {
+		ht_compact (ht);
 	}
-	// And now swap the internals.
-	swap = *ht;
-	*ht = *ht2;
-	*ht2 = swap;
-	ht_free (ht2);
 }
-#endif
 
 static bool internal_ht_insert_kv(SdbHash *ht, HtKv *kv, bool update) {
-	bool found = false;
 	if (!ht || !kv) {
 		return false;
 	}
-	ut32 bucket, hash = ht->hashfn (kv->key);
-	if (update) {
-		(void)ht_delete_internal (ht, kv->key, &hash);
-	} else {
-		(void)ht_find (ht, kv->key, &found);
-	}
-	if (update || !found) {
-		bucket = hash % ht->size;
-		if (!ht->table[bucket]) {
-			ht->table[bucket] = ls_newf ((SdbListFree)ht->freefn);
+	ut32 hash = ht->hashfn (kv->key);
+	int slot = ht_lookup (ht, kv->key, hash);
+	if (slot >= 0) {
+		/* replaced in place, so walks do not see the key twice */
+		ut32 pos = ht->slots[slot].pos - 1;
+		HtKv *old = ht->entries[pos];
+		if (!update) {
+			return false;
 		}
-		ls_prepend (ht->table[bucket], kv);
-#if INSERTORDER
-		ls_append (ht->list, kv);
-#endif
-		ht->count++;
-#if GROWABLE
-		// Check if we need to grow the table.
-		if (ht->count >= ht->load_factor * ht_primes_sizes[ht->prime_idx]) {
-			ht->prime_idx++;
-			internal_ht_grow (ht);
+		ht->entries[pos] = kv;
+		if (ht->freefn && old != kv) {
+			ht->freefn (old);
 		}
-#endif
 		return true;
 	}
-	return false;
+	if (ht->nentries == ht->entries_size) {
+		ht_compact (ht);
+		if (ht->nentries == ht->entries_size) {
+			ut32 size = ht->entries_size? ht->entries_size * 2: HT_MIN_SIZE;
+			HtKv **entries = realloc (ht->entries, size * sizeof (HtKv *));
+			if (!entries) {
+				return false;
+			}
+			ht->entries = entries;
+			ht->entries_size = size;
+		}
+	}
+	if (HT_FULL (ht, ht->count + 1) && !ht_rehash (ht, ht->size * 2)) {
+		return false;
+	}
+	ht->entries[ht->nentries++] = kv;
+	ht_slot_insert (ht, hash, ht->nentries);
+	ht->count++;
+	return true;
 }
 
 static bool internal_ht_insert(SdbHash* ht, bool update, const char* key,
@@ -238,38 +287,21 @@ bool ht_update(SdbHash* ht, const char* key, void* value) {
 // If `found` is not NULL, it will be set to true if the entry was found, false
 // otherwise.
 HtKv* ht_find_kv(SdbHash* ht, const char* key, bool* found) {
-	if (!ht) {
-		return NULL;
+	int slot;
+	if (found) {
+		*found = false;
 	}
-	ut32 hash, bucket;
-	SdbListIter* iter;
-	HtKv* kv;
-#if USE_KEYLEN
-	if (!key) {
+	if (!ht || !key) {
 		return NULL;
 	}
-	ut32 key_len = ht->calcsizeK ((void *)key);
-#endif
-	hash = ht->hashfn (key);
-	bucket = hash % ht->size;
-	ls_foreach (ht->table[bucket], iter, kv) {
-#if USE_KEYLEN
-		if (key_len != kv->key_len) {
-			continue;
-		}
-#endif
-		bool match = !ht->cmp (key, kv->key);
-		if (match) {
-			if (found) {
-				*found = true;
-			}
-			return kv;
-		}
+	slot = ht_lookup (ht, key, ht->hashfn (key));
+	if (slot < 0) {
+		return NULL;
 	}
 	if (found) {
-		*found = false;
+		*found = true;
 	}
-	return NULL;
+	return ht->entries[ht->slots[slot].pos - 1];
 }
 
 // Looks up the corresponding value from the key.
@@ -289,21 +321,30 @@ bool ht_delete(SdbHash* ht, const char* key) {
 	return ht_delete_internal (ht, key, NULL);
 }
 
+HtKv* ht_next(SdbHash *ht, ut32 *pos) {
+	while (*pos < ht->nentries) {
+		HtKv *kv = ht->entries[(*pos)++];
+		if (kv) {
+			return kv;
+		}
+	}
+	return NULL;
+}
+
 void ht_foreach(SdbHash *ht, HtForeachCallback cb, void *user) {
+	ut32 pos = 0;
+	HtKv *kv;
 	if (!ht) {
 		return;
 	}
-	ut32 i = 0;
-	HtKv *kv;
-	SdbListIter *iter;
-	for (i = 0; i < ht->size; i++) {
-		ls_foreach (ht->table[i], iter, kv) {
-			if (!kv || !kv->key || !kv->value) {
-				continue;
-			}
-			if (!cb (user, kv->key, kv->value)) {
-				return;
-			}
+	ht->busy++;
+	while ((kv = ht_next (ht, &pos))) {
+		if (!kv->key || !kv->value) {
+			continue;
+		}
+		if (!cb (user, kv->key, kv->value)) {
+			break;
 		}
 	}
+	ht->busy--;
 }
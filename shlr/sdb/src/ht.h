@@ -6,12 +6,6 @@
 #include "ls.h"
 #include "types.h"
 
-/* tune the hashtable */
-#define INSERTORDER 0
-#define GROWABLE 0
-#define USE_KEYLEN 1
-#define EXCHANGE 1
-
 typedef struct ht_kv {
 	char *key;
 	void *value;
@@ -29,8 +23,16 @@ typedef bool (*HtForeachCallback)(void *user, const char *k, void *v);
 
 
 /** ht **/
+/* open addressing with robin hood probing. The slots only hold the hash and
+ * the position of the entry, the entries are kept in insertion order so the
+ * table can be walked while items are deleted from it */
+typedef struct ht_slot {
+	ut32 hash;
+	ut32 pos;		// position in entries + 1, 0 for empty slots
+} HtSlot;
+
 typedef struct ht_t {
-	ut32 size;	    	// size of the hash table in buckets.
+	ut32 size;	    	// number of slots, a power of two
 	ut32 count;	   	// number of stored elements.
 	ListComparator cmp;   	// Function for comparing values. Returns 0 if eq.
 	HashFunction hashfn;  	// Function for hashing items in the hash table.
@@ -39,13 +41,11 @@ typedef struct ht_t {
 	CalcSize calcsizeK;     // Function to determine the key's size
 	CalcSize calcsizeV;  	// Function to determine the value's size
 	HtKvFreeFunc freefn;  	// Function to free the keyvalue store
-	SdbList /*<SdbKv>*/** table;  // Actual table.
-	SdbList* deleted;
-	ut32 load_factor;  	// load factor before doubling in size.
-	ut32 prime_idx;
-#if INSERTORDER
-	SdbList* list;
-#endif
+	HtSlot *slots;
+	HtKv **entries;		// insertion order, NULL for deleted items
+	ut32 nentries;		// used entries, deleted ones included
+	ut32 entries_size;
+	ut32 busy;		// walks in progress, entries are not moved meanwhile
 } SdbHash;
 
 // Create a new RHashTable.
@@ -69,4 +69,7 @@ void* ht_find(SdbHash* ht, const char* key, bool* found);
 HtKv* ht_find_kv(SdbHash* ht, const char* key, bool* found);
 void ht_foreach(SdbHash *ht, HtForeachCallback cb, void *user);
 SdbList* ht_foreach_list(SdbHash *ht, bool sorted);
+// Walk the entries in insertion order, pos must start at 0. Items can be
+// inserted and deleted meanwhile, deleted ones are skipped.
+HtKv* ht_next(SdbHash *ht, ut32 *pos);
 #endif // __HT_H
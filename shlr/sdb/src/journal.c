@@ -1,43 +1,113 @@
-/* sdb - MIT - Copyright 2011-2016 - pancake */
+/* sdb - MIT - Copyright 2011-2018 - pancake */
 
 #include "sdb.h"
 #include <unistd.h>
 #include <fcntl.h>
 
+/* The journal holds the changes since the database file was last written,
+ * one "key=value" line each, with backslashes, newlines and the '=' of the
+ * key escaped. An empty value removes the key. Replaying it over the file
+ * gives the current state, so sdb_sync only needs to append to it. The
+ * journal only holds synced changes: the lines stay in journal_buf, which
+ * grows as needed, until sdb_journal_sync, and closing drops them */
+
+#define SDB_JOURNAL_BUFSZ 0x10000
+
 static const char *sdb_journal_filename(Sdb *s) {
-	return (s && s->name)
-		? sdb_fmt (0, "%s.journal", s->name)
-		: NULL;
+	const char *file = s? (s->dir? s->dir: s->name): NULL;
+	return file? sdb_fmt (0, "%s.journal", file): NULL;
+}
+
+/* append the pending lines, a failed write is cut back so the journal
+ * never ends with half of them */
+static bool journal_write(Sdb *s) {
+	int len = s->journal_len;
+	off_t end;
+	if (len < 1) {
+		return true;
+	}
+	end = lseek (s->journal, 0, SEEK_END);
+	if (end == -1) {
+		return false;
+	}
+	if (write (s->journal, s->journal_buf, len) != len) {
+		(void)ftruncate (s->journal, end);
+		return false;
+	}
+	s->journal_len = 0;
+	return true;
 }
 
 SDB_API bool sdb_journal_close(Sdb *s) {
+	const char *filename;
+	off_t size;
 	if (s->journal == -1) {
 		return false;
 	}
+	size = lseek (s->journal, 0, SEEK_END);
 	close (s->journal);
 	s->journal = -1;
-	unlink (sdb_journal_filename (s));
+	R_FREE (s->journal_buf);
+	s->journal_len = s->journal_size = 0;
+	/* the changes in it are not in the file yet */
+	filename = sdb_journal_filename (s);
+	if (!size && filename) {
+		unlink (filename);
+	}
 	return true;
 }
 
 SDB_API bool sdb_journal_open(Sdb *s) {
 	const char *filename;
-	if (!s || !s->name) {
+	if (!s) {
 		return false;
 	}
 	filename = sdb_journal_filename (s);
 	if (!filename) {
 		return false;
 	}
-	close (s->journal);
+	if (s->journal != -1) {
+		sdb_journal_close (s);
+	}
+	s->journal_buf = malloc (SDB_JOURNAL_BUFSZ);
+	if (!s->journal_buf) {
+		return false;
+	}
+	s->journal_len = 0;
+	s->journal_size = SDB_JOURNAL_BUFSZ;
 	s->journal = open (filename, O_CREAT | O_RDWR | O_APPEND, 0600);
-	return s->journal != -1;
+	if (s->journal == -1) {
+		R_FREE (s->journal_buf);
+		s->journal_size = 0;
+		return false;
+	}
+	return true;
+}
+
+/* undo the escapes of one line in place, *val gets the value */
+static bool journal_unescape(char *line, char **val) {
+	char *o = line, *p = line;
+	*val = NULL;
+	for (; *p; p++) {
+		if (*p == '\\' && p[1]) {
+			p++;
+			*o++ = (*p == 'n')? '\n': *p;
+		} else if (*p == '=' && !*val) {
+			*o++ = 0;
+			*val = o;
+		} else {
+			*o++ = *p;
+		}
+	}
+	*o = 0;
+	return *val != NULL;
 }
 
-// TODO boolify and save changes somewhere else? or just dont count that?
+/* replay the journal. A line cut by a crash is dropped from the file too,
+ * the next sync would append to it otherwise */
 SDB_API int sdb_journal_load(Sdb *s) {
 	int rr, sz, fd, changes = 0;
-	char *eq, *str, *cur, *ptr = NULL;
+	char *val, *str, *cur, *ptr = NULL;
 	if (!s) {
 		return 0;
 	}
@@ -59,33 +129,74 @@ SDB_API int sdb_journal_load(Sdb *s) {
 		free (str);
 		return 0;
 	}
-	str[sz] = 0;
+	str[rr] = 0;
+	/* the replayed changes are already in there */
+	s->journal = -1;
 	for (cur = str; ; ) {
 		ptr = strchr (cur, '\n');
 		if (!ptr) {
 			break;
 		}
 		*ptr = 0;
-		eq = strchr (cur, '=');
-		if (eq) {
-			*eq++ = 0;
-			sdb_set (s, cur, eq, 0);
+		if (journal_unescape (cur, &val)) {
+			sdb_set (s, cur, val, 0);
 			changes ++;
 		}
 		cur = ptr + 1;
 	}
+	if (cur != str + rr) {
+		(void)ftruncate (fd, cur - str);
+	}
+	s->journal = fd;
 	free (str);
 	return changes;
 }
 
+static char *journal_escape(char *o, const char *str, bool key) {
+	for (; *str; str++) {
+		if (*str == '\\' || *str == '\n' || (key && *str == '=')) {
+			*o++ = '\\';
+			*o++ = (*str == '\n')? 'n': *str;
+		} else {
+			*o++ = *str;
+		}
+	}
+	return o;
+}
+
 SDB_API bool sdb_journal_log(Sdb *s, const char *key, const char *val) {
-	const char *str;
+	int max;
+	char *o;
 	if (s->journal == -1) {
 		return false;
 	}
-	str = sdb_fmt (0, "%s=%s\n", key, val);
-	int len = strlen (str);
-	if (write (s->journal, str, len) != len) {
+	if (!val) {
+		val = "";
+	}
+	max = (strlen (key) + strlen (val)) * 2 + 2;
+	if (s->journal_len + max > s->journal_size) {
+		int size = s->journal_size + R_MAX (s->journal_size, max);
+		char *buf = realloc (s->journal_buf, size);
+		if (!buf) {
+			/* the change is not logged, the next sync writes it all */
+			s->journal_rebase = true;
+			return false;
+		}
+		s->journal_buf = buf;
+		s->journal_size = size;
+	}
+	o = s->journal_buf + s->journal_len;
+	o = journal_escape (o, key, true);
+	*o++ = '=';
+	o = journal_escape (o, val, false);
+	*o++ = '\n';
+	s->journal_len = o - s->journal_buf;
+	return true;
+}
+
+/* write the pending changes and wait for the disk */
+SDB_API bool sdb_journal_sync(Sdb *s) {
+	if (!s || s->journal == -1 || !journal_write (s)) {
 		return false;
 	}
 #if USE_MMAN
@@ -96,6 +207,7 @@ SDB_API bool sdb_journal_log(Sdb *s, const char *key, const char *val) {
 
 SDB_API bool sdb_journal_clear(Sdb *s) {
 	if (s->journal != -1) {
+		s->journal_len = 0;
 		return !ftruncate (s->journal, 0);
 	}
 	return false;
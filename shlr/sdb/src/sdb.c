@@ -112,11 +112,23 @@ fail:
 
 // XXX: this is wrong. stuff not stored in memory is lost
 SDB_API void sdb_file(Sdb* s, const char *dir) {
+	bool journal = s->journal != -1;
+	if (dir && s->dir && !strcmp (dir, s->dir)) {
+		return;
+	}
 	if (s->lock) {
 		sdb_unlock (sdb_lock_file (s->dir));
 	}
+	/* the old file keeps its journal, the new one starts empty */
+	if (journal) {
+		sdb_journal_close (s);
+	}
 	free (s->dir);
 	s->dir = (dir && *dir)? strdup (dir): NULL;
+	if (journal && sdb_journal_open (s)) {
+		sdb_journal_clear (s);
+		s->journal_rebase = true;
+	}
 	if (s->lock) {
 		sdb_lock (sdb_lock_file (s->dir));
 	}
@@ -158,11 +170,11 @@ static void sdb_fini(Sdb* s, int donull) {
 	}
 	sdb_ns_free (s);
 	s->refs = 0;
+	sdb_journal_close (s);
 	free (s->name);
 	free (s->path);
 	ls_free (s->ns);
 	sdb_ht_free (s->ht);
-	sdb_journal_close (s);
 	if (s->fd != -1) {
 		close (s->fd);
 		s->fd = -1;
@@ -405,6 +417,7 @@ SDB_API void sdb_reset(Sdb* s) {
 	}
 	/* ignore disk cache, file is not removed, but we will ignore
 	 * its values when syncing again */
+	sdb_journal_close (s);
 	sdb_close (s);
 	/* empty memory hashtable */
 	sdb_ht_free (s->ht);
@@ -540,9 +553,20 @@ SDB_API SdbKv* sdb_kv_new2(const char *k, int kl, const char *v, int vl) {
 SDB_API void sdb_kv_free(SdbKv *kv) {
 	free (kv->key);
 	free (kv->value);
+	sdb_array_index_free (kv->array);
 	R_FREE (kv);
 }
 
+/* the value of kv was modified in place, log it and give it a new cas */
+SDB_API ut32 sdb_kv_touch(Sdb *s, SdbKv *kv) {
+	if (s->journal != -1) {
+		sdb_journal_log (s, kv->key, kv->value);
+	}
+	kv->cas = nextcas ();
+	sdb_hook_call (s, kv->key, kv->value);
+	return kv->cas;
+}
+
 static ut32 sdb_set_internal(Sdb* s, const char *key, char *val, int owned, ut32 cas) {
 	ut32 vlen, klen;
 	SdbKv *kv;
@@ -699,6 +723,7 @@ static int getbytes(Sdb *s, char *b, int len) {
 }
 
 static bool sdb_foreach_end(Sdb *s, bool result) {
+	s->ht->busy--;
 	s->depth--;
 	if (!s->depth) {
 		ht_free_deleted (s->ht);
@@ -736,39 +761,26 @@ static bool sdb_foreach_cdb(Sdb *s, SdbForeachCallback cb,
 }
 
 SDB_API bool sdb_foreach(Sdb* s, SdbForeachCallback cb, void *user) {
-	SdbListIter *iter;
 	SdbKv *kv;
 	bool result;
+	ut32 pos = 0;
 	if (!s) {
 		return false;
 	}
 	s->depth++;
+	s->ht->busy++;
 	result = sdb_foreach_cdb (s, cb, NULL, user);
 	if (!result) {
 		return sdb_foreach_end (s, false);
 	}
-#if INSERTORDER
-	ls_foreach (s->ht->list, iter, kv) {
-		if (!kv || !kv->value || !*kv->value) {
+	while ((kv = (SdbKv *)ht_next (s->ht, &pos))) {
+		if (!kv->value || !*kv->value) {
 			continue;
 		}
 		if (!cb (user, kv->key, kv->value)) {
 			return sdb_foreach_end (s, false);
 		}
 	}
-#else
-	ut32 i;
-	for (i = 0; i < s->ht->size; i++) {
-		ls_foreach (s->ht->table[i], iter, kv) {
-			if (!kv || !kv->value || !*kv->value) {
-				continue;
-			}
-			if (!cb (user, kv->key, kv->value)) {
-				return sdb_foreach_end (s, false);
-			}
-		}
-	}
-#endif
 	return sdb_foreach_end (s, true);
 }
 
@@ -790,13 +802,31 @@ static int _remove_afer_insert(void *user, const char *k, const char *v) {
 	return false;
 }
 
+/* with a journal only the changes are written, until they outgrow half
+ * of the file and it is rewritten with them */
+static bool sdb_sync_journal(Sdb *s) {
+	struct stat st;
+	off_t size;
+	if (s->journal == -1 || s->journal_rebase || s->fd == -1
+			|| fstat (s->fd, &st) == -1 || !sdb_journal_sync (s)) {
+		return false;
+	}
+	size = lseek (s->journal, 0, SEEK_END);
+	return size >= 0 && size * 2 <= st.st_size;
+}
+
 SDB_API bool sdb_sync(Sdb* s) {
-	SdbListIter it, *iter;
 	SdbKv *kv;
 	bool result;
-	ut32 i;
+	ut32 pos = 0;
 
-	if (!s || !sdb_disk_create (s)) {
+	if (!s) {
+		return false;
+	}
+	if (sdb_sync_journal (s)) {
+		return true;
+	}
+	if (!sdb_disk_create (s)) {
 		return false;
 	}
 	result = sdb_foreach_cdb (s, _insert_into_disk, _remove_afer_insert, s);
@@ -804,19 +834,21 @@ SDB_API bool sdb_sync(Sdb* s) {
 		return false;
 	}
 	/* append new keyvalues */
-	for (i = 0; i < s->ht->size; ++i) {
-		ls_foreach (s->ht->table[i], iter, kv) {
-			if (kv->key && kv->value && *kv->value && !kv->expire) {
-				if (sdb_disk_insert (s, kv->key, kv->value)) {
-					it.n = iter->n;
-					sdb_remove (s, kv->key, 0);
-					iter = &it;
-				}
+	s->ht->busy++;
+	while ((kv = (SdbKv *)ht_next (s->ht, &pos))) {
+		if (kv->key && kv->value && *kv->value && !kv->expire) {
+			if (sdb_disk_insert (s, kv->key, kv->value)) {
+				sdb_remove (s, kv->key, 0);
 			}
 		}
 	}
+	s->ht->busy--;
+	ht_free_deleted (s->ht);
 	sdb_disk_finish (s);
+	/* a crash before this replays the journal over the new file, which
+	 * already has its changes */
 	sdb_journal_clear (s);
+	s->journal_rebase = false;
 	// TODO: sdb_reset memory state?
 	return true;
 }
@@ -1050,11 +1082,11 @@ SDB_API void sdb_config(Sdb *s, int options) {
 		// sync on every query
 	}
 	if (options & SDB_OPTION_JOURNAL) {
-		// sync on every query
-		sdb_journal_open (s);
-		// load journaling if exists
-		sdb_journal_load (s);
-		sdb_journal_clear (s);
+		if (s->journal == -1) {
+			sdb_journal_open (s);
+			// the changes not in the file yet
+			sdb_journal_load (s);
+		}
 	} else {
 		sdb_journal_close (s);
 	}
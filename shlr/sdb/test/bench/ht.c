@@ -0,0 +1,78 @@
+/* sdb - MIT - Copyright 2018 - pancake */
+
+/* insert, find and delete N "key.%d" keys, N defaults to 10M.
+ * Built against src/ht.c and against the old chained table in old/ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ht.h"
+
+static ut64 now(void) {
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return (ut64)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static char **keys_new(int n) {
+	char **keys = malloc (n * sizeof (char *));
+	int i;
+	if (!keys) {
+		return NULL;
+	}
+	for (i = 0; i < n; i++) {
+		char k[32];
+		snprintf (k, sizeof (k), "key.%d", i);
+		if (!(keys[i] = strdup (k))) {
+			return NULL;
+		}
+	}
+	return keys;
+}
+
+static void report(const char *what, int n, ut64 t) {
+	double s = (now () - t) / 1000000.0;
+	printf ("%-8s %d keys  %.2fs  %.0f ns/key\n", what, n, s, s * 1e9 / n);
+}
+
+int main(int argc, char **argv) {
+	int i, n = (argc > 1)? atoi (argv[1]): 10000000;
+	SdbHash *ht = ht_new (NULL, NULL, NULL);
+	char **keys = keys_new (n);
+	ut64 t;
+	bool found;
+	if (!ht || !keys || n < 1) {
+		return 1;
+	}
+	t = now ();
+	for (i = 0; i < n; i++) {
+		if (!ht_insert (ht, keys[i], keys[i])) {
+			printf ("insert %s failed\n", keys[i]);
+			return 1;
+		}
+	}
+	report ("insert", n, t);
+	t = now ();
+	for (i = 0; i < n; i++) {
+		if (ht_find (ht, keys[i], &found) != keys[i] || !found) {
+			printf ("find %s failed\n", keys[i]);
+			return 1;
+		}
+	}
+	report ("find", n, t);
+	t = now ();
+	for (i = 0; i < n; i++) {
+		if (!ht_delete (ht, keys[i])) {
+			printf ("delete %s failed\n", keys[i]);
+			return 1;
+		}
+	}
+	report ("delete", n, t);
+	ht_free (ht);
+	for (i = 0; i < n; i++) {
+		free (keys[i]);
+	}
+	free (keys);
+	return 0;
+}